@@ -1,7 +1,9 @@
 QT += widgets opengl openglwidgets
 
 HEADERS     = \
+              arena.hpp \
               box.hpp \
+              byteStream.hpp \
               cell.hpp \
               circle.hpp \
               geometryengine.hpp \
@@ -14,8 +16,18 @@ HEADERS     = \
               mainwindow.hpp \
               oasisFileManager.hpp \
               oasisIO.hpp \
+              path.hpp \
+              placement.hpp \
               polygon.hpp \
-              trapezoid.hpp
+              property.hpp \
+              rects.hpp \
+              repetition.hpp \
+              repetitionFinder.hpp \
+              text.hpp \
+              trace.hpp \
+              trapezoid.hpp \
+              triangulate.hpp \
+              varint.hpp
 
 SOURCES     = \
               geometryengine.cpp \
@@ -32,6 +44,24 @@ INSTALLS += target
 
 INCLUDEPATH += "C:/Program Files/boost/boost_1_85_0"
 
+# zlib for CBLOCK records. on Windows, where it installs like boost under
+# C:/Program Files, the import library is zlib.lib and zlib.dll goes next
+# to the executable.
+win32 {
+    INCLUDEPATH += "C:/Program Files/zlib/include"
+    LIBS += -L"C:/Program Files/zlib/lib" -lzlib
+} else {
+    LIBS += -lz
+}
+
+# console tracing of the read/write and draw paths, see trace.hpp
+#DEFINES += OASIS_TRACE_LEVEL=2
+#DEFINES += OASIS_TRACE_COUNTERS=1
+
+# AVX2 path of the varint decoder, see varint.hpp. SSE2 is used on any x86-64 build.
+#QMAKE_CXXFLAGS += -mavx2
+#QMAKE_CXXFLAGS += /arch:AVX2
+
 DISTFILES += \
   fshader.glsl \
   vshader.glsl
@@ -0,0 +1,102 @@
+#ifndef __LAYOUT_ARENA_HPP__
+#define __LAYOUT_ARENA_HPP__
+
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <new>
+#include <utility>
+
+
+namespace layout {
+
+/// Bump allocator for the shapes of one Layout.
+/// Memory comes from large chunks and is only given back all at once, when
+/// the arena is destroyed. Objects placed in it must still be destructed by
+/// their owner (see Layer::destroyShape), but never freed one by one.
+class Arena {
+protected:
+    std::size_t chunkSize;
+    /// chunk start -> chunk length. ordered, so owns() is a single lookup.
+    std::map<const char*, std::size_t> chunks;
+    char* cur = nullptr;
+    char* end = nullptr;
+    std::size_t used = 0;
+    std::size_t reserved = 0;
+
+    void newChunk(std::size_t minSize) {
+        std::size_t len = std::max(chunkSize, minSize);
+        char* chunk = static_cast<char*>(::operator new(len));
+        chunks.insert(std::make_pair(chunk, len));
+        cur = chunk;
+        end = chunk + len;
+        reserved += len;
+    }
+
+public:
+    Arena(std::size_t chunk = 1 << 20)
+        : chunkSize(chunk) {
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        release();
+    }
+
+    void* allocate(std::size_t size, std::size_t align = alignof(std::max_align_t)) {
+        std::size_t pad = (align - (reinterpret_cast<std::size_t>(cur) & (align - 1))) & (align - 1);
+        if (cur == nullptr || (std::size_t)(end - cur) < pad + size) {
+            newChunk(size + align);
+            pad = (align - (reinterpret_cast<std::size_t>(cur) & (align - 1))) & (align - 1);
+        }
+        void* p = cur + pad;
+        cur += pad + size;
+        used += size;
+        return p;
+    }
+
+    /// construct a T in the arena.
+    template<typename T, typename... Args>
+    T* create(Args&&... args) {
+        void* p = allocate(sizeof(T), alignof(T));
+        return new (p) T(std::forward<Args>(args)...);
+    }
+
+    /// true if p was allocated from this arena.
+    bool owns(const void* p) const {
+        const char* c = static_cast<const char*>(p);
+        std::map<const char*, std::size_t>::const_iterator it = chunks.upper_bound(c);
+        if (it == chunks.begin())
+            return false;
+        --it;
+        return c < it->first + it->second;
+    }
+
+    /// free every chunk. the caller must have destructed the objects in them.
+    void release() {
+        std::map<const char*, std::size_t>::iterator it = chunks.begin();
+        for (; it != chunks.end(); ++it) {
+            ::operator delete(const_cast<char*>(it->first));
+        }
+        chunks.clear();
+        cur = nullptr;
+        end = nullptr;
+        used = 0;
+        reserved = 0;
+    }
+
+    std::size_t getBytesUsed() const {
+        return used;
+    }
+    std::size_t getBytesReserved() const {
+        return reserved;
+    }
+}; // class Arena
+
+} // namespace layout
+
+#endif // __LAYOUT_ARENA_HPP__
@@ -24,6 +24,11 @@ public:
     Box(coord_type minx, coord_type miny, coord_type maxx, coord_type maxy)
         : base_type(pointT(minx, miny), pointT(maxx, maxy)) {
     }
+    /// convert between coordinate types, e.g. a DBU bbox to the viewer's double box.
+    template<typename otherT>
+    explicit Box(const Box<otherT>& box)
+        : base_type(pointT(box.getMinX(), box.getMinY()), pointT(box.getMaxX(), box.getMaxY())) {
+    }
 
     virtual ~Box() {}
 
@@ -126,6 +131,16 @@ public:
         return false;
     }
 
+    bool intersects(const Box& box) const {
+        return !(box.getMinX() > getMaxX() || box.getMaxX() < getMinX() ||
+                 box.getMinY() > getMaxY() || box.getMaxY() < getMinY());
+    }
+
+    bool contains(const Box& box) const {
+        return box.getMinX() >= getMinX() && box.getMaxX() <= getMaxX() &&
+               box.getMinY() >= getMinY() && box.getMaxY() <= getMaxY();
+    }
+
     void expand(const Box& box) {
         if (box.getMinX() < getMinX())
             setMinX(box.getMinX());
@@ -151,7 +166,7 @@ public:
 
     void getVertices(std::vector<QVector3D>& vertices,
                      std::vector<int>& vertexCnts) const {
-        printf("draw Box 4 vertices...\n");
+        OASIS_TRACE(TRACE_RECORD, "draw Box 4 vertices..." << std::endl);
         vertices.emplace_back(getMinX(), getMinY(), pointZval);
         vertices.emplace_back(getMaxX(), getMinY(), pointZval);
         vertices.emplace_back(getMaxX(), getMaxY(), pointZval);
@@ -166,6 +181,8 @@ public:
 }; // class Box
 
 typedef Box<dPoint> dBox;
+typedef Box<iPoint> iBox;
+typedef Box<lPoint> lBox;
 
 } // namespace layout
 
@@ -0,0 +1,620 @@
+#ifndef BYTESTREAM_H
+#define BYTESTREAM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <zlib.h>
+
+namespace oasisio {
+
+using byte = unsigned char;
+
+namespace bip = boost::interprocess;
+
+/// validation schemes of the OASIS END record.
+const unsigned int VALIDATION_NONE = 0;
+const unsigned int VALIDATION_CRC32 = 1;
+const unsigned int VALIDATION_CHECKSUM32 = 2;
+
+/// signature carried on over data[0..n): the CRC32 of zlib, or checksum32,
+/// the sum of the bytes modulo 2^32.
+inline std::uint32_t validationSignature(unsigned int scheme, std::uint32_t signature, const byte* data, std::size_t n) {
+    if(scheme == VALIDATION_CRC32) {
+        // crc32 takes at most a uInt at a time.
+        while(n > 0) {
+            uInt cnt = (uInt)std::min<std::size_t>(n, 1u << 30);
+            signature = (std::uint32_t)crc32(signature, data, cnt);
+            data += cnt;
+            n -= cnt;
+        }
+    } else if(scheme == VALIDATION_CHECKSUM32) {
+        std::size_t i;
+        for(i=0; i<n; ++i) {
+            signature += data[i];
+        }
+    }
+    return signature;
+}
+
+
+/// Byte source the OasisReader decoders run on.
+/// Decoders consume the [cur, end) window directly; refill() is only called
+/// once the window runs dry, so reading a byte is a compare and an increment.
+/// The inflated contents of a CBLOCK are read the same way: pushBlock() makes
+/// them the window and the source's own window comes back once they run dry.
+class ByteSource {
+protected:
+    const byte* base = nullptr;     // first byte of the current window
+    const byte* cur = nullptr;      // next byte to read
+    const byte* end = nullptr;      // one past the last byte of the window
+    std::size_t windowPos = 0;      // file offset of base
+    bool eofFlag = false;
+    /// set by sources whose data() pointers stay valid, see isResident().
+    bool resident = false;
+
+    /// inflated CBLOCK contents, and the source's window while they are read.
+    std::vector<byte> block;
+    bool blockActive = false;
+    const byte* savedBase = nullptr;
+    const byte* savedCur = nullptr;
+    const byte* savedEnd = nullptr;
+    std::size_t savedPos = 0;
+
+    /// load the window following the current one. returns false at end of data.
+    virtual bool refill() = 0;
+    /// ensure() for the source's own window.
+    virtual std::size_t fillWindow(std::size_t n) {
+        if(cur == end) {
+            refill();
+        }
+        return (std::size_t)(end - cur);
+    }
+    virtual void seekTo(std::size_t pos) = 0;
+
+    void leaveBlock() {
+        base = savedBase;
+        cur = savedCur;
+        end = savedEnd;
+        windowPos = savedPos;
+        blockActive = false;
+    }
+
+    /// the window after the current one: the rest of the source after a block.
+    bool underflow() {
+        if(blockActive) {
+            leaveBlock();
+            if(cur != end) {
+                return true;
+            }
+        }
+        return refill();
+    }
+
+public:
+    virtual ~ByteSource() {}
+
+    byte get() {
+        if(cur == end && !underflow()) {
+            eofFlag = true;
+            return 0;
+        }
+        return *cur++;
+    }
+
+    void read(char* out, std::size_t n) {
+        while(n > 0) {
+            if(cur == end && !underflow()) {
+                eofFlag = true;
+                std::memset(out, 0, n);
+                return;
+            }
+            std::size_t cnt = std::min(n, (std::size_t)(end - cur));
+            std::memcpy(out, cur, cnt);
+            cur += cnt;
+            out += cnt;
+            n -= cnt;
+        }
+    }
+
+    void skip(std::size_t n) {
+        if(n <= (std::size_t)(end - cur)) {
+            cur += n;
+        } else {
+            seek(tell() + n);
+        }
+    }
+
+    /// step back over the byte get() just returned, e.g. a record ID that
+    /// belongs to the caller.
+    void unget() {
+        if(!eofFlag) {
+            --cur;
+        }
+    }
+
+    /// file offset of the next byte. inside a block, the offset the source
+    /// continues at once the block is used up.
+    std::size_t tell() const {
+        if(blockActive) {
+            return savedPos + (savedCur - savedBase);
+        }
+        return windowPos + (cur - base);
+    }
+
+    bool eof() const {
+        return eofFlag;
+    }
+
+    /// make at least n bytes contiguous at data(). returns the number actually
+    /// available, which inside a block is never more than the block's rest.
+    std::size_t ensure(std::size_t n) {
+        if(blockActive) {
+            if(cur != end) {
+                return (std::size_t)(end - cur);
+            }
+            leaveBlock();
+        }
+        return fillWindow(n);
+    }
+    const byte* data() const {
+        return cur;
+    }
+    void advance(std::size_t n) {
+        cur += n;
+    }
+
+    /// true if data() pointers stay valid for the life of the source, so
+    /// views into them need no copy. never true for a block's contents.
+    bool isResident() const {
+        return resident && !blockActive;
+    }
+
+    /// read data next, then carry on where the source is now. data is taken
+    /// over. blocks do not nest.
+    void pushBlock(std::vector<byte>& data) {
+        if(blockActive) {
+            throw std::exception("Nested CBLOCK.");
+        }
+        block.swap(data);
+        savedBase = base;
+        savedCur = cur;
+        savedEnd = end;
+        savedPos = windowPos;
+        blockActive = true;
+        base = block.data();
+        cur = base;
+        end = base + block.size();
+        windowPos = 0;
+    }
+    bool inBlock() const {
+        return blockActive;
+    }
+
+    /// absolute seek. leaves a block and clears the eof state like std::istream::seekg.
+    void seek(std::size_t pos) {
+        if(blockActive) {
+            leaveBlock();
+        }
+        seekTo(pos);
+    }
+    virtual std::size_t size() const = 0;
+
+};
+
+
+/// Source over a block of memory that is already resident.
+class SpanByteSource : public ByteSource {
+protected:
+    std::size_t length = 0;
+
+    bool refill() {
+        return false;
+    }
+
+    std::size_t fillWindow(std::size_t n) {
+        return (std::size_t)(end - cur);
+    }
+
+    void seekTo(std::size_t pos) {
+        cur = base + std::min(pos, length);
+        eofFlag = false;
+    }
+
+    void setSpan(const byte* data, std::size_t len) {
+        base = data;
+        cur = data;
+        end = data + len;
+        windowPos = 0;
+        length = len;
+        eofFlag = false;
+        resident = true;
+    }
+
+public:
+    SpanByteSource() = default;
+    SpanByteSource(const byte* data, std::size_t len) {
+        setSpan(data, len);
+    }
+
+    std::size_t size() const {
+        return length;
+    }
+
+};
+
+
+/// Memory-mapped file. The whole file is a single window, so the
+/// decoders never leave their fast path.
+class MappedByteSource : public SpanByteSource {
+protected:
+    bip::file_mapping mapping;
+    bip::mapped_region region;
+
+public:
+    MappedByteSource(const std::string& name) {
+        try {
+            mapping = bip::file_mapping(name.c_str(), bip::read_only);
+            region = bip::mapped_region(mapping, bip::read_only);
+        } catch(const bip::interprocess_exception&) {
+            throw std::exception("Failed to map file.");
+        }
+        region.advise(bip::mapped_region::advice_sequential);
+        setSpan((const byte*)region.get_address(), region.get_size());
+    }
+
+};
+
+
+/// Fallback for streams that cannot be mapped. Reads the stream in large
+/// blocks instead of one byte per call.
+class BufferedByteSource : public ByteSource {
+protected:
+    std::istream& is;
+    std::vector<byte> buffer;
+    std::size_t blockSize;
+    std::size_t streamSize;
+
+    bool fill(std::size_t keep) {
+        // keep the last `keep` bytes of the window in front of the new data.
+        std::size_t consumed = (cur - base);
+        if(keep > 0) {
+            std::memmove(buffer.data(), cur, keep);
+        }
+        windowPos += consumed;
+        is.read((char *)buffer.data() + keep, buffer.size() - keep);
+        std::size_t got = (std::size_t)is.gcount();
+        base = buffer.data();
+        cur = base;
+        end = base + keep + got;
+        return got > 0;
+    }
+
+    bool refill() {
+        return fill(0);
+    }
+
+    std::size_t fillWindow(std::size_t n) {
+        std::size_t avail = (std::size_t)(end - cur);
+        if(avail < n) {
+            if(buffer.size() < n) {
+                std::vector<byte> grown(n);
+                std::memcpy(grown.data(), cur, avail);
+                windowPos += (cur - base);
+                buffer.swap(grown);
+                base = buffer.data();
+                cur = base;
+                end = base + avail;
+            }
+            fill(avail);
+            avail = (std::size_t)(end - cur);
+        }
+        return avail;
+    }
+
+    void seekTo(std::size_t pos) {
+        eofFlag = false;
+        if(pos >= windowPos && pos <= windowPos + (end - base)) {
+            cur = base + (pos - windowPos);
+            return;
+        }
+        is.clear();
+        is.seekg(pos, is.beg);
+        windowPos = pos;
+        base = buffer.data();
+        cur = base;
+        end = base;
+    }
+
+public:
+    BufferedByteSource(std::istream& s, std::size_t block = 1 << 20)
+        : is(s)
+        , buffer(block)
+        , blockSize(block)
+    {
+        std::streampos start = is.tellg();
+        is.seekg(0, is.end);
+        streamSize = (std::size_t)is.tellg();
+        is.seekg(start, is.beg);
+        windowPos = (std::size_t)start;
+        base = buffer.data();
+        cur = base;
+        end = base;
+    }
+
+    std::size_t size() const {
+        return streamSize;
+    }
+
+};
+
+
+
+/// Byte sink the OasisWriter encodes into.
+/// Encoders write into the [cur, end) window; the destination only sees
+/// whole windows, so a file is written in a handful of large blocks.
+class ByteSink {
+protected:
+    byte* base = nullptr;           // first byte of the current window
+    byte* cur = nullptr;            // next byte to write
+    byte* end = nullptr;            // one past the last writable byte
+    std::size_t windowPos = 0;      // file offset of base
+
+    unsigned int validation = VALIDATION_NONE;
+    std::uint32_t signature = 0;
+    std::size_t signedPos = 0;      // file offset of the first byte not signed
+
+    /// hand [base, cur) to the destination and open a window of at least n bytes.
+    virtual void flushWindow(std::size_t n) = 0;
+
+    /// add the bytes of the window not signed yet to the signature. called
+    /// before a window is handed on, while its bytes are still in cache.
+    void sign() {
+        if(validation == VALIDATION_NONE) {
+            return;
+        }
+        const byte* from = base + (signedPos - windowPos);
+        signature = validationSignature(validation, signature, from, (std::size_t)(cur - from));
+        signedPos = tell();
+    }
+
+public:
+    virtual ~ByteSink() {}
+
+    /// keep a signature under scheme over every byte written from now on.
+    void setValidation(unsigned int scheme) {
+        validation = scheme;
+        signature = 0;
+        signedPos = tell();
+    }
+    std::uint32_t getSignature() {
+        sign();
+        return signature;
+    }
+
+    void put(byte b) {
+        if(cur == end) {
+            flushWindow(1);
+        }
+        *cur++ = b;
+    }
+
+    void write(const char* data, std::size_t n) {
+        while(n > 0) {
+            if(cur == end) {
+                flushWindow(n);
+            }
+            std::size_t cnt = std::min(n, (std::size_t)(end - cur));
+            std::memcpy(cur, data, cnt);
+            cur += cnt;
+            data += cnt;
+            n -= cnt;
+        }
+    }
+
+    /// make room for n bytes and return where they go. follow with advance().
+    byte* ensure(std::size_t n) {
+        if((std::size_t)(end - cur) < n) {
+            flushWindow(n);
+        }
+        return cur;
+    }
+    void advance(std::size_t n) {
+        cur += n;
+    }
+
+    /// offset of the next byte written, counted from the start of the file.
+    std::size_t tell() const {
+        return windowPos + (cur - base);
+    }
+
+    /// push everything written so far to the destination.
+    virtual void flush() = 0;
+
+};
+
+
+/// Sink over an std::ostream, written in blocks of blockSize bytes.
+class StreamByteSink : public ByteSink {
+protected:
+    std::ostream& os;
+    std::vector<byte> buffer;
+
+    void flushWindow(std::size_t n) {
+        sign();
+        if(cur != base) {
+            os.write((const char *)base, cur - base);
+            windowPos += (cur - base);
+        }
+        if(buffer.size() < n) {
+            buffer.resize(n);
+        }
+        base = buffer.data();
+        cur = base;
+        end = base + buffer.size();
+    }
+
+public:
+    StreamByteSink(std::ostream& s, std::size_t blockSize = 1 << 20)
+        : os(s)
+        , buffer(blockSize)
+    {
+        base = buffer.data();
+        cur = base;
+        end = base + buffer.size();
+    }
+
+    virtual ~StreamByteSink() {
+        flush();
+    }
+
+    void flush() {
+        flushWindow(0);
+        os.flush();
+    }
+
+};
+
+
+/// Sink into memory, e.g. records collected for a CBLOCK.
+class VectorByteSink : public ByteSink {
+protected:
+    std::vector<byte> buffer;
+
+    void flushWindow(std::size_t n) {
+        sign();
+        std::size_t written = tell();
+        buffer.resize(std::max(buffer.size() * 2, written + n));
+        base = buffer.data();
+        cur = base + written;
+        end = base + buffer.size();
+    }
+
+public:
+    VectorByteSink(std::size_t initialSize = 1 << 16)
+        : buffer(initialSize)
+    {
+        base = buffer.data();
+        cur = base;
+        end = base + buffer.size();
+    }
+
+    void flush() {
+    }
+
+    /// start over, keeping the memory.
+    void clear() {
+        cur = base;
+        signedPos = windowPos;
+    }
+
+    const byte* data() const {
+        return base;
+    }
+    std::size_t size() const {
+        return tell();
+    }
+
+};
+
+
+/// Sink writing straight into a memory mapping of the output file.
+/// The file grows in doubling steps, from at least a page, and is cut
+/// back to the written length by close().
+class MappedByteSink : public ByteSink {
+protected:
+    std::string name;
+    bip::file_mapping mapping;
+    bip::mapped_region region;
+    std::size_t capacity = 0;
+
+    void remap(std::size_t newCapacity) {
+        if(base) {
+            sign();
+        }
+        std::size_t written = tell();
+        region = bip::mapped_region();
+        std::filesystem::resize_file(name, newCapacity);
+        region = bip::mapped_region(mapping, bip::read_write, 0, newCapacity);
+        capacity = newCapacity;
+        base = (byte *)region.get_address();
+        cur = base + written;
+        end = base + capacity;
+        windowPos = 0;
+    }
+
+    void flushWindow(std::size_t n) {
+        std::size_t needed = tell() + n;
+        // doubling a zero capacity never reaches needed.
+        std::size_t newCapacity = std::max<std::size_t>(capacity, bip::mapped_region::get_page_size());
+        while(newCapacity < needed) {
+            newCapacity *= 2;
+        }
+        remap(newCapacity);
+    }
+
+public:
+    MappedByteSink(const std::string& n, std::size_t initialSize = 1 << 24)
+        : name(n)
+    {
+        // an empty file cannot be mapped.
+        initialSize = std::max<std::size_t>(initialSize, bip::mapped_region::get_page_size());
+        {
+            std::ofstream create(name, std::ios::out | std::ios::binary | std::ios::trunc);
+            if(!create) {
+                throw std::exception("Failed to create file.");
+            }
+        }
+        std::filesystem::resize_file(name, initialSize);
+        try {
+            mapping = bip::file_mapping(name.c_str(), bip::read_write);
+        } catch(const bip::interprocess_exception&) {
+            throw std::exception("Failed to map file.");
+        }
+        capacity = 0;
+        base = nullptr;
+        cur = nullptr;
+        end = nullptr;
+        remap(initialSize);
+    }
+
+    virtual ~MappedByteSink() {
+        close();
+    }
+
+    void flush() {
+        if(region.get_size() > 0) {
+            region.flush();
+        }
+    }
+
+    /// unmap and truncate the file to the bytes actually written.
+    void close() {
+        if(region.get_size() == 0) {
+            return;
+        }
+        std::size_t written = tell();
+        region.flush();
+        region = bip::mapped_region();
+        mapping = bip::file_mapping();
+        std::filesystem::resize_file(name, written);
+        base = nullptr;
+        cur = nullptr;
+        end = nullptr;
+        windowPos = written;
+    }
+
+};
+
+}
+
+#endif // BYTESTREAM_H
@@ -3,8 +3,12 @@
 
 
 #include "layer.hpp"
+#include "placement.hpp"
+#include "property.hpp"
 
+#include <functional>
 #include <map>
+#include <vector>
 
 
 namespace layout {
@@ -14,27 +18,50 @@ class Cell {
 public:
     typedef typename pointT::coord_type coord_type;
     typedef std::map<std::string, Layer<pointT>* > tLayers;
+    typedef std::vector<Placement<pointT> > tPlacements;
 
 protected:
     std::string cellName;
     tLayers layers;
     Layer<pointT>* activeLayer;
+    /// the owning layout's shape arena, handed to new layers.
+    Arena* arena;
+    /// the owning layout's layer colors and visibility, given to new layers.
+    const LayerStyles* styles;
     Box<pointT> bbox{std::numeric_limits<coord_type>::min(),
                      std::numeric_limits<coord_type>::min(),
                      std::numeric_limits<coord_type>::min(),
                      std::numeric_limits<coord_type>::min()};
+    /// bumped when layers are added or removed. deleted layers add their own
+    /// generation too, so getGeneration() never goes back to an earlier value.
+    unsigned long generation = 0;
+    /// instances of other cells. the cells themselves belong to the layout.
+    tPlacements placements;
+    /// how many placements in other cells point here. 0 for a top cell.
+    unsigned int parentCount = 0;
+    /// part of the loaded contents, like the layers.
+    Properties properties;
+    /// fills the cell on first use, for cells opened lazily. empty once run.
+    std::function<void(Cell<pointT>&)> loader;
+    /// extent of the shapes of a cell that is not loaded yet, see setBBox().
+    Box<pointT> knownBBox{std::numeric_limits<coord_type>::min(),
+                          std::numeric_limits<coord_type>::min(),
+                          std::numeric_limits<coord_type>::min(),
+                          std::numeric_limits<coord_type>::min()};
 
 public:
-    Cell(const std::string& n)
+    Cell(const std::string& n, Arena* a = nullptr, const LayerStyles* s = nullptr)
         : cellName(n)
         , activeLayer(nullptr)
+        , arena(a)
+        , styles(s)
     {
         layers.clear();
         bbox.makeInvalid();
     }
 
     virtual ~Cell() {
-        for_each(getLayers().begin(), getLayers().end(),
+        for_each(layers.begin(), layers.end(),
             [] (typename decltype(layers)::value_type const& p) {
                 delete p.second;
             }
@@ -44,28 +71,100 @@ public:
 
     void print(std::string prefix) {
 
+        ensureLoaded();
         std::cout << prefix << cellName << std::endl;
         typename std::map<std::string, Layer<pointT>* >::const_iterator it = layers.begin();
         for(; it != layers.end(); ++it) {
             ((Layer<pointT>*)(it->second))->print(prefix + "  ");
         }
+        typename tPlacements::const_iterator pit = placements.begin();
+        for(; pit != placements.end(); ++pit) {
+            std::cout << prefix << "  " << pit->getCell()->getName() << " at " << pit->getOffset().x() << ","
+                      << pit->getOffset().y() << std::endl;
+        }
     }
 
     tLayers& getLayers() {
+        ensureLoaded();
         return layers;
     }
     const tLayers& getLayers() const {
+        ensureLoaded();
         return layers;
     }
 
+    /// defer reading the cell's contents until they are first needed.
+    /// a second loader runs after the first one.
+    void addLoader(std::function<void(Cell<pointT>&)> load) {
+        if (loader) {
+            std::function<void(Cell<pointT>&)> first;
+            first.swap(loader);
+            loader = [first, load](Cell<pointT>& cell) {
+                first(cell);
+                load(cell);
+            };
+        } else {
+            loader = std::move(load);
+        }
+    }
+    bool isLoaded() const {
+        return !loader;
+    }
+
+    /// take the layer colors and visibility of the layout the cell joins.
+    /// the layers it already has are styled without loading the rest.
+    void setLayerStyles(const LayerStyles* s) {
+        styles = s;
+        if (!styles)
+            return;
+        typename tLayers::iterator it = layers.begin();
+        for (; it != layers.end(); ++it)
+            styles->apply(*it->second);
+    }
+
+    /// run a pending loader. the cell looks the same loaded or not, so this
+    /// is done from const members too.
+    void ensureLoaded() const {
+        if (loader) {
+            Cell<pointT>* This = const_cast<Cell<pointT>*>(this);
+            // cleared before running: the loader fills the cell through the usual members.
+            std::function<void(Cell<pointT>&)> load;
+            load.swap(This->loader);
+            load(*This);
+        }
+    }
+
+    /// extent of the cell's own shapes, known without loading it, e.g. from
+    /// the file's index. only used until the cell is loaded.
+    void setBBox(const Box<pointT>& box) {
+        knownBBox = box;
+        bbox.makeInvalid();
+    }
+
+    /// own shapes and placed cells. each placed cell's box is computed once
+    /// and reused by every placement of it.
     const Box<pointT>& computeBBox() {
-        typename tLayers::const_iterator it = getLayers().begin();
-        if (it != getLayers().end()) {
-            bbox = it->second->getBBox();
-            ++it;
+        bbox.makeInvalid();
+        if (!isLoaded() && knownBBox.isValid()) {
+            bbox = knownBBox;
+        } else {
+            typename tLayers::const_iterator it = getLayers().begin();
+            for (; it != getLayers().end(); ++it) {
+                if (bbox.isValid())
+                    bbox.expand(it->second->getBBox());
+                else
+                    bbox = it->second->getBBox();
+            }
         }
-        for (; it != getLayers().end(); ++it) {
-            bbox.expand(it->second->getBBox());
+        typename tPlacements::const_iterator pit = placements.begin();
+        for (; pit != placements.end(); ++pit) {
+            Box<pointT> box = pit->getBBox();
+            if (!box.isValid())
+                continue;
+            if (bbox.isValid())
+                bbox.expand(box);
+            else
+                bbox = box;
         }
         return bbox;
     }
@@ -79,13 +178,17 @@ public:
     }
 
     Layer<pointT>* newLayer(int lyrNo, int dataT, const QColor& clr) {
+        ensureLoaded();
         std::string lyrName = Layer<pointT>::makeLayerName(lyrNo, dataT);
         typename tLayers::iterator it = layers.find(lyrName);
         if (it == layers.end()) {
-            Layer<pointT>* layer = new Layer<pointT>(lyrNo, dataT, clr);
+            Layer<pointT>* layer = new Layer<pointT>(lyrNo, dataT, clr, arena);
+            if (styles)
+                styles->apply(*layer);
             layers[lyrName] = layer;
             activeLayer = layer;
             bbox.makeInvalid();
+            ++generation;
         } else {
             activeLayer = it->second;
         }
@@ -93,6 +196,7 @@ public:
     }
 
     Layer<pointT>* getLayer(int lyrNo, int dataT) {
+        ensureLoaded();
         std::string lyrName = Layer<pointT>::makeLayerName(lyrNo, dataT);
         typename tLayers::iterator it = layers.find(lyrName);
         if (it == layers.end())
@@ -102,6 +206,7 @@ public:
     }
 
     const Layer<pointT>* getLayer(int lyrNo, int dataT) const {
+        ensureLoaded();
         std::string lyrName = Layer<pointT>::makeLayerName(lyrNo, dataT);
         typename tLayers::const_iterator it = layers.find(lyrName);
         if (it == layers.end())
@@ -111,21 +216,25 @@ public:
     }
 
     void delLayer(int lyrNo, int dataT) {
+        ensureLoaded();
         typename tLayers::iterator it = layers.find(Layer<pointT>::makeLayerName(lyrNo, dataT));
         if (it != layers.end()) {
             if (activeLayer == it->second)
                 activeLayer = nullptr;
+            generation += it->second->getGeneration() + 1;
             delete it->second;
             layers.erase(it);
             bbox.makeInvalid();
         }
     }
     void delLayer(const std::string& name) {
+        ensureLoaded();
         typename tLayers::iterator it = layers.find(name);
         if (it != layers.end()) {
             bbox.makeInvalid();
             if (activeLayer == it->second)
                 activeLayer = nullptr;
+            generation += it->second->getGeneration() + 1;
             delete it->second;
             layers.erase(it);
             bbox.makeInvalid();
@@ -139,16 +248,66 @@ public:
         return activeLayer;
     }
     void setActiveLayer(int lyrNo, int dataT) {
+        ensureLoaded();
         typename tLayers::iterator it = layers.find(Layer<pointT>::makeLayerName(lyrNo, dataT));
         if (it != layers.end())
             activeLayer = it->second;
     }
     void setActiveLayer(const std::string& name) {
+        ensureLoaded();
         typename tLayers::iterator it = layers.find(name);
         if (it != layers.end())
             activeLayer = it->second;
     }
 
+    /// place child in this cell. child must belong to the same layout.
+    /// placements are not part of the loaded contents: a cell opened lazily
+    /// can have them before it is loaded.
+    Placement<pointT>& addPlacement(Cell<pointT>* child, const pointT& offset, double angle = 0.0,
+                                    bool mirror = false, double mag = 1.0,
+                                    const Repetition<pointT>& repetition = Repetition<pointT>()) {
+        placements.emplace_back(child, offset, angle, mirror, mag, repetition);
+        ++child->parentCount;
+        bbox.makeInvalid();
+        ++generation;
+        return placements.back();
+    }
+
+    /// remove every placement of child.
+    void delPlacements(const Cell<pointT>* child) {
+        typename tPlacements::iterator it = placements.begin();
+        std::size_t before = placements.size();
+        for (; it != placements.end(); ) {
+            if (it->getCell() == child) {
+                --it->getCell()->parentCount;
+                it = placements.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (placements.size() != before) {
+            bbox.makeInvalid();
+            ++generation;
+        }
+    }
+
+    const tPlacements& getPlacements() const {
+        return placements;
+    }
+
+    unsigned int getParentCount() const {
+        return parentCount;
+    }
+
+    Properties& getProperties() {
+        ensureLoaded();
+        return properties;
+    }
+    const Properties& getProperties() const {
+        ensureLoaded();
+        return properties;
+    }
+
     std::string getName() const {
         return cellName;
     }
@@ -156,7 +315,9 @@ public:
         cellName = name;
     }
 
+    /// this cell's own vertices and shapes. a placed cell counts once, in itself.
     int getVertexCount() const {
+        ensureLoaded();
         int cnt = 0;
         typename tLayers::const_iterator it = layers.begin();
         for (; it != layers.end(); ++it) {
@@ -165,18 +326,96 @@ public:
         return cnt;
     }
 
-    void getVerticesAndColors(std::vector<QVector3D>& vertices,
-                     std::vector<QVector4D>& colors,
+    /// changes whenever this cell's own contents or placements change. does not
+    /// load the cell; loading it changes the generation like any other edit.
+    /// Layout::getGeneration() covers the placed cells.
+    unsigned long getGeneration() const {
+        unsigned long gen = generation;
+        typename tLayers::const_iterator it = layers.begin();
+        for (; it != layers.end(); ++it) {
+            gen += it->second->getGeneration();
+        }
+        return gen;
+    }
+
+    int getShapeCount() const {
+        ensureLoaded();
+        int cnt = 0;
+        typename tLayers::const_iterator it = layers.begin();
+        for (; it != layers.end(); ++it) {
+            cnt += it->second->getShapeCount();
+        }
+        return cnt;
+    }
+
+    /// call f(layer, transform, localRegion) for each layer of this cell and of
+    /// the cells placed in it, recursively, that may intersect region. region is
+    /// in this cell's coordinates, localRegion in the layer's; transform maps
+    /// the layer's coordinates back to this cell's. an invalid region means all.
+    template<typename F>
+    void visitLayers(const Box<pointT>& region, const Transform& transform, F f) const {
+        typename tLayers::const_iterator it = getLayers().begin();
+        for (; it != getLayers().end(); ++it) {
+            if (region.isValid() && !region.intersects(it->second->getBBox()))
+                continue;
+            f(it->second, transform, region);
+        }
+        typename tPlacements::const_iterator pit = placements.begin();
+        for (; pit != placements.end(); ++pit) {
+            if (region.isValid() && !region.intersects(pit->getBBox()))
+                continue;
+            Transform t = pit->getTransform();
+            Box<pointT> box = t.apply(pit->getCell()->getBBox());
+            // each copy of a repeated placement is culled on its own.
+            pit->getRepetition().forEach([&](coord_type dx, coord_type dy) {
+                if (region.isValid() &&
+                    !region.intersects(Box<pointT>(box.getMinX() + dx, box.getMinY() + dy,
+                                                   box.getMaxX() + dx, box.getMaxY() + dy)))
+                    return;
+                Transform copy = Transform(dx, dy, 0.0, false, 1.0) * t;
+                Box<pointT> childRegion = region.isValid() ? copy.inverted().apply(region) : region;
+                pit->getCell()->visitLayers(childRegion, transform * copy, f);
+            });
+        }
+    }
+
+    void getVertices(std::vector<QVector3D>& vertices,
                      std::vector<int>& vertexCnts) const {
-        printf("draw cell=%s. %d vertices...\n", getName().c_str(), getVertexCount());
+        OASIS_TRACE(TRACE_SUMMARY, "draw cell=" << getName() << ". " << getVertexCount() << " vertices..." << std::endl);
+        Box<pointT> all;
+        all.makeInvalid();
+        getVertices(all, vertices, vertexCnts);
+    }
+
+    /// vertices of the shapes intersecting region, placed cells included.
+    /// an invalid region means all shapes.
+    void getVertices(const Box<pointT>& region,
+                     std::vector<QVector3D>& vertices,
+                     std::vector<int>& vertexCnts) const {
+        OASIS_TRACE(TRACE_SUMMARY, "draw cell=" << getName() << " in region..." << std::endl);
+        visitLayers(region, Transform(),
+            [&vertices, &vertexCnts](const Layer<pointT>* layer, const Transform& t, const Box<pointT>& local) {
+                std::size_t first = vertices.size();
+                layer->getVertices(local, vertices, vertexCnts);
+                t.apply(vertices, first);
+            });
+    }
+
+    /// collect the shapes of all layers whose bounding box intersects region.
+    void queryRegion(const Box<pointT>& region, std::vector<iShape<pointT>*>& result) const {
+        ensureLoaded();
         typename tLayers::const_iterator it = layers.begin();
         for (; it != layers.end(); ++it) {
-            it->second->getVerticesAndColors(vertices, colors, vertexCnts);
+            if (!region.intersects(it->second->getBBox()))
+                continue;
+            it->second->queryRegion(region, result);
         }
     }
 }; // class Cell
 
 typedef Cell<dPoint> dCell;
+typedef Cell<iPoint> iCell;
+typedef Cell<lPoint> lCell;
 
 } // namespace layout
 
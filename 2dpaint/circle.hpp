@@ -67,7 +67,7 @@ public:
 
     void getVertices(std::vector<QVector3D>& vertices,
                      std::vector<int>& vertexCnts) const {
-        printf("draw Circle: 256 vertices...\n");
+        OASIS_TRACE(TRACE_RECORD, "draw Circle: " << circle_vertex_count << " vertices..." << std::endl);
         coord_type x = bg::get<0>(getCenter());
         coord_type y = bg::get<1>(getCenter());
         double theta = 2*PI / circle_vertex_count;
@@ -86,6 +86,8 @@ public:
 }; // class Circle
 
 typedef Circle<dPoint> dCircle;
+typedef Circle<iPoint> iCircle;
+typedef Circle<lPoint> lCircle;
 
 } // namespace layout
 
@@ -2,19 +2,41 @@
 // SPDX-License-Identifier: LicenseRef-Qt-Commercial OR BSD-3-Clause
 
 #include "geometryengine.hpp"
+#include "triangulate.hpp"
 
 #include <QVector2D>
 #include <QVector3D>
 
+// the uploaded region extends this many view widths/heights past each side
+// of the view, so panning does not re-upload on every frame.
+static const double regionMargin = 1.0;
+// re-upload (and cull again) once the view shrinks below this fraction of
+// the uploaded region.
+static const double minViewFraction = 1.0 / 16.0;
+
+// a world region in database units, grown to whole DBU and clamped to the coordinate range.
+static layout::iBox toLayoutBox(const layout::dBox& r) {
+    if (!r.isValid())
+        return layout::iBox(0, 0, 0, 0);
+    typedef layout::iPoint::coord_type coord_type;
+    auto clamp = [](double v) {
+        v = std::max(v, (double)std::numeric_limits<coord_type>::lowest());
+        v = std::min(v, (double)std::numeric_limits<coord_type>::max());
+        return (coord_type)v;
+    };
+    return layout::iBox(clamp(std::floor(r.getMinX())), clamp(std::floor(r.getMinY())),
+                        clamp(std::ceil(r.getMaxX())), clamp(std::ceil(r.getMaxY())));
+}
+
 
-GeometryEngine::GeometryEngine(const layout::dLayoutManager& _layM)
+GeometryEngine::GeometryEngine(const layout::iLayoutManager& _layM)
     : layM(_layM)
 {
     initializeOpenGLFunctions();
 
     // Generate 2 VBOs
     arrayBuf.create();
-    colorBuf.create();
+    indexBuf.create();
 
     // Initializes layout geometries and transfers it to VBOs
     initLayoutGeometries();
@@ -22,37 +44,169 @@ GeometryEngine::GeometryEngine(const layout::dLayoutManager& _layM)
 
 GeometryEngine::~GeometryEngine() {
     arrayBuf.destroy();
-    colorBuf.destroy();
+    indexBuf.destroy();
 }
 
 void GeometryEngine::initLayoutGeometries() {
-    const layout::dLayout* activeLayout = getLayoutManager().getActiveLayout();
+    const layout::iLayout* activeLayout = getLayoutManager().getActiveLayout();
     if (activeLayout) {
-        printf("initLayoutGeometries: activeLayout=%s...\n", activeLayout->getName().c_str());
-        int verCnt = activeLayout->getVertexCount();
+        OASIS_TRACE(TRACE_SUMMARY, "initLayoutGeometries: activeLayout=" << activeLayout->getName() << "..." << std::endl);
+        // no reserve from the layout's vertex count: that would load every
+        // cell of a lazily opened file, drawn or not.
         std::vector<QVector3D> vertices;
-        vertices.reserve(verCnt);
-        std::vector<QVector4D> colors;
-        colors.reserve(verCnt);
         getVertexCounts().clear();
-        activeLayout->getVerticesAndColors(vertices, colors, getVertexCounts());
+        layerRanges.clear();
+
+        // triangles are collected per (layer number, datatype), so a layer used
+        // by several cells is still a single draw call. names are not unique:
+        // a LAYERNAME range gives many pairs the same one. the layout sets the
+        // color and visibility of a pair in every cell alike.
+        typedef std::pair<int, int> tLayerKey;
+        std::map<tLayerKey, std::vector<uint32_t> > layerIndices;
+        std::map<tLayerKey, const layout::iLayer*> layerOf;
+        layout::iBox r = toLayoutBox(getRegion());
+        // placed cells are drawn through their parents, once per placement.
+        layout::iLayout::tCells::const_iterator cit = activeLayout->getCells().begin();
+        for (; cit != activeLayout->getCells().end(); ++cit) {
+            const layout::iCell* cell = cit->second;
+            if (cell->getParentCount() > 0)
+                continue;
+            if (r.isValid() && !r.intersects(cell->getBBox()))
+                continue;
+            cell->visitLayers(r, layout::Transform(),
+                [&](const layout::iLayer* layer, const layout::Transform& t, const layout::iBox& local) {
+                    std::size_t firstShape = getVertexCounts().size();
+                    uint32_t base = (uint32_t)vertices.size();
+                    // the layer's spatial index limits this to the shapes inside region.
+                    layer->getVertices(local, vertices, getVertexCounts());
+                    t.apply(vertices, base);
+                    tLayerKey key(layer->getLayerNum(), layer->getDataType());
+                    layerOf.insert(std::make_pair(key, layer));
+                    std::vector<uint32_t>& indices = layerIndices[key];
+                    for (std::size_t s = firstShape; s < getVertexCounts().size(); ++s) {
+                        int cnt = getVertexCounts()[s];
+                        layout::triangulate(&vertices[base], cnt, base, indices);
+                        base += cnt;
+                    }
+                });
+        }
+
+        std::vector<uint32_t> indices;
+        std::map<tLayerKey, std::vector<uint32_t> >::const_iterator iit = layerIndices.begin();
+        for (; iit != layerIndices.end(); ++iit) {
+            if (iit->second.empty())
+                continue;
+            const layout::iLayer* layer = layerOf[iit->first];
+            layerRanges.push_back({layer->getName(), layer,
+                                   (int)indices.size(), (int)iit->second.size()});
+            indices.insert(indices.end(), iit->second.begin(), iit->second.end());
+        }
+
+        shapesDrawn = (int)getVertexCounts().size();
+        // cells that are not loaded yet were culled without being counted.
+        // a cell placed many times can draw more shapes than it holds.
+        int shapesLoaded = 0;
+        for (cit = activeLayout->getCells().begin(); cit != activeLayout->getCells().end(); ++cit) {
+            if (cit->second->isLoaded())
+                shapesLoaded += cit->second->getShapeCount();
+        }
+        shapesCulled = std::max(0, shapesLoaded - shapesDrawn);
+        uploadedLayout = activeLayout;
+        uploadedGeneration = activeLayout->getGeneration();
+        OASIS_TRACE(TRACE_SUMMARY, "shapes drawn=" << shapesDrawn << ", culled=" << shapesCulled << std::endl);
 
         // Transfer vertex data to VBO 0
         arrayBuf.bind();
         //arrayBuf.setUsagePattern(QGLBuffer::DynamicDraw);
-        arrayBuf.allocate(vertices.data(), verCnt * sizeof(QVector3D));
+        arrayBuf.allocate(vertices.data(), (int)(vertices.size() * sizeof(QVector3D)));
+
+        // Transfer triangle indices to VBO 1
+        indexBuf.bind();
+        indexBuf.allocate(indices.data(), (int)(indices.size() * sizeof(uint32_t)));
+    }
+}
+
+void GeometryEngine::setViewMatrix(const QMatrix4x4& mvp) {
+    // an invalid box (the default) means everything is visible.
+    layout::dBox visible(0.0, 0.0, 0.0, 0.0);
+    bool invertible = false;
+    QMatrix4x4 inv = mvp.inverted(&invertible);
+    if (invertible) {
+        // unproject the rays through the four viewport corners and
+        // intersect them with the plane the layout is drawn in.
+        double minX = 0.0, minY = 0.0, maxX = 0.0, maxY = 0.0;
+        bool onPlane = true;
+        for (int i = 0; i < 4 && onPlane; ++i) {
+            float x = (i & 1) ? 1.0f : -1.0f;
+            float y = (i & 2) ? 1.0f : -1.0f;
+            QVector3D nearPt = (inv * QVector4D(x, y, -1.0f, 1.0f)).toVector3DAffine();
+            QVector3D farPt = (inv * QVector4D(x, y, 1.0f, 1.0f)).toVector3DAffine();
+            float dz = farPt.z() - nearPt.z();
+            if (qFuzzyIsNull(dz)) {
+                onPlane = false;
+                break;
+            }
+            float t = (layout::pointZval - nearPt.z()) / dz;
+            QVector3D hit = nearPt + (farPt - nearPt) * t;
+            if (i == 0) {
+                minX = maxX = hit.x();
+                minY = maxY = hit.y();
+            } else {
+                minX = std::min(minX, (double)hit.x());
+                minY = std::min(minY, (double)hit.y());
+                maxX = std::max(maxX, (double)hit.x());
+                maxY = std::max(maxY, (double)hit.y());
+            }
+        }
+        if (onPlane) {
+            visible = layout::dBox(minX, minY, maxX, maxY);
+        }
+    }
+    viewRegion = visible;
+}
+
+bool GeometryEngine::regionCovers(const layout::dBox& view) const {
+    if (!view.isValid())
+        return !getRegion().isValid();
+    if (getRegion().isValid() && !getRegion().contains(view))
+        return false;
+    // zoomed far into what is uploaded: worth culling again.
+    layout::dBox uploaded = getRegion();
+    if (!uploaded.isValid() && getLayoutManager().getActiveLayout())
+        uploaded = layout::dBox(getLayoutManager().getActiveLayout()->getBBox());
+    return view.getWidth() * view.getHeight() >=
+           uploaded.getWidth() * uploaded.getHeight() * minViewFraction;
+}
 
-        // Transfer vertex color data to VBO 1
-        colorBuf.bind();
-        colorBuf.allocate(colors.data(), verCnt * sizeof(QVector4D));
+void GeometryEngine::updateLayoutGeometries() {
+    const layout::iLayout* activeLayout = getLayoutManager().getActiveLayout();
+    if (!activeLayout)
+        return;
+    bool contentChanged = activeLayout != uploadedLayout ||
+                          activeLayout->getGeneration() != uploadedGeneration;
+    if (!contentChanged && regionCovers(getViewRegion()))
+        return;
+
+    const layout::dBox& view = getViewRegion();
+    if (view.isValid()) {
+        double dx = view.getWidth() * regionMargin;
+        double dy = view.getHeight() * regionMargin;
+        setRegion(layout::dBox(view.getMinX() - dx, view.getMinY() - dy,
+                               view.getMaxX() + dx, view.getMaxY() + dy));
+    } else {
+        setRegion(view);
     }
+    initLayoutGeometries();
 }
 
 void GeometryEngine::drawLayoutGeometries(QOpenGLShaderProgram* program) {
-    const layout::dLayout* activeLayout = getLayoutManager().getActiveLayout();
+    const layout::iLayout* activeLayout = getLayoutManager().getActiveLayout();
     if (!activeLayout)
         return;
-    printf("drawLayoutGeometries: activeLayout=%s...\n", activeLayout->getName().c_str());
+    OASIS_TRACE(TRACE_SUMMARY, "drawLayoutGeometries: activeLayout=" << activeLayout->getName() << "..." << std::endl);
+
+    // content changed or the view left the uploaded region.
+    updateLayoutGeometries();
 
     // Tell OpenGL which VBOs to use
     arrayBuf.bind();
@@ -63,13 +217,8 @@ void GeometryEngine::drawLayoutGeometries(QOpenGLShaderProgram* program) {
     // setAttributeBuffer(int location, GLenum type, int offset, int tupleSize, int stride = 0)
     program->setAttributeBuffer(vertexLocation, GL_FLOAT, 0, 3, sizeof(QVector3D));
 
-    // Tell OpenGL which VBOs to use
-    colorBuf.bind();
-
-    // Tell OpenGL programmable pipeline how to locate vetex color data
-    int colorLocation = program->attributeLocation("a_color");
-    program->enableAttributeArray(colorLocation);
-    program->setAttributeBuffer(colorLocation, GL_FLOAT, 0, 4, sizeof(QVector4D));
+    // Layer colors are a uniform, set per draw call below
+    int colorLocation = program->uniformLocation("u_color");
 #if 0
     // Tell OpenGL programmable pipeline how to locate vertex texture coordinate data
     int texcoordLocation = program->attributeLocation("a_texcoord");
@@ -78,17 +227,14 @@ void GeometryEngine::drawLayoutGeometries(QOpenGLShaderProgram* program) {
     program->setAttributeBuffer(texcoordLocation, GL_FLOAT, 0, 3);
 #endif
 
-    // Draw layout geometry using indices from VBO 1
-    //glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-#if 0
-    glDrawArrays(GL_POLYGON, 0, 6);
-    glDrawArrays(GL_POLYGON, 6, 4);
-#else
-    std::vector<int>::const_iterator it = getVertexCounts().begin();
-    int first = 0;
-    for (; it != getVertexCounts().end(); ++it) {
-        glDrawArrays(GL_POLYGON, first, *it);
-        first += *it;
+    // Draw layout geometry using indices from VBO 1, one call per layer
+    indexBuf.bind();
+    std::vector<LayerRange>::const_iterator it = getLayerRanges().begin();
+    for (; it != getLayerRanges().end(); ++it) {
+        if (!it->layer->isVisible())
+            continue;
+        program->setUniformValue(colorLocation, it->layer->getColor());
+        glDrawElements(GL_TRIANGLES, it->count, GL_UNSIGNED_INT,
+                       (const void*)(it->first * sizeof(uint32_t)));
     }
-#endif
 }
@@ -6,6 +6,7 @@
 
 #include "layoutManager.hpp"
 
+#include <QMatrix4x4>
 #include <QOpenGLFunctions>
 #include <QOpenGLShaderProgram>
 #include <QOpenGLBuffer>
@@ -14,10 +15,19 @@
 class GeometryEngine : protected QOpenGLFunctions
 {
 public:
-    GeometryEngine(const layout::dLayoutManager& _layM);
+    /// triangles of one layer in the index buffer, drawn with a single glDrawElements.
+    /// color and visibility are read from layer at draw time.
+    struct LayerRange {
+        std::string name;
+        const layout::iLayer* layer;
+        int first;      // first index
+        int count;      // number of indices
+    };
+
+    GeometryEngine(const layout::iLayoutManager& _layM);
     virtual ~GeometryEngine();
 
-    const layout::dLayoutManager& getLayoutManager() const {
+    const layout::iLayoutManager& getLayoutManager() const {
         return layM;
     }
 
@@ -27,15 +37,54 @@ public:
     const std::vector<int>& getVertexCounts() const {
         return vertexCnts;
     }
+    const std::vector<LayerRange>& getLayerRanges() const {
+        return layerRanges;
+    }
     void drawLayoutGeometries(QOpenGLShaderProgram *program);
 
+    /// regenerate the vertices and triangles and upload them to the VBOs.
     void initLayoutGeometries();
+    /// upload only if the layout's content changed or the view left the uploaded region.
+    void updateLayoutGeometries();
+
+    /// world region whose shapes get uploaded. an invalid box uploads everything.
+    const layout::dBox& getRegion() const {
+        return region;
+    }
+    void setRegion(const layout::dBox& r) {
+        region = r;
+    }
+
+    /// track what the modelview-projection matrix shows. the next draw re-uploads
+    /// when the visible region is no longer covered by the uploaded one.
+    void setViewMatrix(const QMatrix4x4& mvp);
+    const layout::dBox& getViewRegion() const {
+        return viewRegion;
+    }
+
+    /// shapes uploaded by the last initLayoutGeometries(), and those left out by the region.
+    int getDrawnShapeCount() const {
+        return shapesDrawn;
+    }
+    int getCulledShapeCount() const {
+        return shapesCulled;
+    }
 
 private:
+    bool regionCovers(const layout::dBox& view) const;
+
     QOpenGLBuffer arrayBuf;
-    QOpenGLBuffer colorBuf;
+    QOpenGLBuffer indexBuf{QOpenGLBuffer::IndexBuffer};
     std::vector<int> vertexCnts;
-    const layout::dLayoutManager& layM;
+    std::vector<LayerRange> layerRanges;
+    const layout::iLayoutManager& layM;
+    layout::dBox region{0.0, 0.0, 0.0, 0.0};
+    layout::dBox viewRegion{0.0, 0.0, 0.0, 0.0};
+    // what the VBOs were last built from.
+    const layout::iLayout* uploadedLayout = nullptr;
+    unsigned long uploadedGeneration = 0;
+    int shapesDrawn = 0;
+    int shapesCulled = 0;
 };
 
 #endif // __GEOMETRYENGINE_H
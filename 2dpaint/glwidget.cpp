@@ -10,7 +10,7 @@ float fov = 60.0;
 QRubberBand *rubberBand = nullptr;
 
 
-GLWidget::GLWidget(const layout::dLayoutManager &_layM, QWidget *parent)
+GLWidget::GLWidget(const layout::iLayoutManager &_layM, QWidget *parent)
     : QOpenGLWidget(parent)
     , layM(_layM)
     , background(QColor(0, 0, 0, 0))
@@ -34,9 +34,9 @@ GLWidget::~GLWidget() {
 }
 
 const layout::dBox& GLWidget::getViewBox() {
-    const layout::dLayout* activeLayout = getLayoutManager().getActiveLayout();
+    const layout::iLayout* activeLayout = getLayoutManager().getActiveLayout();
     if (activeLayout) {
-        viewBBox = activeLayout->getBBox();
+        viewBBox = layout::dBox(activeLayout->getBBox());
         double w = width();
         w = (w) ?w :1.0;
         double h = height();
@@ -269,12 +269,9 @@ void GLWidget::initShaders()
     #version 330
     uniform mat4 mvp_matrix;
     attribute vec4 a_position;
-    attribute vec4 a_color;
-    out vec4 attrib_fragment_color;
     void main()
     {
         gl_Position = mvp_matrix * a_position;
-        attrib_fragment_color = a_color;
     }
     )glsl";
     if (!program.addShaderFromSourceCode(QOpenGLShader::Vertex, vShaderSource))
@@ -288,10 +285,10 @@ void GLWidget::initShaders()
 #else
     const char fShaderSource[] = R"glsl(
     #version 330
-    in vec4 attrib_fragment_color;
+    uniform vec4 u_color;
     void main()
     {
-        gl_FragColor = attrib_fragment_color;
+        gl_FragColor = u_color;
     }
     )glsl";
     if (!program.addShaderFromSourceCode(QOpenGLShader::Fragment, fShaderSource))
@@ -341,7 +338,8 @@ void GLWidget::resizeGL(int w, int h)
 
 void GLWidget::paintGL()
 {
-    printf("paintGL...\n");
+    OASIS_TRACE(TRACE_SUMMARY, "paintGL..." << std::endl);
+    OASIS_COUNT(FramesDrawn, 1);
     // Clear color and depth buffer
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -355,7 +353,11 @@ void GLWidget::paintGL()
     matrix *= model;
 
     // Set modelview-projection matrix
-    program.setUniformValue("mvp_matrix", projection * matrix);
+    QMatrix4x4 mvp = projection * matrix;
+    program.setUniformValue("mvp_matrix", mvp);
+
+    // Only upload and draw what falls inside the viewport
+    geometries->setViewMatrix(mvp);
 
     // Use texture unit 0 which contains cube.png
     program.setUniformValue("texture", 0);
@@ -42,11 +42,11 @@ public:
 
     typedef double coord_type;
 
-    GLWidget(const layout::dLayoutManager& layM, QWidget* parent);
+    GLWidget(const layout::iLayoutManager& layM, QWidget* parent);
 
     virtual ~GLWidget();
 
-    const layout::dLayoutManager& getLayoutManager() const {
+    const layout::iLayoutManager& getLayoutManager() const {
         return layM;
     }
 
@@ -124,13 +124,6 @@ public slots:
         return geometries;
     }
 
-    void update() {
-        if(getGeometry()) {
-            getGeometry()->initLayoutGeometries();
-        }
-        QOpenGLWidget::update();
-    }
-
 protected:
     void mousePressEvent(QMouseEvent *e) override;
     void mouseMoveEvent(QMouseEvent *e) override;
@@ -138,11 +131,11 @@ protected:
     void timerEvent(QTimerEvent *e) override;
 
     QVector3D getEyeCoords() {
-        const layout::dLayout* activeLayout = getLayoutManager().getActiveLayout();
+        const layout::iLayout* activeLayout = getLayoutManager().getActiveLayout();
         double dist = 1.0;
         layout::dPoint ctr(0.0, 0.0);
         if (activeLayout) {
-            layout::dBox vbox = activeLayout->getBBox();
+            layout::dBox vbox(activeLayout->getBBox());
             vbox *= 1.01;
             ctr = vbox.center();
             dist = std::max(vbox.getWidth(), vbox.getHeight());
@@ -204,7 +197,7 @@ private:
     qreal angularSpeed = 0;
     QQuaternion rotation;
 
-    const layout::dLayoutManager& layM;
+    const layout::iLayoutManager& layM;
     QColor background;
     layout::dBox viewBBox{std::numeric_limits<coord_type>::min(),
                           std::numeric_limits<coord_type>::min(),
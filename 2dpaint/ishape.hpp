@@ -7,8 +7,11 @@
 #include <boost/geometry/geometries/register/point.hpp>
 
 #include <array>
+#include <cstdint>
 #include <vector>
 
+#include "trace.hpp"
+
 #include <QVector3D>
 #include <QVector4D>
 
@@ -124,6 +127,9 @@ public:
 }; // class Point2
 
 typedef Point2<double> dPoint;
+/// integer database units, as stored in OASIS. lPoint for layouts beyond +-2^31 DBU.
+typedef Point2<int32_t> iPoint;
+typedef Point2<int64_t> lPoint;
 
 } // namespace layout
 
@@ -160,6 +166,8 @@ struct access<layout::Point2<T>, Index> {
 }}} // namespace boost::geometry::traits
 #else
 BOOST_GEOMETRY_REGISTER_POINT_2D_GET_SET(layout::dPoint, double, bg::cs::cartesian, x, y, setX, setY)
+BOOST_GEOMETRY_REGISTER_POINT_2D_GET_SET(layout::iPoint, int32_t, bg::cs::cartesian, x, y, setX, setY)
+BOOST_GEOMETRY_REGISTER_POINT_2D_GET_SET(layout::lPoint, int64_t, bg::cs::cartesian, x, y, setX, setY)
 #endif
 
 namespace layout {
@@ -171,6 +179,8 @@ class Box;
 #define CIRCLE 2
 #define POLYGON 3
 #define TRAPEZOID 4
+#define REPEATED 5
+#define PATH 6
 
 template<typename pointT>
 class iShape {
@@ -179,6 +189,8 @@ public:
     typedef Box<pointT> tBox;
 
 public:
+    virtual ~iShape() {}
+
     /// construct shape's bounding box.
     virtual const tBox& computeBBox() = 0;
     /// return shape's bounding box.
@@ -2,12 +2,25 @@
 #define __LAYOUT_LAYER_HPP__
 
 
+#include "arena.hpp"
 #include "box.hpp"
-
+#include "property.hpp"
+#include "rects.hpp"
+#include "repetition.hpp"
+#include "text.hpp"
+
+#include <map>
+#include <memory>
+#include <unordered_map>
 #include <unordered_set>
 #include <string>
 #include <QColor>
 
+#include <boost/geometry/index/rtree.hpp>
+#include <boost/iterator/function_output_iterator.hpp>
+
+namespace bgi = boost::geometry::index;
+
 
 namespace layout {
 
@@ -16,9 +29,27 @@ class Layer {
 public:
     typedef typename pointT::coord_type coord_type;
     typedef std::unordered_set<iShape<pointT>*> tShapes;
+    typedef bg::model::box<pointT> tIndexBox;
+    typedef std::pair<tIndexBox, iShape<pointT>*> tIndexValue;
+    typedef bgi::rtree<tIndexValue, bgi::quadratic<16> > tIndex;
+    typedef std::pair<tIndexBox, std::size_t> tRectIndexValue;
+    typedef bgi::rtree<tRectIndexValue, bgi::quadratic<16> > tRectIndex;
 
 protected:
     tShapes shapes;
+    /// rectangles added with addRect. not part of shapes.
+    Rects<pointT> rects;
+    /// labels added with addText, by string number in the layout's TextPool.
+    std::vector<Text<pointT> > texts;
+    /// properties of the shapes that have any. rects carry none.
+    std::unordered_map<const iShape<pointT>*, Properties> properties;
+    /// spatial index over the shapes' bounding boxes. built by the first query,
+    /// then kept up to date by addShape/deleteShape.
+    std::unique_ptr<tIndex> index;
+    /// same for rects, by rectangle index.
+    std::unique_ptr<tRectIndex> rectIndex;
+    /// the owning layout's shape arena. null allocates shapes with new.
+    Arena* arena;
     int layerNum;
     int dataT;
     QColor lyrColor;
@@ -28,10 +59,15 @@ protected:
                      std::numeric_limits<coord_type>::min(),
                      std::numeric_limits<coord_type>::min()};
     int vertexCnt;
+    /// bumped by every change to the layer's shapes. color and visibility
+    /// are drawn as uniforms and don't count.
+    unsigned long generation = 0;
+    bool visible = true;
 
 public:
-    Layer(int n, int d, const QColor& clr)
-        : layerNum(n)
+    Layer(int n, int d, const QColor& clr, Arena* a = nullptr)
+        : arena(a)
+        , layerNum(n)
         , dataT(d)
         , lyrColor(clr)
         , layerName(makeLayerName(n, d))
@@ -41,7 +77,7 @@ public:
     virtual ~Layer() {
         typename tShapes::iterator it = getShapes().begin();
         for(; it != getShapes().end(); ++it) {
-            delete *it;
+            destroyShape(*it);
         }
     }
 
@@ -52,6 +88,12 @@ public:
         for(; it != shapes.end(); ++it) {
             (*it)->print(prefix + "  ");
         }
+        for (std::size_t i = 0; i < rects.size(); ++i) {
+            rects.getBox(i).print(prefix + "  ");
+        }
+        for (std::size_t i = 0; i < texts.size(); ++i) {
+            std::cout << prefix << "  Text (" << texts[i].x << ", " << texts[i].y << ") #" << texts[i].string << std::endl;
+        }
     }
 
     tShapes& getShapes() {
@@ -61,6 +103,14 @@ public:
         return shapes;
     }
 
+    const Rects<pointT>& getRects() const {
+        return rects;
+    }
+
+    const std::vector<Text<pointT> >& getTexts() const {
+        return texts;
+    }
+
     int getLayerNum() const {
         return layerNum;
     }
@@ -98,27 +148,149 @@ public:
         getShapes().insert(shape);
         vertexCnt += shape->getVertexCount();
         bbox.makeInvalid();
+        ++generation;
+        if (index)
+            index->insert(makeIndexValue(shape));
+    }
+
+    /// construct a shape in the layout's arena (or on the heap without one) and add it.
+    template<typename shapeT, typename... Args>
+    shapeT* newShape(Args&&... args) {
+        shapeT* shape = arena ? arena->template create<shapeT>(std::forward<Args>(args)...)
+                              : new shapeT(std::forward<Args>(args)...);
+        addShape(shape);
+        return shape;
     }
 
     void deleteShape(iShape<pointT>* shape) {
         typename tShapes::iterator it = getShapes().find(shape);
         if (it != getShapes().end()) {
+            if (index)
+                index->remove(makeIndexValue(*it));
             vertexCnt -= (*it)->getVertexCount();
-            delete *it;
+            properties.erase(*it);
+            destroyShape(*it);
             getShapes().erase(it);
             bbox.makeInvalid();
+            ++generation;
         }
     }
 
-    const Box<pointT>& computeBBox() {
+    /// add an axis aligned rectangle to the rectangle arrays. returns its index.
+    std::size_t addRect(coord_type minX, coord_type minY, coord_type maxX, coord_type maxY) {
+        std::size_t i = rects.add(minX, minY, maxX, maxY);
+        vertexCnt += 4;
         bbox.makeInvalid();
+        ++generation;
+        if (rectIndex)
+            rectIndex->insert(makeRectIndexValue(i));
+        return i;
+    }
+
+    void addProperty(const iShape<pointT>* shape, const Property& property) {
+        properties[shape].push_back(property);
+    }
+    /// null if the shape has no properties.
+    const Properties* getProperties(const iShape<pointT>* shape) const {
+        typename std::unordered_map<const iShape<pointT>*, Properties>::const_iterator it = properties.find(shape);
+        return it != properties.end() ? &it->second : nullptr;
+    }
+
+    /// add a label at (x, y). string is its number in the layout's TextPool.
+    /// labels are not drawn, so neither the extent nor the generation change.
+    void addText(coord_type x, coord_type y, unsigned int string) {
+        texts.push_back(Text<pointT>{x, y, string});
+    }
+
+    /// remove rectangle i. the last rectangle takes over index i.
+    void deleteRect(std::size_t i) {
+        if (i >= rects.size())
+            return;
+        std::size_t last = rects.size() - 1;
+        if (rectIndex) {
+            rectIndex->remove(makeRectIndexValue(i));
+            if (i != last) {
+                rectIndex->remove(makeRectIndexValue(last));
+                rectIndex->insert(tRectIndexValue(makeRectIndexValue(last).first, i));
+            }
+        }
+        rects.remove(i);
+        vertexCnt -= 4;
+        bbox.makeInvalid();
+        ++generation;
+    }
+
+    unsigned long getGeneration() const {
+        return generation;
+    }
+
+    static tIndexValue makeIndexValue(iShape<pointT>* shape) {
+        const Box<pointT>& b = shape->getBBox();
+        return tIndexValue(tIndexBox(b.min_corner(), b.max_corner()), shape);
+    }
+    tRectIndexValue makeRectIndexValue(std::size_t i) const {
+        return tRectIndexValue(tIndexBox(pointT(rects.getMinX(i), rects.getMinY(i)),
+                                         pointT(rects.getMaxX(i), rects.getMaxY(i))), i);
+    }
+
+    /// bulk load the spatial index from the current shapes.
+    void buildIndex() {
+        std::vector<tIndexValue> values;
+        values.reserve(getShapes().size());
         typename tShapes::const_iterator it = getShapes().begin();
-        if (it != getShapes().end()) {
+        for (; it != getShapes().end(); ++it) {
+            values.push_back(makeIndexValue(*it));
+        }
+        index.reset(new tIndex(values.begin(), values.end()));
+
+        std::vector<tRectIndexValue> rectValues;
+        rectValues.reserve(rects.size());
+        for (std::size_t i = 0; i < rects.size(); ++i) {
+            rectValues.push_back(makeRectIndexValue(i));
+        }
+        rectIndex.reset(new tRectIndex(rectValues.begin(), rectValues.end()));
+    }
+    bool hasIndex() const {
+        return (bool)index;
+    }
+
+    /// collect the shapes whose bounding box intersects region. see queryRects for rectangles.
+    void queryRegion(const Box<pointT>& region, std::vector<iShape<pointT>*>& result) const {
+        if (!index) {
+            Layer<pointT>* This = const_cast<Layer<pointT>*>(this);
+            This->buildIndex();
+        }
+        tIndexBox query(region.min_corner(), region.max_corner());
+        index->query(bgi::intersects(query),
+                     boost::make_function_output_iterator(
+                         [&result](const tIndexValue& v) {
+                             result.push_back(v.second);
+                         }));
+    }
+
+    /// collect the indices of the rectangles intersecting region.
+    void queryRects(const Box<pointT>& region, std::vector<std::size_t>& result) const {
+        if (!rectIndex) {
+            Layer<pointT>* This = const_cast<Layer<pointT>*>(this);
+            This->buildIndex();
+        }
+        tIndexBox query(region.min_corner(), region.max_corner());
+        rectIndex->query(bgi::intersects(query),
+                         boost::make_function_output_iterator(
+                             [&result](const tRectIndexValue& v) {
+                                 result.push_back(v.second);
+                             }));
+    }
+
+    const Box<pointT>& computeBBox() {
+        bbox = rects.computeBBox();
+        typename tShapes::const_iterator it = getShapes().begin();
+        if (it != getShapes().end() && !bbox.isValid()) {
             bbox = (*it)->getBBox();
             ++it;
-            for (; it != getShapes().end(); ++it) {
-                bbox.expand((*it)->getBBox());
-            }
+        }
+        for (; it != getShapes().end(); ++it) {
+            bbox.expand((*it)->getBBox());
         }
         return bbox;
     }
@@ -137,28 +309,91 @@ public:
         lyrColor = color;
     }
 
+    bool isVisible() const {
+        return visible;
+    }
+    void setVisible(bool v) {
+        visible = v;
+    }
+
     int getVertexCount() const {
         return vertexCnt;
     }
 
-    void getVerticesAndColors(std::vector<QVector3D>& vertices,
-                     std::vector<QVector4D>& colors,
+    int getShapeCount() const {
+        return (int)(getShapes().size() + rects.size());
+    }
+
+    void getVertices(std::vector<QVector3D>& vertices,
                      std::vector<int>& vertexCnts) const {
-        printf("draw Layer %s: %d vertices...\n", getName().c_str(), getVertexCount());
+        OASIS_TRACE(TRACE_SUMMARY, "draw Layer " << getName() << ": " << getVertexCount() << " vertices..." << std::endl);
+        OASIS_COUNT(VerticesGenerated, getVertexCount());
+        rects.getVertices(vertices, vertexCnts);
         typename tShapes::const_iterator it = getShapes().begin();
         for (; it != getShapes().end(); ++it) {
             (*it)->getVertices(vertices, vertexCnts);
-            for (int i=0; i<vertexCnts.back(); ++i) {
-                colors.emplace_back(lyrColor.redF(),
-                                    lyrColor.greenF(),
-                                    lyrColor.blueF(),
-                                    lyrColor.alphaF());
-            }
         }
     }
+
+    /// same as above for the shapes intersecting region only. an invalid region means all shapes.
+    void getVertices(const Box<pointT>& region,
+                     std::vector<QVector3D>& vertices,
+                     std::vector<int>& vertexCnts) const {
+        if (!region.isValid()) {
+            getVertices(vertices, vertexCnts);
+            return;
+        }
+        std::vector<iShape<pointT>*> visible;
+        queryRegion(region, visible);
+        std::vector<std::size_t> visibleRects;
+        queryRects(region, visibleRects);
+        OASIS_TRACE(TRACE_SUMMARY, "draw Layer " << getName() << ": " << visible.size() + visibleRects.size()
+                                   << " of " << getShapeCount() << " shapes in region..." << std::endl);
+        std::size_t first = vertices.size();
+        rects.getVertices(visibleRects, vertices, vertexCnts);
+        typename std::vector<iShape<pointT>*>::const_iterator it = visible.begin();
+        for (; it != visible.end(); ++it) {
+            // an array is indexed as a whole; its copies are culled one by one.
+            if ((*it)->getShapeType() == REPEATED)
+                static_cast<const RepeatedShape<pointT>*>(*it)->getVertices(region, vertices, vertexCnts);
+            else
+                (*it)->getVertices(vertices, vertexCnts);
+        }
+        OASIS_COUNT(VerticesGenerated, vertices.size() - first);
+    }
+protected:
+    /// arena shapes are only destructed; their memory goes with the arena.
+    void destroyShape(iShape<pointT>* shape) {
+        if (arena && arena->owns(shape))
+            shape->~iShape();
+        else
+            delete shape;
+    }
 }; // class Layer
 
+/// color and visibility set for a whole layout per (layer number, datatype).
+/// layers made later, e.g. by a lazily opened cell, take them on.
+struct LayerStyles {
+    typedef std::pair<int, int> tKey;
+    std::map<tKey, QColor> colors;
+    std::map<tKey, bool> visible;
+
+    /// give layer what was set for its pair, if anything.
+    template<typename pointT>
+    void apply(Layer<pointT>& layer) const {
+        tKey key(layer.getLayerNum(), layer.getDataType());
+        std::map<tKey, QColor>::const_iterator cit = colors.find(key);
+        if (cit != colors.end())
+            layer.setColor(cit->second);
+        std::map<tKey, bool>::const_iterator vit = visible.find(key);
+        if (vit != visible.end())
+            layer.setVisible(vit->second);
+    }
+};
+
 typedef Layer<dPoint> dLayer;
+typedef Layer<iPoint> iLayer;
+typedef Layer<lPoint> lLayer;
 
 } // namespace layout
 
@@ -17,15 +17,32 @@ protected:
     std::string layoutName;
     tCells cells;
     Cell<pointT>* activeCell;
+    /// shapes made with Layer::newShape live here and are freed in bulk
+    /// when the layout goes away.
+    std::unique_ptr<Arena> arena;
+    /// one more arena per reader thread, see newArena().
+    std::vector<std::unique_ptr<Arena> > threadArenas;
+    /// the strings of every cell's labels. see Layer::addText.
+    TextPool texts;
+    /// file level properties, e.g. S_TOP_CELL.
+    Properties properties;
+    /// layer colors and visibility set with setLayerColor/setLayerVisible.
+    LayerStyles styles;
     Box<pointT> bbox{std::numeric_limits<coord_type>::min(),
                      std::numeric_limits<coord_type>::min(),
                      std::numeric_limits<coord_type>::min(),
                      std::numeric_limits<coord_type>::min()};
+    /// bumped when cells are added or removed. see Cell::generation.
+    unsigned long generation = 0;
+    /// database units per micron (the START record unit). coordinates are
+    /// kept in DBU; the unit is only applied for display.
+    double unit = 1000.0;
 
 public:
-    Layout(const std::string& name)
+    Layout(const std::string& name, bool useArena = true)
         : layoutName(name)
         , activeCell(nullptr)
+        , arena(useArena ? new Arena() : nullptr)
     {
         cells.clear();
         bbox.makeInvalid();
@@ -58,7 +75,7 @@ public:
     }
 
     Cell<pointT>* newCell(const std::string& name) {
-        std::cout << "Start New Cell" << std::endl;
+        OASIS_TRACE(TRACE_RECORD, "Start New Cell" << std::endl);
         typename tCells::const_iterator it = getCells().find(name);
         if (it != cells.end()) {
             //std::stringstream str("Cell ");
@@ -66,14 +83,27 @@ public:
             //throw std::runtime_error(str.str().c_str());
             return it->second;
         } else {
-            Cell<pointT>* cell = new Cell<pointT>(name);
+            Cell<pointT>* cell = new Cell<pointT>(name, arena.get(), &styles);
             getCells().insert(std::make_pair(name, cell));
             activeCell = cell;
             bbox.makeInvalid();
+            ++generation;
             return cell;
         }
     }
 
+    /// take over a cell built outside the layout, e.g. by a reader thread.
+    /// returns false, leaving the cell to the caller, if the name is taken.
+    bool adoptCell(Cell<pointT>* cell) {
+        if (!getCells().insert(std::make_pair(cell->getName(), cell)).second)
+            return false;
+        cell->setLayerStyles(&styles);
+        activeCell = cell;
+        bbox.makeInvalid();
+        ++generation;
+        return true;
+    }
+
     Cell<pointT>* getCell(const std::string& name) {
         typename tCells::iterator it = getCells().find(name);
         if (it != cells.end())
@@ -88,11 +118,20 @@ public:
         return nullptr;
     }
 
+    /// placements of the cell go with it.
     void delCell(const std::string& name) {
         typename tCells::iterator it = getCells().find(name);
         if (it != getCells().end()) {
+            typename tCells::iterator pit = getCells().begin();
+            for (; pit != getCells().end(); ++pit) {
+                pit->second->delPlacements(it->second);
+            }
+            while (!it->second->getPlacements().empty()) {
+                it->second->delPlacements(it->second->getPlacements().front().getCell());
+            }
             if (activeCell == it->second)
                 activeCell = nullptr;
+            generation += it->second->getGeneration() + 1;
             delete it->second;
             getCells().erase(it);
             bbox.makeInvalid();
@@ -122,14 +161,59 @@ public:
         layoutName = name;
     }
 
+    /// null when the layout was created without an arena.
+    const Arena* getArena() const {
+        return arena.get();
+    }
+
+    /// a further arena owned by the layout, for cells filled on another
+    /// thread (Arena is not thread safe). null when the layout has no arena.
+    Arena* newArena() {
+        if (!arena)
+            return nullptr;
+        threadArenas.emplace_back(new Arena());
+        return threadArenas.back().get();
+    }
+
+    Properties& getProperties() {
+        return properties;
+    }
+    const Properties& getProperties() const {
+        return properties;
+    }
+
+    TextPool& getTextPool() {
+        return texts;
+    }
+    const TextPool& getTextPool() const {
+        return texts;
+    }
+
+    double getUnit() const {
+        return unit;
+    }
+    void setUnit(double u) {
+        unit = u;
+    }
+    /// a DBU coordinate or length in microns.
+    double toMicrons(coord_type v) const {
+        return v / unit;
+    }
+
+    /// extent of the top cells. placed cells are inside their parents' boxes.
     const Box<pointT>& computeBBox() {
+        bbox.makeInvalid();
         typename tCells::const_iterator it = cells.begin();
-        if (it != getCells().end()) {
-            bbox = it->second->getBBox();
-            ++it;
-        }
         for (; it != getCells().end(); ++it) {
-            bbox.expand(it->second->getBBox());
+            if (it->second->getParentCount() > 0)
+                continue;
+            const Box<pointT>& box = it->second->getBBox();
+            if (!box.isValid())
+                continue;
+            if (bbox.isValid())
+                bbox.expand(box);
+            else
+                bbox = box;
         }
         return bbox;
     }
@@ -151,18 +235,94 @@ public:
         return cnt;
     }
 
-    void getVerticesAndColors(std::vector<QVector3D>& vertices,
-                     std::vector<QVector4D>& colors,
+    /// changes whenever anything drawn from this layout changes.
+    unsigned long getGeneration() const {
+        unsigned long gen = generation;
+        typename tCells::const_iterator it = cells.begin();
+        for (; it != cells.end(); ++it) {
+            gen += it->second->getGeneration();
+        }
+        return gen;
+    }
+
+    int getShapeCount() const {
+        int cnt = 0;
+        typename tCells::const_iterator it = cells.begin();
+        for (; it != cells.end(); ++it) {
+            cnt += it->second->getShapeCount();
+        }
+        return cnt;
+    }
+
+    /// vertices of the top cells, placed cells included.
+    void getVertices(std::vector<QVector3D>& vertices,
                      std::vector<int>& vertexCnts) const {
-        printf("draw layout=%s. %d vertices...\n", getName().c_str(), getVertexCount());
+        OASIS_TRACE(TRACE_SUMMARY, "draw layout=" << getName() << ". " << getVertexCount() << " vertices..." << std::endl);
         typename tCells::const_iterator it = cells.begin();
         for (; it != cells.end(); ++it) {
-            it->second->getVerticesAndColors(vertices, colors, vertexCnts);
+            if (it->second->getParentCount() > 0)
+                continue;
+            it->second->getVertices(vertices, vertexCnts);
+        }
+    }
+
+    /// vertices of the shapes intersecting region. an invalid region means all shapes.
+    void getVertices(const Box<pointT>& region,
+                     std::vector<QVector3D>& vertices,
+                     std::vector<int>& vertexCnts) const {
+        OASIS_TRACE(TRACE_SUMMARY, "draw layout=" << getName() << " in region..." << std::endl);
+        typename tCells::const_iterator it = cells.begin();
+        for (; it != cells.end(); ++it) {
+            if (it->second->getParentCount() > 0)
+                continue;
+            if (region.isValid() && !region.intersects(it->second->getBBox()))
+                continue;
+            it->second->getVertices(region, vertices, vertexCnts);
+        }
+    }
+
+    /// show or hide a layer in every cell. cells that are not loaded yet
+    /// stay so; their layer takes the setting when it is made.
+    void setLayerVisible(int lyrNo, int dataT, bool visible) {
+        styles.visible[LayerStyles::tKey(lyrNo, dataT)] = visible;
+        restyleLayer(lyrNo, dataT);
+    }
+    void setLayerColor(int lyrNo, int dataT, const QColor& color) {
+        styles.colors[LayerStyles::tKey(lyrNo, dataT)] = color;
+        restyleLayer(lyrNo, dataT);
+    }
+    const LayerStyles& getLayerStyles() const {
+        return styles;
+    }
+
+    /// collect the shapes of all cells whose bounding box intersects region,
+    /// each in its own cell's coordinates.
+    void queryRegion(const Box<pointT>& region, std::vector<iShape<pointT>*>& result) const {
+        typename tCells::const_iterator it = cells.begin();
+        for (; it != cells.end(); ++it) {
+            if (!region.intersects(it->second->getBBox()))
+                continue;
+            it->second->queryRegion(region, result);
+        }
+    }
+
+protected:
+    /// apply the stored style of a pair to the cells that are loaded.
+    void restyleLayer(int lyrNo, int dataT) {
+        typename tCells::iterator it = cells.begin();
+        for (; it != cells.end(); ++it) {
+            if (!it->second->isLoaded())
+                continue;
+            Layer<pointT>* layer = it->second->getLayer(lyrNo, dataT);
+            if (layer)
+                styles.apply(*layer);
         }
     }
 }; // class Layout
 
 typedef Layout<dPoint> dLayout;
+typedef Layout<iPoint> iLayout;
+typedef Layout<lPoint> lLayout;
 
 } // namespace layout
 
@@ -11,37 +11,39 @@
 namespace layout
 {
 
-void initializeManager(dLayoutManager& layMan) {
-    dLayout* a = layMan.newLayout("./TestLayout.oas");
+void initializeManager(iLayoutManager& layMan) {
+    // coordinates are database units, 1000 per micron.
+    iLayout* a = layMan.newLayout("./TestLayout.oas");
+    a->setUnit(1000.0);
 
-    dCell* a_top = a->newCell("top");
+    iCell* a_top = a->newCell("top");
 
-    dLayer* a_0 = a_top->newLayer(0, 0, QColor("red"));
+    iLayer* a_0 = a_top->newLayer(0, 0, QColor("red"));
 #if 0
-    a_0->addShape(new dBox(-150,-100, -100,100));
-    a_0->addShape(new dBox(100,-100, 150,100));
+    a_0->addRect(-150000,-100000, -100000,100000);
+    a_0->addRect(100000,-100000, 150000,100000);
 #else
-    a_0->addShape(new dBox(dPoint(0, 0), dPoint(1, 2)));
-    std::vector<dPoint> pts = {{2, 0}, {4, 0}, {3, 1}, {2, 1}};
-    a_0->addShape(new dTrapezoid(pts, 0));
-    a_0->addShape(new dCircle(dPoint(4.5, 1.5), 1));
-    std::vector<dPoint> pts1 = {{2, 3}, {4, 3}, {6, 4}, {4, 5}, {2, 5}, {0, 4}};
-    a_0->addShape(new dPolygon(pts1));
+    a_0->addRect(0, 0, 1000, 2000);
+    std::vector<iPoint> pts = {{2000, 0}, {4000, 0}, {3000, 1000}, {2000, 1000}};
+    a_0->addShape(new iTrapezoid(pts));
+    a_0->addShape(new iCircle(iPoint(4500, 1500), 1000));
+    std::vector<iPoint> pts1 = {{2000, 3000}, {4000, 3000}, {6000, 4000}, {4000, 5000}, {2000, 5000}, {0, 4000}};
+    a_0->addShape(new iPolygon(pts1));
 #endif
 
-    dLayer* a_1 = a_top->newLayer(1, 0, QColor("green"));
+    iLayer* a_1 = a_top->newLayer(1, 0, QColor("green"));
 #if 1
-    a_1->addShape(new dBox(dPoint(1, 6), dPoint(2, 8)));
-    std::vector<dPoint> pts2 = {{3, 6}, {5, 6}, {4, 7}, {3, 7}};
-    a_1->addShape(new dTrapezoid(pts2, 0));
-    a_1->addShape(new dCircle(dPoint(5.5, 7.5), 1));
-    std::vector<dPoint> pts3 = {{3, 9}, {5, 9}, {7, 10}, {5, 11}, {3, 11}, {1, 10}};
-    a_1->addShape(new dPolygon(pts3));
+    a_1->addRect(1000, 6000, 2000, 8000);
+    std::vector<iPoint> pts2 = {{3000, 6000}, {5000, 6000}, {4000, 7000}, {3000, 7000}};
+    a_1->addShape(new iTrapezoid(pts2));
+    a_1->addShape(new iCircle(iPoint(5500, 7500), 1000));
+    std::vector<iPoint> pts3 = {{3000, 9000}, {5000, 9000}, {7000, 10000}, {5000, 11000}, {3000, 11000}, {1000, 10000}};
+    a_1->addShape(new iPolygon(pts3));
 #endif
     // add a box at the center.
-    dBox vbox = a->getBBox();
-    a_1->addShape(new dBox(vbox.center().x()-vbox.getWidth()/100.0, vbox.center().y()-vbox.getHeight()/100.0,
-                           vbox.center().x()+vbox.getWidth()/100.0, vbox.center().y()+vbox.getHeight()/100.0));
+    iBox vbox = a->getBBox();
+    a_1->addRect(vbox.center().x()-vbox.getWidth()/100, vbox.center().y()-vbox.getHeight()/100,
+                 vbox.center().x()+vbox.getWidth()/100, vbox.center().y()+vbox.getHeight()/100);
 }
 
 }
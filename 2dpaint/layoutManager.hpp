@@ -122,19 +122,20 @@ public:
             return activeLayout->getVertexCount();
         return 0;
     }
-    void getVerticesAndColors(std::vector<QVector3D>& vertices,
-                     std::vector<QVector4D>& colors,
+    void getVertices(std::vector<QVector3D>& vertices,
                      std::vector<int>& vertexCnts) const {
         if (activeLayout) {
-            activeLayout->getVerticesAndColors(vertices, colors, vertexCnts);
+            activeLayout->getVertices(vertices, vertexCnts);
         }
     }
 
 }; // class LayoutManager
 
 typedef LayoutManager<dPoint> dLayoutManager;
+typedef LayoutManager<iPoint> iLayoutManager;
+typedef LayoutManager<lPoint> lLayoutManager;
 
-void initializeManager(dLayoutManager& layM);
+void initializeManager(iLayoutManager& layM);
 
 } // namespace layout
 
@@ -1,46 +1,94 @@
 
 #include "mainwindow.hpp"
 
+#include <chrono>
+#include <filesystem>
 #include <iostream>
+#include <random>
+#include <thread>
 #include <QApplication>
 #include <QSurfaceFormat>
 #include <QTranslator>
 
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+
+/// resident set size of this process in MB.
+double residentMB() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
+    return pmc.WorkingSetSize / (1024.0*1024.0);
+#else
+    long pages = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> pages >> resident;
+    return resident * (sysconf(_SC_PAGESIZE) / (1024.0*1024.0));
+#endif
+}
+
+/// seconds since start.
+double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// write l to name, read it back into in and print the file size and both
+/// times after label.
+void writeAndRead(oasisio::OasisFileManager<layout::iPoint>& ofm, const layout::iLayout& l,
+                  const std::string& name, layout::iLayout& in, const std::string& label) {
+    auto start = std::chrono::steady_clock::now();
+    ofm.writeOasisFile(&l, name);
+    double tWrite = seconds(start);
+
+    start = std::chrono::steady_clock::now();
+    ofm.readOasisFile(name, in);
+    double tRead = seconds(start);
+
+    std::cout << label << " : " << std::filesystem::file_size(name) << " bytes, written in "
+              << tWrite << " s, read in " << tRead << " s" << std::endl;
+}
+
 
 void createOasisFile() {
 
     std::string name = "Test";
 
-    layout::Layout<layout::dPoint> layout(name);
-
-    layout::Cell<layout::dPoint>* cell1 = layout.newCell("A");
-
-    //layout::Layer<layout::dPoint>* layer1 = cell1->newLayer(1, 1, QColor("red"));
-    //layer1->addShape(new layout::Box<layout::dPoint>(0, 0, 2, 11));
-    //layer1->addShape(new layout::Box<layout::dPoint>(0, 0, 11, 2));
-    //layer1->addShape(new layout::Box<layout::dPoint>(0, 0, 6, 11));
-
-    layout::Layer<layout::dPoint>* layer2 = cell1->newLayer(2, 1, QColor("green"));
-    //std::vector<layout::dPoint> pts1 = {{2, 6}, {6, 10}, {10, 6}, {6, 2}};
-    //std::vector<layout::dPoint> pts1 = {{-162, -89}, {-187, -87}, {-170, -64}};
-    std::vector<layout::dPoint> pts1 = {{0, 30}, {0, 60}, {30, 90}, {60, 90}, {90, 60}, {90, 30}, {60, 0}, {30, 0}};
-    layer2->addShape(new layout::Polygon<layout::dPoint>(pts1));
-
-    layout::Layer<layout::dPoint>* layer3 = cell1->newLayer(3, 1, QColor("yellow"));
-    //layout::dPoint cntr1 = {6, 6};
-    //layer3->addShape(new layout::Circle<layout::dPoint>(cntr1, 2));
-    layout::dPoint cntr1 = {15, 15};
-    layer3->addShape(new layout::Circle<layout::dPoint>(cntr1, 15));
-    layout::dPoint cntr2 = {75, 15};
-    layer3->addShape(new layout::Circle<layout::dPoint>(cntr2, 15));
-    layout::dPoint cntr3 = {15, 75};
-    layer3->addShape(new layout::Circle<layout::dPoint>(cntr3, 15));
-    layout::dPoint cntr4 = {75, 75};
-    layer3->addShape(new layout::Circle<layout::dPoint>(cntr4, 15));
+    layout::Layout<layout::iPoint> layout(name);
+
+    layout::Cell<layout::iPoint>* cell1 = layout.newCell("A");
+
+    //layout::Layer<layout::iPoint>* layer1 = cell1->newLayer(1, 1, QColor("red"));
+    //layer1->addShape(new layout::Box<layout::iPoint>(0, 0, 2, 11));
+    //layer1->addShape(new layout::Box<layout::iPoint>(0, 0, 11, 2));
+    //layer1->addShape(new layout::Box<layout::iPoint>(0, 0, 6, 11));
+
+    layout::Layer<layout::iPoint>* layer2 = cell1->newLayer(2, 1, QColor("green"));
+    //std::vector<layout::iPoint> pts1 = {{2, 6}, {6, 10}, {10, 6}, {6, 2}};
+    //std::vector<layout::iPoint> pts1 = {{-162, -89}, {-187, -87}, {-170, -64}};
+    std::vector<layout::iPoint> pts1 = {{0, 30}, {0, 60}, {30, 90}, {60, 90}, {90, 60}, {90, 30}, {60, 0}, {30, 0}};
+    layer2->addShape(new layout::Polygon<layout::iPoint>(pts1));
+
+    layout::Layer<layout::iPoint>* layer3 = cell1->newLayer(3, 1, QColor("yellow"));
+    //layout::iPoint cntr1 = {6, 6};
+    //layer3->addShape(new layout::Circle<layout::iPoint>(cntr1, 2));
+    layout::iPoint cntr1 = {15, 15};
+    layer3->addShape(new layout::Circle<layout::iPoint>(cntr1, 15));
+    layout::iPoint cntr2 = {75, 15};
+    layer3->addShape(new layout::Circle<layout::iPoint>(cntr2, 15));
+    layout::iPoint cntr3 = {15, 75};
+    layer3->addShape(new layout::Circle<layout::iPoint>(cntr3, 15));
+    layout::iPoint cntr4 = {75, 75};
+    layer3->addShape(new layout::Circle<layout::iPoint>(cntr4, 15));
 
     layout.print();
 
-    oasisio::OasisFileManager<layout::dPoint> ofm;
+    oasisio::OasisFileManager<layout::iPoint> ofm;
     ofm.writeOasisFile(&layout, name + ".oas");
 
 }
@@ -74,9 +122,9 @@ int main(int argc, char *argv[])
     createOasisFile();
 
     std::string name = "Test.oas";
-    oasisio::OasisFileManager<layout::dPoint> ofm;
+    oasisio::OasisFileManager<layout::iPoint> ofm;
 
-    layout::Layout<layout::dPoint> output(name);
+    layout::Layout<layout::iPoint> output(name);
     std::ifstream ifs;
     ifs.open(name);
     ofm.readOasisFile(ifs, output);
@@ -147,19 +195,20 @@ int main(int argc, char *argv[])
 
     std::ifstream ifs;
     ifs.open(name);
-
-    unsigned int cellnameFlag = oasisio::OasisReader::fromBytesUnsigned(ifs);
-    unsigned int cellnameOffset = oasisio::OasisReader::fromBytesUnsigned(ifs);
-    unsigned int textstringFlag = oasisio::OasisReader::fromBytesUnsigned(ifs);
-    unsigned int textstringOffset = oasisio::OasisReader::fromBytesUnsigned(ifs);
-    unsigned int propnameFlag = oasisio::OasisReader::fromBytesUnsigned(ifs);
-    unsigned int propnameOffset = oasisio::OasisReader::fromBytesUnsigned(ifs);
-    unsigned int propstringFlag = oasisio::OasisReader::fromBytesUnsigned(ifs);
-    unsigned int propstringOffset = oasisio::OasisReader::fromBytesUnsigned(ifs);
-    unsigned int layernameFlag = oasisio::OasisReader::fromBytesUnsigned(ifs);
-    unsigned int layernameOffset = oasisio::OasisReader::fromBytesUnsigned(ifs);
-    unsigned int xnameFlag = oasisio::OasisReader::fromBytesUnsigned(ifs);
-    unsigned int xnameOffset = oasisio::OasisReader::fromBytesUnsigned(ifs);
+    oasisio::BufferedByteSource src(ifs);
+
+    unsigned int cellnameFlag = oasisio::OasisReader::fromBytesUnsigned(src);
+    unsigned int cellnameOffset = oasisio::OasisReader::fromBytesUnsigned(src);
+    unsigned int textstringFlag = oasisio::OasisReader::fromBytesUnsigned(src);
+    unsigned int textstringOffset = oasisio::OasisReader::fromBytesUnsigned(src);
+    unsigned int propnameFlag = oasisio::OasisReader::fromBytesUnsigned(src);
+    unsigned int propnameOffset = oasisio::OasisReader::fromBytesUnsigned(src);
+    unsigned int propstringFlag = oasisio::OasisReader::fromBytesUnsigned(src);
+    unsigned int propstringOffset = oasisio::OasisReader::fromBytesUnsigned(src);
+    unsigned int layernameFlag = oasisio::OasisReader::fromBytesUnsigned(src);
+    unsigned int layernameOffset = oasisio::OasisReader::fromBytesUnsigned(src);
+    unsigned int xnameFlag = oasisio::OasisReader::fromBytesUnsigned(src);
+    unsigned int xnameOffset = oasisio::OasisReader::fromBytesUnsigned(src);
 
     oasisio::TableOffsets out(cellnameFlag, cellnameOffset,
                        textstringFlag, textstringOffset,
@@ -170,6 +219,854 @@ int main(int argc, char *argv[])
 
     std::cout << out << std::endl;
 
+#elif 0
+
+    // Decode rate of the byte sources against the old per-byte std::ifstream::read loop.
+    std::string name = "bench_unsigned.oas";
+    const int count = 20000000;
+
+    std::ofstream ofs;
+    oasisio::OasisWriter ow(&ofs);
+    ofs.open(name, std::ios::out | std::ios::binary);
+    int i;
+    for(i=0; i<count; ++i) {
+        ow.toBytesUnsigned((unsigned int)(i * 2654435761u) >> (i % 25));
+    }
+    ow.flush();
+    ofs.close();
+
+    auto perByte = [](std::ifstream& f) {
+        oasisio::byte bytes[1] = {0};
+        unsigned int out = 0;
+        unsigned int i = -1;
+        while(true) {
+            ++i;
+            f.read((char *)bytes, 1);
+            out += ((bytes[0] & 127) << (7*i));
+            if((bytes[0] & 128) == 0 || f.eof()) {
+                break;
+            }
+        }
+        return out;
+    };
+
+    auto report = [](const char* label, std::chrono::steady_clock::time_point start, std::size_t bytes, unsigned long long sum) {
+        double sec = seconds(start);
+        std::cout << label << " : " << (bytes / (1024.0*1024.0)) / sec << " MB/s"
+                  << " (" << sec << " s, checksum " << sum << ")" << std::endl;
+    };
+
+    unsigned long long sum = 0;
+    std::size_t bytes = 0;
+    {
+        std::ifstream ifs(name, std::ios::in | std::ios::binary);
+        auto start = std::chrono::steady_clock::now();
+        for(i=0; i<count; ++i) {
+            sum += perByte(ifs);
+        }
+        bytes = (std::size_t)ifs.tellg();
+        report("std::ifstream::read per byte", start, bytes, sum);
+    }
+    {
+        std::ifstream ifs(name, std::ios::in | std::ios::binary);
+        oasisio::BufferedByteSource src(ifs);
+        sum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(i=0; i<count; ++i) {
+            sum += oasisio::OasisReader::fromBytesUnsigned(src);
+        }
+        report("BufferedByteSource          ", start, bytes, sum);
+    }
+    {
+        oasisio::MappedByteSource src(name);
+        sum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(i=0; i<count; ++i) {
+            sum += oasisio::OasisReader::fromBytesUnsigned(src);
+        }
+        report("MappedByteSource            ", start, bytes, sum);
+    }
+
+#elif 0
+
+    // Bulk varint decoding against one integer per call. The values mix
+    // 1 to 5 byte encodings like the coordinates of a point list.
+    const std::size_t count = 20000000;
+    std::vector<unsigned int> values(count);
+    std::mt19937 rng(7);
+    std::size_t i;
+    for(i=0; i<count; ++i) {
+        values[i] = rng() >> (rng() % 32);
+    }
+    std::ostringstream oss;
+    {
+        oasisio::StreamByteSink sink(oss);
+        oasisio::OasisWriter ow(sink);
+        for(i=0; i<count; ++i) {
+            ow.toBytesUnsigned(values[i]);
+        }
+        ow.flush();
+    }
+    std::string encoded = oss.str();
+    const oasisio::byte* data = (const oasisio::byte*)encoded.data();
+
+    auto report = [&encoded](const char* label, std::chrono::steady_clock::time_point start, bool same) {
+        double sec = seconds(start);
+        std::cout << label << " : " << (encoded.size() / (1024.0*1024.0)) / sec << " MB/s, "
+                  << count / sec / 1e6 << " M ints/s" << (same ? "" : "  MISMATCH") << std::endl;
+    };
+
+    std::vector<unsigned int> decoded(count);
+    {
+        oasisio::SpanByteSource src(data, encoded.size());
+        auto start = std::chrono::steady_clock::now();
+        for(i=0; i<count; ++i) {
+            decoded[i] = oasisio::OasisReader::fromBytesUnsigned(src);
+        }
+        report("fromBytesUnsigned per integer", start, decoded == values);
+    }
+    {
+        std::fill(decoded.begin(), decoded.end(), 0);
+        const oasisio::byte* p = data;
+        auto start = std::chrono::steady_clock::now();
+        oasisio::varint::decodeScalar(p, data + encoded.size(), decoded.data(), count);
+        report("varint::decodeScalar         ", start, decoded == values);
+    }
+    {
+        std::fill(decoded.begin(), decoded.end(), 0);
+        const oasisio::byte* p = data;
+        auto start = std::chrono::steady_clock::now();
+        oasisio::varint::decodeUnsigned(p, data + encoded.size(), decoded.data(), count);
+        report("varint::decodeUnsigned       ", start, decoded == values);
+    }
+    {
+        std::fill(decoded.begin(), decoded.end(), 0);
+        oasisio::SpanByteSource src(data, encoded.size());
+        auto start = std::chrono::steady_clock::now();
+        oasisio::OasisReader::fromBytesUnsigned(src, decoded.data(), count);
+        report("fromBytesUnsigned bulk       ", start, decoded == values);
+    }
+
+#elif 0
+
+    // Fuzz the bulk decoder against the scalar one: random byte soup
+    // (including integers longer than 5 bytes and truncated tails) and
+    // valid encodings read through a small buffered window.
+    std::mt19937 rng(11);
+    int round;
+    int failures = 0;
+    for(round=0; round<200000 && failures<10; ++round) {
+        std::size_t len = rng() % 200;
+        std::vector<oasisio::byte> buf(len);
+        unsigned int continuation = rng() % 256;
+        std::size_t i;
+        for(i=0; i<len; ++i) {
+            buf[i] = (oasisio::byte)(rng() % 128) | ((rng() % 256) < continuation ? 128 : 0);
+        }
+        std::size_t n = rng() % 120;
+        std::vector<unsigned int> expect(n, 0), got(n, 0);
+        const oasisio::byte* p1 = buf.data();
+        const oasisio::byte* p2 = buf.data();
+        std::size_t k1 = oasisio::varint::decodeScalar(p1, buf.data() + len, expect.data(), n);
+        std::size_t k2 = oasisio::varint::decodeUnsigned(p2, buf.data() + len, got.data(), n);
+        if(k1 != k2 || p1 != p2 || expect != got) {
+            std::cout << "mismatch in round " << round << ": " << k1 << " vs " << k2 << " integers" << std::endl;
+            ++failures;
+        }
+
+        // valid encodings through BufferedByteSource, so integers straddle refills.
+        std::vector<unsigned int> values(n);
+        std::ostringstream oss;
+        {
+            oasisio::StreamByteSink sink(oss);
+            oasisio::OasisWriter ow(sink);
+            for(i=0; i<n; ++i) {
+                values[i] = rng() >> (rng() % 32);
+                ow.toBytesUnsigned(values[i]);
+            }
+            ow.toBytesUnsigned(12345);
+            ow.flush();
+        }
+        std::istringstream iss(oss.str());
+        oasisio::BufferedByteSource src(iss, 1 + rng() % 64);
+        std::fill(got.begin(), got.end(), 0);
+        oasisio::OasisReader::fromBytesUnsigned(src, got.data(), n);
+        if(got != values || oasisio::OasisReader::fromBytesUnsigned(src) != 12345) {
+            std::cout << "buffered mismatch in round " << round << std::endl;
+            ++failures;
+        }
+    }
+    std::cout << round << " rounds, " << failures << " failures" << std::endl;
+
+#elif 0
+
+    // Load time and memory of a polygon-heavy file with shapes on the heap
+    // against shapes in the layout's arena (rectangles go to Layer::Rects and
+    // don't use either). Run once per setting of useArena:
+    // freed heap memory stays resident, so RSS is only comparable in a fresh process.
+    const bool useArena = true;
+    std::string name = "bench_polygons.oas";
+    const int count = 5000000;
+    oasisio::OasisFileManager<layout::iPoint> ofm;
+    if(!std::filesystem::exists(name)) {
+        // written by the first run only, so the measured runs start with a clean heap.
+        layout::iLayout src(name);
+        layout::iLayer* layer = src.newCell("TOP")->newLayer(1, 0, QColor("red"));
+        std::mt19937 rng(1);
+        int i;
+        for(i=0; i<count; ++i) {
+            int x = rng() % 10000000;
+            int y = rng() % 10000000;
+            std::vector<layout::iPoint> pts = {{x, y}, {x + 1 + (int)(rng() % 500), y}, {x, y + 1 + (int)(rng() % 700)}};
+            layer->newShape<layout::iPolygon>(pts);
+        }
+        ofm.writeOasisFile(&src, name);
+    }
+
+    double rss = residentMB();
+    auto start = std::chrono::steady_clock::now();
+    layout::iLayout* output = new layout::iLayout(name, useArena);
+    ofm.readOasisFile(name, *output);
+    double load = seconds(start);
+    double grown = residentMB() - rss;
+    start = std::chrono::steady_clock::now();
+    delete output;
+    double release = seconds(start);
+    std::cout << (useArena ? "arena" : "heap ") << " : load " << load << " s, RSS +"
+              << grown << " MB, release " << release << " s" << std::endl;
+
+#elif 0
+
+    // bbox, vertex generation and writing of rectangles held as polymorphic
+    // Box shapes against the same rectangles in Layer::Rects.
+    const int count = 5000000;
+    layout::iLayout boxes("bench_boxes.oas", false);
+    layout::iLayout rects("bench_rects.oas");
+    layout::iLayer* boxLayer = boxes.newCell("TOP")->newLayer(1, 0, QColor("red"));
+    layout::iLayer* rectLayer = rects.newCell("TOP")->newLayer(1, 0, QColor("red"));
+    std::mt19937 rng(1);
+    int i;
+    for(i=0; i<count; ++i) {
+        int x = rng() % 10000000;
+        int y = rng() % 10000000;
+        int w = 1 + rng() % 500;
+        int h = 1 + rng() % 700;
+        boxLayer->addShape(new layout::iBox(x, y, x + w, y + h));
+        rectLayer->addRect(x, y, x + w, y + h);
+    }
+
+    oasisio::OasisFileManager<layout::iPoint> ofm;
+    for(layout::iLayout* l : {&boxes, &rects}) {
+        layout::iLayer* layer = l->getCell("TOP")->getLayers().begin()->second;
+        auto start = std::chrono::steady_clock::now();
+        layout::iBox bbox = layer->computeBBox();
+        double tBBox = seconds(start);
+
+        std::vector<QVector3D> vertices;
+        std::vector<int> vertexCnts;
+        vertices.reserve(layer->getVertexCount());
+        start = std::chrono::steady_clock::now();
+        layer->getVertices(vertices, vertexCnts);
+        double tVertices = seconds(start);
+
+        start = std::chrono::steady_clock::now();
+        ofm.writeOasisFile(l, l->getName());
+        double tWrite = seconds(start);
+        std::cout << l->getName() << " : bbox " << tBBox << " s, vertices " << tVertices
+                  << " s, write " << tWrite << " s (" << bbox.getWidth() << "x" << bbox.getHeight()
+                  << ", " << vertices.size() << " vertices, " << std::filesystem::file_size(l->getName())
+                  << " bytes)" << std::endl;
+    }
+
+#elif 0
+
+    // Load time of a many-cell file against the number of reader threads.
+    // Cells are located by a skip-parse first and then decoded in parallel.
+    std::string name = "bench_cells.oas";
+    const int cells = 512;
+    const int rectsPerCell = 20000;
+    oasisio::OasisFileManager<layout::iPoint> ofm;
+    {
+        layout::iLayout src(name);
+        std::mt19937 rng(5);
+        int c;
+        for(c=0; c<cells; ++c) {
+            layout::iCell* cell = src.newCell("cell" + std::to_string(c));
+            layout::iLayer* layer = cell->newLayer(1 + c % 3, 0, QColor("red"));
+            int i;
+            for(i=0; i<rectsPerCell; ++i) {
+                int x = rng() % 1000000;
+                int y = rng() % 1000000;
+                layer->addRect(x, y, x + 1 + rng() % 500, y + 1 + rng() % 700);
+            }
+            for(i=0; i<rectsPerCell/10; ++i) {
+                int x = rng() % 1000000;
+                int y = rng() % 1000000;
+                std::vector<layout::iPoint> pts = {{x, y}, {x + 300, y}, {x + 300, y + 200}, {x + 100, y + 400}};
+                layer->newShape<layout::iPolygon>(pts);
+            }
+        }
+        ofm.writeOasisFile(&src, name);
+    }
+
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    unsigned int threads;
+    for(threads=1; threads<=cores; threads*=2) {
+        ofm.setReadThreads(threads);
+        layout::iLayout in(name);
+        auto start = std::chrono::steady_clock::now();
+        ofm.readOasisFile(name, in);
+        double sec = seconds(start);
+        std::cout << threads << " threads : " << sec << " s, " << in.getCells().size() << " cells, "
+                  << in.getShapeCount() << " shapes" << std::endl;
+    }
+
+#elif 0
+
+    // Time and shape memory to look at one corner of a many-cell file, read
+    // in full against opened lazily. Each cell covers its own tile.
+    std::string name = "bench_lazy.oas";
+    const int cells = 1024;
+    const int rectsPerCell = 20000;
+    const int tile = 100000;
+    oasisio::OasisFileManager<layout::iPoint> ofm;
+    {
+        layout::iLayout src(name);
+        std::mt19937 rng(7);
+        int c;
+        for(c=0; c<cells; ++c) {
+            layout::iCell* cell = src.newCell("cell" + std::to_string(c));
+            layout::iLayer* layer = cell->newLayer(1 + c % 3, 0, QColor("red"));
+            int x0 = (c % 32) * tile;
+            int y0 = (c / 32) * tile;
+            int i;
+            for(i=0; i<rectsPerCell; ++i) {
+                int x = x0 + rng() % (tile - 1000);
+                int y = y0 + rng() % (tile - 1000);
+                layer->addRect(x, y, x + 1 + rng() % 500, y + 1 + rng() % 700);
+            }
+        }
+        ofm.writeOasisFile(&src, name);
+    }
+
+    layout::iBox view(0, 0, 2 * tile, 2 * tile);
+    for(bool lazy : {false, true}) {
+        layout::iLayout in(name);
+        auto start = std::chrono::steady_clock::now();
+        if(lazy) {
+            ofm.openOasisFile(name, in);
+        } else {
+            ofm.readOasisFile(name, in);
+        }
+        double tOpen = seconds(start);
+
+        start = std::chrono::steady_clock::now();
+        std::vector<QVector3D> vertices;
+        std::vector<int> vertexCnts;
+        in.getVertices(view, vertices, vertexCnts);
+        double tView = seconds(start);
+
+        int loaded = 0;
+        std::size_t rects = 0;
+        for(const auto& c : in.getCells()) {
+            if(c.second->isLoaded()) {
+                ++loaded;
+                for(const auto& l : c.second->getLayers()) {
+                    rects += l.second->getRects().size();
+                }
+            }
+        }
+        std::cout << (lazy ? "lazy" : "full") << " : open " << tOpen << " s, first view " << tView << " s, "
+                  << loaded << " of " << in.getCells().size() << " cells loaded, " << rects << " rectangles held, "
+                  << vertexCnts.size() << " drawn" << std::endl;
+    }
+
+#elif 0
+
+    // File size, write time and read time with per-cell CBLOCKs at several
+    // DEFLATE levels. Reads use one thread and then one per core.
+    const int cells = 256;
+    const int rectsPerCell = 20000;
+    layout::iLayout src("bench_cblock");
+    {
+        std::mt19937 rng(11);
+        int c;
+        for(c=0; c<cells; ++c) {
+            layout::iCell* cell = src.newCell("cell" + std::to_string(c));
+            layout::iLayer* layer = cell->newLayer(1 + c % 3, 0, QColor("red"));
+            int i;
+            for(i=0; i<rectsPerCell; ++i) {
+                int x = rng() % 1000000;
+                int y = rng() % 1000000;
+                layer->addRect(x, y, x + 1 + rng() % 500, y + 1 + rng() % 700);
+            }
+            for(i=0; i<rectsPerCell/10; ++i) {
+                int x = rng() % 1000000;
+                int y = rng() % 1000000;
+                std::vector<layout::iPoint> pts = {{x, y}, {x + 300, y}, {x + 300, y + 200}, {x + 100, y + 400}};
+                layer->newShape<layout::iPolygon>(pts);
+            }
+        }
+    }
+
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    oasisio::OasisFileManager<layout::iPoint> ofm;
+    for(int level : {0, 1, 6, 9}) {
+        std::string name = "bench_cblock_" + std::to_string(level) + ".oas";
+        ofm.setCompression(level);
+        auto start = std::chrono::steady_clock::now();
+        ofm.writeOasisFile(&src, name);
+        double tWrite = seconds(start);
+
+        double tRead[2];
+        int shapes = 0;
+        for(int k=0; k<2; ++k) {
+            ofm.setReadThreads(k == 0 ? 1 : cores);
+            layout::iLayout in(name);
+            start = std::chrono::steady_clock::now();
+            ofm.readOasisFile(name, in);
+            tRead[k] = seconds(start);
+            shapes = in.getShapeCount();
+        }
+        std::cout << "level " << level << " : " << std::filesystem::file_size(name) << " bytes, write "
+                  << tWrite << " s, read " << tRead[0] << " s (1 thread), " << tRead[1] << " s ("
+                  << cores << " threads), " << shapes << " shapes" << std::endl;
+    }
+
+#elif 0
+
+    // A 32x32 array of one library cell, once through PLACEMENT records and
+    // once flattened into a single cell: rectangles held, file size, read
+    // time and the time to produce the vertices of the whole array.
+    const int side = 32;
+    const int pitch = 20000;
+    const int rectsPerCell = 2000;
+    layout::iLayout hier("bench_hier");
+    layout::iLayout flat("bench_flat");
+    {
+        std::mt19937 rng(17);
+        layout::iLayer* lib = hier.newCell("lib")->newLayer(1, 0, QColor("red"));
+        int i;
+        for(i=0; i<rectsPerCell; ++i) {
+            int x = rng() % (pitch - 500);
+            int y = rng() % (pitch - 500);
+            lib->addRect(x, y, x + 1 + rng() % 400, y + 1 + rng() % 400);
+        }
+        layout::iCell* top = hier.newCell("top");
+        layout::iLayer* all = flat.newCell("top")->newLayer(1, 0, QColor("red"));
+        const layout::Rects<layout::iPoint>& rects = lib->getRects();
+        int x, y;
+        for(x=0; x<side; ++x) {
+            for(y=0; y<side; ++y) {
+                top->addPlacement(hier.getCell("lib"), layout::iPoint(x * pitch, y * pitch));
+                std::size_t r;
+                for(r=0; r<rects.size(); ++r) {
+                    all->addRect(rects.getMinX(r) + x * pitch, rects.getMinY(r) + y * pitch,
+                                 rects.getMaxX(r) + x * pitch, rects.getMaxY(r) + y * pitch);
+                }
+            }
+        }
+    }
+
+    oasisio::OasisFileManager<layout::iPoint> ofm;
+    for(layout::iLayout* l : {&hier, &flat}) {
+        std::string name = l->getName() + ".oas";
+        layout::iLayout in(name);
+        writeAndRead(ofm, *l, name, in, l->getName());
+
+        std::vector<QVector3D> vertices;
+        std::vector<int> vertexCnts;
+        auto start = std::chrono::steady_clock::now();
+        in.getVertices(vertices, vertexCnts);
+        double tDraw = seconds(start);
+
+        std::cout << l->getName() << " : " << in.getShapeCount() << " shapes held, "
+                  << vertexCnts.size() << " shapes drawn in " << tDraw << " s" << std::endl;
+    }
+
+#elif 0
+
+    // Via arrays kept as RECTANGLE records with a repetition against the same
+    // vias written one record each: shapes held, file size, read time and the
+    // time to draw a view covering a few arrays.
+    const int arrays = 200;
+    const int side = 100;
+    const int pitch = 20;
+    layout::iLayout repeated("bench_rep");
+    layout::iLayout single("bench_single");
+    {
+        layout::iLayer* rep = repeated.newCell("vias")->newLayer(1, 0, QColor("red"));
+        layout::iLayer* one = single.newCell("vias")->newLayer(1, 0, QColor("red"));
+        int a;
+        for(a=0; a<arrays; ++a) {
+            int x0 = (a % 20) * side * pitch * 2;
+            int y0 = (a / 20) * side * pitch * 2;
+            rep->newShape<layout::RepeatedShape<layout::iPoint> >(
+                new layout::iBox(x0, y0, x0 + 8, y0 + 8),
+                layout::Repetition<layout::iPoint>(side, layout::iPoint(pitch, 0), side, layout::iPoint(0, pitch)));
+            int i, j;
+            for(i=0; i<side; ++i) {
+                for(j=0; j<side; ++j) {
+                    one->addRect(x0 + i * pitch, y0 + j * pitch, x0 + i * pitch + 8, y0 + j * pitch + 8);
+                }
+            }
+        }
+    }
+
+    oasisio::OasisFileManager<layout::iPoint> ofm;
+    ofm.setReadThreads(1);
+    layout::iBox view(0, 0, 3 * side * pitch, 3 * side * pitch);
+    for(layout::iLayout* l : {&repeated, &single}) {
+        std::string name = l->getName() + ".oas";
+        layout::iLayout in(name);
+        writeAndRead(ofm, *l, name, in, l->getName());
+
+        std::vector<QVector3D> vertices;
+        std::vector<int> vertexCnts;
+        auto start = std::chrono::steady_clock::now();
+        in.getVertices(view, vertices, vertexCnts);
+        double tView = seconds(start);
+
+        std::cout << l->getName() << " : " << in.getShapeCount() << " shapes held, "
+                  << vertexCnts.size() << " vias in view drawn in " << tView << " s" << std::endl;
+    }
+
+#elif 0
+
+    // A flat layout of via arrays and scattered pads, written one record per
+    // shape, with repetition detection, and with detection cut short by a
+    // time limit: write time, file size and what the report says was saved.
+    const int arrays = 200;
+    const int side = 100;
+    const int pitch = 20;
+    layout::iLayout flat("bench_flat");
+    {
+        layout::iLayer* vias = flat.newCell("top")->newLayer(1, 0, QColor("red"));
+        int a, i, j;
+        for(a=0; a<arrays; ++a) {
+            int x0 = (a % 20) * side * pitch * 2;
+            int y0 = (a / 20) * side * pitch * 2;
+            for(i=0; i<side; ++i) {
+                for(j=0; j<side; ++j) {
+                    vias->addRect(x0 + i * pitch, y0 + j * pitch, x0 + i * pitch + 8, y0 + j * pitch + 8);
+                }
+            }
+        }
+        layout::iLayer* pads = flat.getCell("top")->newLayer(2, 0, QColor("blue"));
+        std::mt19937 rng(1);
+        for(i=0; i<100000; ++i) {
+            int x = rng() % 4000000;
+            int y = rng() % 4000000;
+            pads->addRect(x, y, x + 50, y + 50);
+        }
+    }
+
+    oasisio::OasisFileManager<layout::iPoint> ofm;
+    for(int run=0; run<3; ++run) {
+        ofm.setDetectRepetitions(run > 0);
+        ofm.setRepetitionTimeLimit(run == 2 ? 100 : 0);
+        std::string name = "bench_flat" + std::to_string(run) + ".oas";
+        auto start = std::chrono::steady_clock::now();
+        ofm.writeOasisFile(&flat, name);
+        double tWrite = seconds(start);
+
+        const auto& report = ofm.getRepetitionReport();
+        std::cout << (run == 0 ? "plain" : (run == 1 ? "detect" : "detect 100 ms")) << " : "
+                  << std::filesystem::file_size(name) << " bytes, written in " << tWrite << " s; "
+                  << report.shapes << " shapes in " << report.records << " records, "
+                  << report.plainBytes << " -> " << report.bytes << " bytes, "
+                  << report.milliseconds << " ms analysing" << std::endl;
+    }
+
+#elif 0
+
+    // A shape-sorted layout, rows of equal rectangles and rows of Manhattan
+    // polygons (L shapes and notched rectangles), written and read back:
+    // file size, bytes per shape, write and read time. Fields equal to the
+    // previous record's are left out and the polygons use 1-delta point lists.
+    const int rows = 1000;
+    const int columns = 1000;
+    layout::iLayout sorted("bench_sorted");
+    {
+        layout::iCell* top = sorted.newCell("top");
+        layout::iLayer* rects = top->newLayer(1, 0, QColor("red"));
+        layout::iLayer* polygons = top->newLayer(2, 0, QColor("blue"));
+        int i, j;
+        for(j=0; j<rows; ++j) {
+            for(i=0; i<columns; ++i) {
+                int x = i * 50;
+                int y = j * 80;
+                rects->addRect(x, y, x + 30, y + 20);
+                std::vector<layout::iPoint> pts;
+                if(i % 2 == 0) {
+                    pts = {{x, y + 30}, {x + 40, y + 30}, {x + 40, y + 40}, {x + 10, y + 40}, {x + 10, y + 70}, {x, y + 70}};
+                } else {
+                    pts = {{x, y + 30}, {x + 40, y + 30}, {x + 40, y + 70}, {x + 25, y + 70}, {x + 25, y + 60},
+                           {x + 15, y + 60}, {x + 15, y + 70}, {x, y + 70}};
+                }
+                polygons->newShape<layout::iPolygon>(pts);
+            }
+        }
+    }
+
+    oasisio::OasisFileManager<layout::iPoint> ofm;
+    ofm.setReadThreads(1);
+    std::string name = "bench_sorted.oas";
+    layout::iLayout in(name);
+    writeAndRead(ofm, sorted, name, in, sorted.getName());
+
+    std::cout << 2 * rows * columns << " shapes, "
+              << (double)std::filesystem::file_size(name) / (2.0 * rows * columns) << " bytes per shape" << std::endl;
+
+#elif 0
+
+    // Trapezoids written as TRAPEZOID and CTRAPEZOID records against the same
+    // shapes written as polygons: file size, write and read time. Half are
+    // 45 degree shapes with a CTRAPEZOID type, half have arbitrary deltas.
+    const int rows = 1000;
+    const int columns = 1000;
+    layout::iLayout trapezoids("bench_trapezoids");
+    layout::iLayout polygons("bench_trapezoid_polygons");
+    {
+        layout::iLayer* t = trapezoids.newCell("top")->newLayer(1, 0, QColor("red"));
+        layout::iLayer* p = polygons.newCell("top")->newLayer(1, 0, QColor("red"));
+        int i, j;
+        for(j=0; j<rows; ++j) {
+            for(i=0; i<columns; ++i) {
+                int x = i * 100;
+                int y = j * 60;
+                layout::iBox box(x, y, x + 40 + i % 30, y + 40);
+                layout::iTrapezoid* trapezoid = i % 2 == 0
+                    ? t->newShape<layout::iTrapezoid>(box, 0, -40, false)
+                    : t->newShape<layout::iTrapezoid>(box, j % 7, -(i % 11), false);
+                layout::iPoint corners[4];
+                int n = trapezoid->getCorners(corners);
+                p->newShape<layout::iPolygon>(std::vector<layout::iPoint>(corners, corners + n));
+            }
+        }
+    }
+
+    oasisio::OasisFileManager<layout::iPoint> ofm;
+    ofm.setReadThreads(1);
+    for(layout::iLayout* l : {&trapezoids, &polygons}) {
+        std::string name = l->getName() + ".oas";
+        layout::iLayout in(name);
+        writeAndRead(ofm, *l, name, in, l->getName());
+    }
+    std::cout << "sizeof(iTrapezoid) " << sizeof(layout::iTrapezoid) << std::endl;
+
+#elif 0
+
+    // Routing: Manhattan wires with a few jogs each, written as PATH records
+    // against the same wires as one rectangle per segment: file size, write
+    // and read time. Wires differ in length, so repetitions do not apply.
+    const int wires = 200000;
+    layout::iLayout paths("bench_paths");
+    layout::iLayout segments("bench_path_segments");
+    {
+        layout::iLayer* p = paths.newCell("top")->newLayer(1, 0, QColor("red"));
+        layout::iLayer* s = segments.newCell("top")->newLayer(1, 0, QColor("red"));
+        int i;
+        for(i=0; i<wires; ++i) {
+            int x = (i % 100) * 20000;
+            int y = (i / 100) * 100;
+            int run = 1000 + (i * 37) % 4000;
+            std::vector<layout::iPoint> pts = {{x, y}, {x + run, y}, {x + run, y + 40}, {x + 2 * run, y + 40},
+                                               {x + 2 * run, y + 80}, {x + 3 * run, y + 80}};
+            layout::iPath* path = p->newShape<layout::iPath>(pts, 10, 10, 10);
+            path->forEachQuad([&](const double* qx, const double* qy) {
+                s->addRect((int)std::min(qx[0], qx[2]), (int)std::min(qy[0], qy[2]),
+                           (int)std::max(qx[0], qx[2]), (int)std::max(qy[0], qy[2]));
+            });
+        }
+    }
+
+    oasisio::OasisFileManager<layout::iPoint> ofm;
+    ofm.setReadThreads(1);
+    for(layout::iLayout* l : {&paths, &segments}) {
+        std::string name = l->getName() + ".oas";
+        layout::iLayout in(name);
+        writeAndRead(ofm, *l, name, in, l->getName());
+    }
+
+#elif 0
+
+    // Labels: two million pin labels sharing four thousand net names, as a
+    // router leaves them. Each label keeps a string number, each name is
+    // stored once: label memory, resident memory, file size, write and
+    // read time.
+    const int labels = 2000000;
+    const int nets = 4000;
+    layout::iLayout texts("bench_texts");
+    {
+        layout::iLayer* l = texts.newCell("top")->newLayer(10, 0, QColor("red"));
+        int i;
+        for(i=0; i<labels; ++i) {
+            std::string net = "net_" + std::to_string((i * 37) % nets);
+            l->addText((i % 2000) * 150, (i / 2000) * 150, texts.getTextPool().intern(net));
+        }
+    }
+
+    oasisio::OasisFileManager<layout::iPoint> ofm;
+    std::string name = texts.getName() + ".oas";
+    double before = residentMB();
+    layout::iLayout in(name);
+    writeAndRead(ofm, texts, name, in, texts.getName());
+
+    std::size_t read = in.getCell("top")->getLayer(10, 0)->getTexts().size();
+    std::cout << read << " labels, " << in.getTextPool().size() << " strings, "
+              << read * sizeof(layout::Text<layout::iPoint>) << " bytes of labels, "
+              << residentMB() - before << " MB more resident after the read" << std::endl;
+
+#elif 0
+
+    // Properties: a library of two thousand cells, written with S_CELL_OFFSET
+    // and S_BOUNDING_BOX in its cell name table. Opening it finds every cell
+    // and its extent from the table alone, without a pass over the records
+    // and without loading a single cell.
+    const int cells = 2000;
+    layout::iLayout library("bench_library");
+    {
+        layout::iCell* top = library.newCell("top");
+        int i, j;
+        for(i=0; i<cells; ++i) {
+            layout::iCell* c = library.newCell("cell_" + std::to_string(i));
+            layout::iLayer* l = c->newLayer(1 + i % 4, 0, QColor("red"));
+            for(j=0; j<500; ++j) {
+                l->addRect((j * 37) % 1000, (j * 53) % 1000, (j * 37) % 1000 + 20, (j * 53) % 1000 + 10 + i % 7);
+            }
+            top->addPlacement(c, layout::iPoint((i % 50) * 1200, (i / 50) * 1200));
+        }
+    }
+
+    oasisio::OasisFileManager<layout::iPoint> ofm;
+    std::string name = library.getName() + ".oas";
+    auto start = std::chrono::steady_clock::now();
+    ofm.writeOasisFile(&library, name);
+    double tWrite = seconds(start);
+
+    layout::iLayout in(name);
+    start = std::chrono::steady_clock::now();
+    ofm.openOasisFile(name, in);
+    layout::iBox bbox = in.getCell("top")->getBBox();
+    double tOpen = seconds(start);
+
+    int loaded = 0;
+    for(const auto& c : in.getCells()) {
+        loaded += c.second->isLoaded() ? 1 : 0;
+    }
+    std::cout << std::filesystem::file_size(name) << " bytes, written in " << tWrite << " s" << std::endl;
+    std::cout << in.getCells().size() << " cells opened in " << tOpen << " s, " << loaded << " loaded, top "
+              << bbox.getMinX() << "," << bbox.getMinY() << " " << bbox.getMaxX() << "," << bbox.getMaxY() << std::endl;
+
+#elif 0
+
+    // Validation: one layout written and read without a signature, with
+    // CRC32 and with checksum32. The writer signs each buffer as it leaves,
+    // the reader signs the mapped file on a second thread while it decodes.
+    layout::iLayout rects("bench_validation");
+    {
+        layout::iLayer* l = rects.newCell("top")->newLayer(1, 0, QColor("red"));
+        int i;
+        for(i=0; i<4000000; ++i) {
+            int x = (i % 2000) * 30 + (i * 7) % 11;
+            int y = (i / 2000) * 30 + (i * 13) % 17;
+            l->addRect(x, y, x + 10 + i % 9, y + 10 + i % 5);
+        }
+    }
+
+    oasisio::OasisFileManager<layout::iPoint> ofm;
+    ofm.setReadThreads(1);
+    const char* schemes[] = {"none", "CRC32", "checksum32"};
+    for(unsigned int scheme : {oasisio::VALIDATION_NONE, oasisio::VALIDATION_CRC32, oasisio::VALIDATION_CHECKSUM32}) {
+        ofm.setValidation(scheme);
+        std::string name = rects.getName() + ".oas";
+        layout::iLayout in(name);
+        writeAndRead(ofm, rects, name, in, schemes[scheme]);
+    }
+
+#elif 0
+
+    // Stale S_CELL_OFFSET: cell A's offset points one byte past its CELL
+    // record. Both readers must notice and fall back to scanning the records
+    // from just after the header, finding both cells.
+    std::string name = "stale_offset.oas";
+    {
+        std::ofstream ofs(name, std::ios::out | std::ios::binary);
+        oasisio::OasisWriter ow(&ofs);
+        ow.toBytesRaw(oasisio::MAGIC, 12);
+        ow.toBytesUnsigned(1);
+        ow.toBytesString(VERSION);
+        ow.toBytesReal(POSITIVE_WHOLE, 1000);
+        ow.toBytesUnsigned(1);
+
+        // cells A (reference 0) and B (reference 1), a 10x10 rectangle each.
+        unsigned int cellOffsets[2];
+        unsigned int ref;
+        for(ref=0; ref<2; ++ref) {
+            cellOffsets[ref] = ow.getPos();
+            ow.toBytesUnsigned(13);
+            ow.toBytesUnsigned(ref);
+            ow.toBytesUnsigned(20);
+            ow.toBytesChar(0x7b);
+            ow.toBytesUnsigned(1);
+            ow.toBytesUnsigned(0);
+            ow.toBytesUnsigned(10);
+            ow.toBytesUnsigned(10);
+            ow.toBytesSigned(100 * ref);
+            ow.toBytesSigned(0);
+        }
+
+        unsigned int cellnames = ow.getPos();
+        const char* names[2] = {"A", "B"};
+        for(ref=0; ref<2; ++ref) {
+            ow.toBytesUnsigned(4);
+            ow.toBytesString(names[ref]);
+            ow.toBytesUnsigned(ref);
+            // S_CELL_OFFSET, property name 0, one unsigned value. A's is wrong.
+            ow.toBytesUnsigned(28);
+            ow.toBytesChar(0x17);
+            ow.toBytesUnsigned(0);
+            ow.toBytesUnsigned(8);
+            ow.toBytesUnsigned(cellOffsets[ref] + (ref == 0 ? 1 : 0));
+        }
+        unsigned int propnames = ow.getPos();
+        ow.toBytesUnsigned(8);
+        ow.toBytesString("S_CELL_OFFSET");
+        ow.toBytesUnsigned(0);
+
+        unsigned int end = ow.getPos();
+        ow.toBytesUnsigned(2);
+        unsigned int tables[12] = {1, cellnames, 1, 0, 1, propnames, 1, 0, 1, 0, 1, 0};
+        int i;
+        for(i=0; i<12; ++i) {
+            ow.toBytesUnsigned(tables[i]);
+        }
+        unsigned int numPadding = 256 - (ow.getPos() - end) - 2 - 1;
+        ow.toBytesChar((char)((numPadding & 0x7f) | 0x80));
+        ow.toBytesChar((char)(numPadding >> 7));
+        for(i=0; i<(int)numPadding; ++i) {
+            ow.toBytesChar(0);
+        }
+        ow.toBytesUnsigned(0);
+        ow.flush();
+    }
+
+    oasisio::OasisFileManager<layout::iPoint> ofm;
+    ofm.setReadThreads(4);
+    layout::iLayout read(name);
+    ofm.readOasisFile(name, read);
+    layout::iLayout opened(name);
+    ofm.openOasisFile(name, opened);
+    for(layout::iLayout* l : {&read, &opened}) {
+        std::cout << l->getCells().size() << " cells:";
+        for(const auto& c : l->getCells()) {
+            c.second->ensureLoaded();
+            std::cout << " " << c.first << " " << c.second->getShapeCount() << " shapes";
+        }
+        std::cout << std::endl;
+    }
+
 #else
 
     std::string name = "unsigned.oas";
@@ -181,14 +1078,16 @@ int main(int argc, char *argv[])
     int count = 1;
     ow.toBytesUnsigned(10);
 
+    ow.flush();
     ofs.close();
     std::ifstream ifs;
     ifs.open(name);
+    oasisio::BufferedByteSource src(ifs);
 
     int i;
     int next;
     for(i=0; i<count; ++i) {
-        next = oasisio::OasisReader::fromBytesUnsigned(ifs);
+        next = oasisio::OasisReader::fromBytesUnsigned(src);
         std::cout << std::dec << next << std::endl;
     }
 
@@ -28,7 +28,7 @@ MainWindow::MainWindow(QWidget* parent)
   QHBoxLayout* hbox = new QHBoxLayout;
   hbox->setContentsMargins(5, 5, 5, 5);
 
-  m_layM = new layout::dLayoutManager();
+  m_layM = new layout::iLayoutManager();
   layout::initializeManager(*m_layM);
 
   m_glw = new GLWidget(*m_layM, frame);
@@ -45,10 +45,10 @@ MainWindow::MainWindow(QWidget* parent)
   setStatusBar(sbar);
   sbar->showMessage("Ready");
 
-  oasisio::OasisFileManager<layout::dPoint> ofm;
+  oasisio::OasisFileManager<layout::iPoint> ofm;
   std::string name = "TestLayout";
 
-  layout::Layout<layout::dPoint> layout(name);
+  layout::Layout<layout::iPoint> layout(name);
   layout.newCell("Cell 1");
   layout.newCell("Cell 2");
 
@@ -193,15 +193,20 @@ void MainWindow::onOpen(bool bChecked) {
   printf("Opening layout: %s...\n", fn.toStdString().c_str());
 
   // load this oasis file.
-  layout::Layout<layout::dPoint>* output =
+  layout::Layout<layout::iPoint>* output =
     getLayoutManager().newLayout(name);
-  std::ifstream ifs;
-  ifs.open(name);
-  oasisio::OasisFileManager<layout::dPoint> ofm;
-  ofm.readOasisFile(ifs, *output);
+  // cells are read as they are first drawn.
+  oasisio::OasisFileManager<layout::iPoint> ofm;
+  ofm.openOasisFile(name, *output);
 
   //std::cout << *output << std::endl;
-  output->print();
+  //output->print();
+
+  // coordinates are database units; show the extent in microns.
+  const layout::iBox& bbox = output->getBBox();
+  statusBar()->showMessage(QString("%1: %2 x %3 um").arg(fn)
+                           .arg(output->toMicrons(bbox.getWidth()))
+                           .arg(output->toMicrons(bbox.getHeight())));
 
   QAction* act = findChild<QAction*>("File.Save");
   act->setEnabled(true);
@@ -216,7 +221,7 @@ void MainWindow::onSave(bool bChecked) {
   std::string name("");
   if (m_layM->getActiveLayout()) {
       name = m_layM->getActiveLayout()->getName();
-      oasisio::OasisFileManager<layout::dPoint> ofm;
+      oasisio::OasisFileManager<layout::iPoint> ofm;
       //std::cout << m_layM->getActiveLayout() << std::endl;
       ofm.writeOasisFile(m_layM->getActiveLayout(), name);
   }
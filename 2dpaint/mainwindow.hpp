@@ -16,7 +16,7 @@ class MainWindow : public QMainWindow
 protected:
   QLabel* m_label;
 
-  layout::dLayoutManager* m_layM;
+  layout::iLayoutManager* m_layM;
   GLWidget* m_glw;
 
 public:
@@ -29,10 +29,10 @@ public:
   void createMenus();
   void createToolBars();
 
-  layout::dLayoutManager& getLayoutManager() {
+  layout::iLayoutManager& getLayoutManager() {
       return *m_layM;
   }
-  const layout::dLayoutManager& getLayoutManager() const {
+  const layout::iLayoutManager& getLayoutManager() const {
       return *m_layM;
   }
 
@@ -5,42 +5,103 @@
 #include <iostream>
 #include <layout.hpp>
 #include <bitset>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <set>
+#include <thread>
 #include "polygon.hpp"
 #include "circle.hpp"
+#include "path.hpp"
 #include "trapezoid.hpp"
+#include "repetition.hpp"
+#include "repetitionFinder.hpp"
 
 namespace oasisio {
 
 
 class TableOffsets {
+public:
+    typedef std::map<unsigned int, std::string_view> tCellnames;
+    typedef std::map<std::tuple<unsigned int, unsigned int, unsigned int, unsigned int>, std::string_view> tLayernames;
+    typedef std::map<unsigned int, unsigned int> tTextstrings;
+    typedef std::map<unsigned int, std::string_view> tPropnames;
+    typedef std::map<unsigned int, std::string_view> tPropstrings;
+
+    /// the values of an S_BOUNDING_BOX property: the cell's extent, placed
+    /// cells included. bit 1 of flags marks an empty cell.
+    struct CellBBox {
+        unsigned int flags;
+        std::int64_t x;
+        std::int64_t y;
+        std::uint64_t width;
+        std::uint64_t height;
+    };
+
 protected:
     unsigned int cellnameFlag;
-    unsigned int cellnameOffset;
+    std::uint64_t cellnameOffset;
 
     unsigned int textstringFlag;
-    unsigned int textstringOffset;
+    std::uint64_t textstringOffset;
 
     unsigned int propnameFlag;
-    unsigned int propnameOffset;
+    std::uint64_t propnameOffset;
 
     unsigned int propstringFlag;
-    unsigned int propstringOffset;
+    std::uint64_t propstringOffset;
 
     unsigned int layernameFlag;
-    unsigned int layernameOffset;
+    std::uint64_t layernameOffset;
 
     unsigned int xnameFlag;
-    unsigned int xnameOffset;
+    std::uint64_t xnameOffset;
 
 
-    std::map<unsigned int, std::string> cellnames;
-    unsigned int cellReferences = 0;
+    /// owns (or, for a resident source, points at) every name below.
+    StringPool names;
 
-    std::map<std::tuple<unsigned int, unsigned int, unsigned int, unsigned int>, std::string> layernames;
+    tCellnames cellnames;
+    unsigned int cellReferences = 0;
+    /// name -> reference, for the writer's PLACEMENT records.
+    std::map<std::string_view, unsigned int> cellnameRefs;
+
+    tLayernames layernames;
+
+    /// TEXTSTRING reference -> the string's number in textPool.
+    tTextstrings textstrings;
+    /// the reference the next TEXTSTRING record without one gets.
+    unsigned int textReferences = 0;
+    /// the layout's label strings, which the reader's TEXT records go into.
+    layout::TextPool* textPool = nullptr;
+
+    tPropnames propnames;
+    unsigned int propnameReferences = 0;
+    /// name -> reference, for the writer's PROPERTY records.
+    std::map<std::string_view, unsigned int> propnameRefs;
+
+    tPropstrings propstrings;
+    unsigned int propstringReferences = 0;
+
+    /// reference -> file offset of the CELL record, from S_CELL_OFFSET.
+    std::map<unsigned int, std::uint64_t> cellOffsets;
+    /// reference -> extent of the cell, from S_BOUNDING_BOX.
+    std::map<unsigned int, CellBBox> cellBBoxes;
+    /// where the file's own PROPERTY records start, right after START.
+    std::size_t filePropertyOffset = 0;
+    /// validation of the END record: the scheme, the signature and how many
+    /// bytes from the start of the file it covers.
+    unsigned int validationScheme = VALIDATION_NONE;
+    std::uint32_t signature = 0;
+    std::size_t signedLength = 0;
 
 public:
-    TableOffsets(unsigned int cnf, unsigned int cno, unsigned int tsf, unsigned int tso, unsigned int pnf, unsigned int pno,
-                 unsigned int psf, unsigned int pso, unsigned int lnf, unsigned int lno, unsigned int xnf, unsigned int xno)
+    TableOffsets(unsigned int cnf, std::uint64_t cno, unsigned int tsf, std::uint64_t tso, unsigned int pnf, std::uint64_t pno,
+                 unsigned int psf, std::uint64_t pso, unsigned int lnf, std::uint64_t lno, unsigned int xnf, std::uint64_t xno)
         : cellnameFlag(cnf)
         , cellnameOffset(cno)
         , textstringFlag(tsf)
@@ -56,7 +117,7 @@ public:
     {}
 
 
-    void extractCellnames(std::ifstream& ifs) {
+    void extractCellnames(ByteSource& ifs) {
 
         if(cellnameOffset == 0) {
             return;
@@ -64,29 +125,169 @@ public:
 
         if(cellnameFlag == 1) { //Strict
 
-            int curPos = ifs.tellg();
-            ifs.seekg(cellnameOffset, ifs.beg);
+            std::size_t curPos = ifs.tell();
+            ifs.seek(cellnameOffset);
 
+            unsigned int reference = 0;
+            layout::Property property;
             while(true) {
                 unsigned int recordID = OasisReader::fromBytesUnsigned(ifs);
-                std::cout << "Record ID " << recordID << std::endl;
+                OASIS_TRACE(TRACE_RECORD, "Record ID " << recordID << std::endl);
+                if(recordID == 34) {
+                    OasisReader::fromBytesCblock(ifs);
+                    continue;
+                }
+                // S_CELL_OFFSET and S_BOUNDING_BOX of the cell name before.
+                // without a strict PROPNAME table their names are not known yet.
+                if(recordID == 28 || recordID == 29) {
+                    if(propnameFlag == 1) {
+                        readProperty(ifs, recordID, property);
+                        setCellnameProperty(reference, property);
+                    } else {
+                        skipProperty(ifs, recordID);
+                    }
+                    continue;
+                }
                 if(recordID != 4) {
                     break;
                 }
-                std::string cellname = OasisReader::fromBytesString(ifs);
-                unsigned int reference = OasisReader::fromBytesUnsigned(ifs);
-                std::cout << "Cellname : " << cellname << std::endl;
-                std::cout << "Reference : " << reference << std::endl;
-                cellnames[reference] = cellname;
+                // interned before the reference can move a buffered window.
+                std::string_view cellname = intern(OasisReader::fromBytesStringView(ifs), ifs.isResident());
+                reference = OasisReader::fromBytesUnsigned(ifs);
+                OASIS_TRACE(TRACE_RECORD, "Cellname : " << cellname << std::endl);
+                OASIS_TRACE(TRACE_RECORD, "Reference : " << reference << std::endl);
+                setCellname(reference, cellname, true);
+            }
+
+            ifs.seek(curPos);
+
+        }
+
+    }
+
+    /// read a strict PROPNAME table. needed before any PROPERTY record.
+    void extractPropnames(ByteSource& ifs) {
+
+        if(propnameOffset == 0) {
+            return;
+        }
+
+        if(propnameFlag == 1) { //Strict
+
+            std::size_t curPos = ifs.tell();
+            ifs.seek(propnameOffset);
+
+            while(true) {
+                unsigned int recordID = OasisReader::fromBytesUnsigned(ifs);
+                OASIS_TRACE(TRACE_RECORD, "Record ID " << recordID << std::endl);
+                if(recordID == 34) {
+                    OasisReader::fromBytesCblock(ifs);
+                    continue;
+                }
+                if(recordID == 28 || recordID == 29) {
+                    skipProperty(ifs, recordID);
+                    continue;
+                }
+                if(recordID != 7 && recordID != 8) {
+                    break;
+                }
+                // interned before the reference can move a buffered window.
+                std::string_view propname = intern(OasisReader::fromBytesStringView(ifs), ifs.isResident());
+                if(recordID == 8) {
+                    setPropname(OasisReader::fromBytesUnsigned(ifs), propname, true);
+                } else {
+                    addPropname(propname, true);
+                }
+            }
+
+            ifs.seek(curPos);
+
+        }
+
+    }
+
+    /// read a strict PROPSTRING table.
+    void extractPropstrings(ByteSource& ifs) {
+
+        if(propstringOffset == 0) {
+            return;
+        }
+
+        if(propstringFlag == 1) { //Strict
+
+            std::size_t curPos = ifs.tell();
+            ifs.seek(propstringOffset);
+
+            while(true) {
+                unsigned int recordID = OasisReader::fromBytesUnsigned(ifs);
+                OASIS_TRACE(TRACE_RECORD, "Record ID " << recordID << std::endl);
+                if(recordID == 34) {
+                    OasisReader::fromBytesCblock(ifs);
+                    continue;
+                }
+                if(recordID == 28 || recordID == 29) {
+                    skipProperty(ifs, recordID);
+                    continue;
+                }
+                if(recordID != 9 && recordID != 10) {
+                    break;
+                }
+                std::string_view propstring = intern(OasisReader::fromBytesStringView(ifs), ifs.isResident());
+                if(recordID == 10) {
+                    setPropstring(OasisReader::fromBytesUnsigned(ifs), propstring, true);
+                } else {
+                    addPropstring(propstring, true);
+                }
+            }
+
+            ifs.seek(curPos);
+
+        }
+
+    }
+
+    /// read a strict TEXTSTRING table into the text pool, see setTextPool.
+    void extractTextstrings(ByteSource& ifs) {
+
+        if(textstringOffset == 0) {
+            return;
+        }
+
+        if(textstringFlag == 1) { //Strict
+
+            std::size_t curPos = ifs.tell();
+            ifs.seek(textstringOffset);
+
+            while(true) {
+                unsigned int recordID = OasisReader::fromBytesUnsigned(ifs);
+                OASIS_TRACE(TRACE_RECORD, "Record ID " << recordID << std::endl);
+                if(recordID == 34) {
+                    OasisReader::fromBytesCblock(ifs);
+                    continue;
+                }
+                if(recordID == 28 || recordID == 29) {
+                    skipProperty(ifs, recordID);
+                    continue;
+                }
+                if(recordID != 5 && recordID != 6) {
+                    break;
+                }
+                // interned before the reference can move a buffered window.
+                unsigned int string = internText(OasisReader::fromBytesStringView(ifs));
+                if(recordID == 6) {
+                    setTextstring(OasisReader::fromBytesUnsigned(ifs), string);
+                } else {
+                    addTextstring(string);
+                }
             }
 
-            ifs.seekg(curPos, ifs.beg);
+            ifs.seek(curPos);
 
         }
 
     }
 
-    void extractLayernames(std::ifstream& ifs) {
+    void extractLayernames(ByteSource& ifs) {
 
         if(layernameOffset == 0) {
             return;
@@ -94,17 +295,26 @@ public:
 
         if(layernameFlag == 1) {
 
-            int curPos = ifs.tellg();
-            ifs.seekg(layernameOffset, ifs.beg);
+            std::size_t curPos = ifs.tell();
+            ifs.seek(layernameOffset);
 
             while(true) {
                 unsigned int recordID = OasisReader::fromBytesUnsigned(ifs);
-                std::cout << "Record ID " << recordID << std::endl;
+                OASIS_TRACE(TRACE_RECORD, "Record ID " << recordID << std::endl);
+                if(recordID == 34) {
+                    OasisReader::fromBytesCblock(ifs);
+                    continue;
+                }
+                if(recordID == 28 || recordID == 29) {
+                    skipProperty(ifs, recordID);
+                    continue;
+                }
                 if(recordID != 11) {
                     break;
                 }
                 unsigned int li1, li2, di1, di2;
-                std::string layername = OasisReader::fromBytesString(ifs);
+                // interned before the integers below can move a buffered window.
+                std::string_view layername = intern(OasisReader::fromBytesStringView(ifs), ifs.isResident());
                 unsigned int layer_interval_type = OasisReader::fromBytesUnsigned(ifs);
                 switch(layer_interval_type) {
                 case 3: //Only supported case atm
@@ -119,10 +329,10 @@ public:
                     di2 = di1;
                     break;
                 }
-                addLayername(layername, li1, li2, di1, di2);
+                addLayername(layername, li1, li2, di1, di2, true);
             }
 
-            ifs.seekg(curPos, ifs.beg);
+            ifs.seek(curPos);
 
         }
 
@@ -135,10 +345,10 @@ public:
         cellnameFlag = i;
     }
 
-    const unsigned int getCellnameOffset() const {
+    std::uint64_t getCellnameOffset() const {
         return cellnameOffset;
     }
-    void setCellnameOffset(unsigned int i) {
+    void setCellnameOffset(std::uint64_t i) {
         cellnameOffset = i;
     }
 
@@ -149,10 +359,10 @@ public:
         textstringFlag = i;
     }
 
-    const unsigned int getTextstringOffset() const {
+    std::uint64_t getTextstringOffset() const {
         return textstringOffset;
     }
-    void setTextstringOffset(unsigned int i) {
+    void setTextstringOffset(std::uint64_t i) {
         textstringOffset = i;
     }
 
@@ -163,10 +373,10 @@ public:
         propnameFlag = i;
     }
 
-    const unsigned int getPropnameOffset() const {
+    std::uint64_t getPropnameOffset() const {
         return propnameOffset;
     }
-    void setPropnameOffset(unsigned int i) {
+    void setPropnameOffset(std::uint64_t i) {
         propnameOffset = i;
     }
 
@@ -177,10 +387,10 @@ public:
         propstringFlag = i;
     }
 
-    const unsigned int getPropstringOffset() const {
+    std::uint64_t getPropstringOffset() const {
         return propstringOffset;
     }
-    void setPropstringOffset(unsigned int i) {
+    void setPropstringOffset(std::uint64_t i) {
         propstringOffset = i;
     }
 
@@ -191,10 +401,10 @@ public:
         layernameFlag = i;
     }
 
-    const unsigned int getLayernameOffset() const {
+    std::uint64_t getLayernameOffset() const {
         return layernameOffset;
     }
-    void setLayernameOffset(unsigned int i) {
+    void setLayernameOffset(std::uint64_t i) {
         layernameOffset = i;
     }
 
@@ -205,221 +415,770 @@ public:
         xnameFlag = i;
     }
 
-    const unsigned int getXnameOffset() const {
+    std::uint64_t getXnameOffset() const {
         return xnameOffset;
     }
-    void setXnameOffset(unsigned int i) {
+    void setXnameOffset(std::uint64_t i) {
         xnameOffset = i;
     }
 
 
-    unsigned int addCellname(std::string s) {
+    /// resident: s points into a source that outlives the table, so it is not copied.
+    std::string_view intern(std::string_view s, bool resident = false) {
+        return names.intern(s, resident);
+    }
+
+    unsigned int addCellname(std::string_view s, bool resident = false) {
         ++cellReferences;
-        cellnames[cellReferences] = s;
+        setCellname(cellReferences, s, resident);
         return cellReferences;
     }
-    std::map<unsigned int, std::string>& getCellnames() {
+    void setCellname(unsigned int reference, std::string_view s, bool resident = false) {
+        std::string_view name = intern(s, resident);
+        cellnames[reference] = name;
+        cellnameRefs[name] = reference;
+    }
+    tCellnames& getCellnames() {
         return cellnames;
     }
+    /// reference of a cell name, 0 if it has none.
+    unsigned int getCellReference(std::string_view s) const {
+        std::map<std::string_view, unsigned int>::const_iterator it = cellnameRefs.find(s);
+        return it != cellnameRefs.end() ? it->second : 0;
+    }
 
-    void addLayername(std::string s, unsigned int li1, unsigned int li2, unsigned int di1, unsigned int di2) {
-        layernames[std::make_tuple(li1, li2, di1, di2)] = s;
+    void addLayername(std::string_view s, unsigned int li1, unsigned int li2, unsigned int di1, unsigned int di2, bool resident = false) {
+        layernames[std::make_tuple(li1, li2, di1, di2)] = intern(s, resident);
     }
-    std::map<std::tuple<unsigned int, unsigned int, unsigned int, unsigned int>, std::string>& getLayernames() {
+    tLayernames& getLayernames() {
         return layernames;
     }
 
+    void setTextPool(layout::TextPool* pool) {
+        textPool = pool;
+    }
+    /// the number of a label string in the text pool.
+    unsigned int internText(std::string_view s) {
+        return textPool->intern(s);
+    }
+    /// a TEXTSTRING record with a reference number. string is from internText.
+    void setTextstring(unsigned int reference, unsigned int string) {
+        textstrings[reference] = string;
+    }
+    /// a TEXTSTRING record without one: they are numbered from 0 in file order.
+    void addTextstring(unsigned int string) {
+        setTextstring(textReferences++, string);
+    }
+    const tTextstrings& getTextstrings() const {
+        return textstrings;
+    }
+    /// the text pool number of a TEXTSTRING reference.
+    unsigned int getTextstring(unsigned int reference) const {
+        tTextstrings::const_iterator it = textstrings.find(reference);
+        if(it == textstrings.end()) {
+            throw std::exception("Unknown text string reference.");
+        }
+        return it->second;
+    }
 
-};
-
-std::ostream& operator<<(std::ostream& o, const TableOffsets& to);
-
-
-
-template<class pointT>
-class OasisFileManager {
-public:
-    OasisFileManager()
-    {}
+    void setPropname(unsigned int reference, std::string_view s, bool resident = false) {
+        std::string_view name = intern(s, resident);
+        propnames[reference] = name;
+        propnameRefs[name] = reference;
+    }
+    /// a PROPNAME record without a reference: they are numbered from 0 in file order.
+    void addPropname(std::string_view s, bool resident = false) {
+        setPropname(propnameReferences++, s, resident);
+    }
+    const tPropnames& getPropnames() const {
+        return propnames;
+    }
+    std::string_view getPropname(unsigned int reference) const {
+        tPropnames::const_iterator it = propnames.find(reference);
+        if(it == propnames.end()) {
+            throw std::exception("Unknown property name reference.");
+        }
+        return it->second;
+    }
+    /// the reference of a property name, given the next free one if it has none.
+    unsigned int propnameReference(std::string_view s) {
+        std::map<std::string_view, unsigned int>::const_iterator it = propnameRefs.find(s);
+        if(it != propnameRefs.end()) {
+            return it->second;
+        }
+        addPropname(s);
+        return propnameReferences - 1;
+    }
 
-    void readOasisFile(std::ifstream& ifs, layout::Layout<pointT>& outLayout) {
+    void setPropstring(unsigned int reference, std::string_view s, bool resident = false) {
+        propstrings[reference] = intern(s, resident);
+    }
+    /// a PROPSTRING record without a reference, numbered like PROPNAMEs.
+    void addPropstring(std::string_view s, bool resident = false) {
+        setPropstring(propstringReferences++, s, resident);
+    }
+    std::string_view getPropstring(unsigned int reference) const {
+        tPropstrings::const_iterator it = propstrings.find(reference);
+        if(it == propstrings.end()) {
+            throw std::exception("Unknown property string reference.");
+        }
+        return it->second;
+    }
 
-        std::cout << "Start Reader" << std::endl;
+    /// read a PROPERTY record (28) after its record ID into property, which
+    /// holds the previous one: a name or values the record leaves out keep
+    /// their previous values. 29 repeats the previous property as it is.
+    void readProperty(ByteSource& ifs, unsigned int recordID, layout::Property& property) const {
 
-        char magic[12] = {0};
-        ifs.read(magic, 12);
-        int i;
-        for(i=0; i<12; ++i) {
-            //std::cout << std::hex << (int)(magic[i]) << " ";
-            if(magic[i] != MAGIC[i]) {
-                std::cout << std::endl << "Mismatch";
-                throw std::exception("Magic bytes do not match.");
+        if(recordID == 29) {
+            return;
+        }
+        unsigned char property_info = OasisReader::fromBytesChar(ifs);
+        OASIS_TRACE(TRACE_DETAIL, "Property Info " << std::bitset<8>((int)property_info).to_string() << std::endl);
+        bool S = property_info & 1;
+        bool N = property_info & 2;
+        bool C = property_info & 4;
+        bool V = property_info & 8;
+        unsigned int count = property_info >> 4;
+
+        if(C) {
+            if(N) {
+                property.name = std::string(getPropname(OasisReader::fromBytesUnsigned(ifs)));
+            } else {
+                property.name = OasisReader::fromBytesString(ifs);
             }
+            OASIS_TRACE(TRACE_DETAIL, "Property Name " << property.name << std::endl);
         }
-        //std::cout << std::endl;
-
-        std::cout << "Start Record" << std::endl;
-
-        TableOffsets table = readStartRecord(ifs);
-        std::cout << table << std::endl;
-        std::cout << "Extract Cellnames" << std::endl;
-        table.extractCellnames(ifs);
-        std::cout << "Extract Layernames" << std::endl;
-        table.extractLayernames(ifs);
-        std::map<unsigned int, std::string>& cellnames = table.getCellnames();
-
-        std::cout << "Cells" << std::endl;
+        property.standard = S;
+        if(!V) {
+            if(count == 15) {
+                count = OasisReader::fromBytesUnsigned(ifs);
+            }
+            property.values.clear();
+            property.values.reserve(count);
+            unsigned int i;
+            for(i=0; i<count; ++i) {
+                property.values.push_back(readPropertyValue(ifs));
+            }
+        }
+    }
 
-        //Read in Records
-        bool done = false;
-        while(!done) {
+    layout::PropertyValue readPropertyValue(ByteSource& ifs) const {
 
-            unsigned int recordID = OasisReader::fromBytesUnsigned(ifs);
-            std::cout << "Record ID : " << recordID << std::endl;
+        unsigned int type = OasisReader::fromBytesUnsigned(ifs);
+        switch(type) {
+        case 8:
+        {
+            // file offsets, e.g. S_CELL_OFFSET, may need more than 32 bits.
+            std::uint64_t u = OasisReader::fromBytesUnsigned64(ifs);
+            if(u <= std::numeric_limits<unsigned int>::max()) {
+                return layout::PropertyValue((unsigned int)u);
+            }
+            return layout::PropertyValue(u);
+        }
+        case 9:
+        {
+            // as wide as the coordinates of a 64-bit layout.
+            std::int64_t s = OasisReader::fromBytesSigned64(ifs);
+            if(s >= std::numeric_limits<int>::min() && s <= std::numeric_limits<int>::max()) {
+                return layout::PropertyValue((int)s);
+            }
+            return layout::PropertyValue(s);
+        }
+        case 10: //a-string
+        case 11: //b-string
+        case 12: //n-string
+            return layout::PropertyValue(OasisReader::fromBytesString(ifs));
+        case 13: //the same by PROPSTRING reference
+        case 14:
+        case 15:
+            return layout::PropertyValue(std::string(getPropstring(OasisReader::fromBytesUnsigned(ifs))));
+        default:
+            if(type > 7) {
+                throw std::exception("Invalid property value type.");
+            }
+            // a real, whose own type is the value type.
+            ifs.unget();
+            return layout::PropertyValue(OasisReader::fromBytesReal(ifs));
+        }
+    }
 
-            switch(recordID) {
+    /// move past a PROPERTY record (28 or 29) after its record ID.
+    static void skipProperty(ByteSource& ifs, unsigned int recordID) {
 
-            case 2: //End Record
-            {
-                done = true;
-                //Potentially do something with the validation scheme
-                break;
+        if(recordID == 29) {
+            return;
+        }
+        unsigned char info = OasisReader::fromBytesChar(ifs);
+        if(info & 4) {
+            if(info & 2) {
+                OasisReader::skipUnsigned(ifs, 1);
+            } else {
+                OasisReader::skipString(ifs);
             }
-
-            case 4: //Cellname with reference number
-            {
-                if(table.getCellnameFlag() == 1) { //Strict
-                    char len[1]; //String length
-                    ifs.read(len, 1);
-                    std::cout << "Skip " << len[0]+1 << " bytes" << std::endl;
-                    ifs.seekg(len[0]+1, ifs.cur);
-                } else {
-                    std::string cellname = OasisReader::fromBytesString(ifs);
-                    unsigned int reference = OasisReader::fromBytesUnsigned(ifs);
-                    std::cout << "Cellname : " << cellname << std::endl;
-                    std::cout << "Reference : " << reference << std::endl;
-                    cellnames[reference] = cellname;
-                }
-                break;
+        }
+        if((info & 8) == 0) {
+            unsigned int count = info >> 4;
+            if(count == 15) {
+                count = OasisReader::fromBytesUnsigned(ifs);
             }
-
-            case 11:
-            {
-                if(table.getLayernameFlag() == 1) {
-                    char len[1]; //String length
-                    ifs.read(len, 1);
-                    std::cout << "Skip " << len[0]+4 << " bytes" << std::endl;
-                    ifs.seekg(len[0]+4, ifs.cur);
+            unsigned int i;
+            for(i=0; i<count; ++i) {
+                unsigned int type = OasisReader::fromBytesUnsigned(ifs);
+                if(type >= 10 && type <= 12) {
+                    OasisReader::skipString(ifs);
+                } else if(type >= 8 && type <= 15) {
+                    OasisReader::skipUnsigned(ifs, 1);
+                } else if(type <= 7) {
+                    ifs.unget();
+                    OasisReader::fromBytesReal(ifs);
                 } else {
-                    unsigned int li1, li2, di1, di2;
-                    std::string layername = OasisReader::fromBytesString(ifs);
-                    unsigned int layer_interval_type = OasisReader::fromBytesUnsigned(ifs);
-                    switch(layer_interval_type) {
-                    case 3: //Only supported case atm
-                        li1 = OasisReader::fromBytesUnsigned(ifs);
-                        li2 = li1;
-                        break;
-                    }
-                    unsigned int data_interval_type = OasisReader::fromBytesUnsigned(ifs);
-                    switch(data_interval_type) {
-                    case 3: //Only supported case atm
-                        di1 = OasisReader::fromBytesUnsigned(ifs);
-                        di2 = di1;
-                        break;
-                    }
-                    table.addLayername(layername, li1, li2, di1, di2);
+                    throw std::exception("Invalid property value type.");
                 }
-                break;
-            }
-
-            case 13: //Cell with reference number
-            {
-                unsigned int reference = OasisReader::fromBytesUnsigned(ifs);
-                std::string cellname = cellnames.find(reference)->second;
-                //Add functionality to look up cellname table if the reference hasn't been added yet
-                std::cout << "Cellname : " << cellname << std::endl;
-                std::cout << "Reference : " << reference << std::endl;
-
-                layout::Cell<pointT>* cell = outLayout.newCell(cellname);
-                readCellRecord(ifs, table, cell);
-
-                break;
             }
+        }
+    }
 
+    /// the standard properties of the CELLNAME record reference; others are
+    /// of no use before the cell is read.
+    void setCellnameProperty(unsigned int reference, const layout::Property& property) {
 
+        if(!property.standard) {
+            return;
+        }
+        const std::vector<layout::PropertyValue>& v = property.values;
+        if(property.name == "S_CELL_OFFSET" && v.size() == 1) {
+            // 0: the cell is not in this file.
+            if(layout::propertyInteger(v[0]) != 0) {
+                setCellOffset(reference, (std::uint64_t)layout::propertyInteger(v[0]));
             }
+        } else if(property.name == "S_BOUNDING_BOX" && v.size() == 5) {
+            CellBBox box = {(unsigned int)layout::propertyInteger(v[0]),
+                            layout::propertyInteger(v[1]), layout::propertyInteger(v[2]),
+                            (std::uint64_t)layout::propertyInteger(v[3]), (std::uint64_t)layout::propertyInteger(v[4])};
+            cellBBoxes[reference] = box;
+        }
+    }
 
-            if(ifs.eof()) {
-                done = true;
-                throw std::exception("Failed to find End Record.");
-            }
+    void setCellOffset(unsigned int reference, std::uint64_t offset) {
+        cellOffsets[reference] = offset;
+    }
+    const std::map<unsigned int, std::uint64_t>& getCellOffsets() const {
+        return cellOffsets;
+    }
 
+    /// false if the cell has no S_BOUNDING_BOX.
+    bool getCellBBox(unsigned int reference, CellBBox& box) const {
+        std::map<unsigned int, CellBBox>::const_iterator it = cellBBoxes.find(reference);
+        if(it == cellBBoxes.end()) {
+            return false;
         }
-
+        box = it->second;
+        return true;
     }
 
-    void writeOasisFile(const layout::Layout<pointT>* layout, std::string name) {
+    void setFilePropertyOffset(std::size_t offset) {
+        filePropertyOffset = offset;
+    }
+    std::size_t getFilePropertyOffset() const {
+        return filePropertyOffset;
+    }
 
-        std::cout << "Start Writer" << std::endl;
+    void setValidation(unsigned int scheme, std::uint32_t sig, std::size_t length) {
+        validationScheme = scheme;
+        signature = sig;
+        signedLength = length;
+    }
+    unsigned int getValidationScheme() const {
+        return validationScheme;
+    }
+    std::uint32_t getSignature() const {
+        return signature;
+    }
+    std::size_t getSignedLength() const {
+        return signedLength;
+    }
 
-        std::ofstream ofs;
-        OasisWriter ow(&ofs);
 
-        ofs.open(name, std::ios::out);
+};
 
-        //magic bytes
+std::ostream& operator<<(std::ostream& o, const TableOffsets& to);
 
-        ofs.write(MAGIC, 12);
-        ow.increasePos(12);
 
-        //Start Record
 
-        //Record ID
-        ow.toBytesUnsigned(1);
-        ow.toBytesString(VERSION);
-        //Unit
-        ow.toBytesReal(POSITIVE_WHOLE, 1000);
-        //offset-flag, Table Offsets stored in End Record
-        ow.toBytesUnsigned(1);
+template<class pointT>
+class OasisFileManager {
+public:
+    typedef typename pointT::coord_type coord_type;
 
-        TableOffsets table( 1, 0,
-                           1, 0,
-                           1, 0,
-                           1, 0,
-                           1, 0,
-                           1, 0 );
+protected:
+    bool mappedOutput = false;
+    /// threads decoding cells. 0 means one per core, 1 reads sequentially.
+    unsigned int readThreads = 0;
+    int compression = 0;
+    /// validation scheme of the END record, see VALIDATION_CRC32.
+    unsigned int validation = VALIDATION_CRC32;
+    bool detectRepetitions = false;
+    /// milliseconds the writer may spend looking for repetitions, 0 for no limit.
+    unsigned int repetitionTimeLimit = 0;
 
-        std::cout << "Writing Cells" << std::endl;
-        //Cells
-        typename std::map<std::string, layout::Cell<pointT>*>::const_iterator it;
-        for(it = layout->getCells().begin(); it != layout->getCells().end(); ++it) {
+public:
+    /// what the repetition pass of the last writeOasisFile achieved.
+    struct RepetitionReport {
+        /// shapes the pass looked at and the records written for them.
+        std::size_t shapes = 0;
+        std::size_t records = 0;
+        /// bytes those shapes take written one record each, and as written.
+        std::size_t plainBytes = 0;
+        std::size_t bytes = 0;
+        double milliseconds = 0.0;
+    };
 
-            const layout::Cell<pointT>* cell = it->second;
+protected:
+    RepetitionReport report;
+
+    /// a PLACEMENT record, the placed cell still by reference number or name.
+    /// fields a record leaves out keep the previous record's values.
+    struct PlacementRecord {
+        bool byName = false;
+        unsigned int reference = 0;
+        std::string name;
+        coord_type x = 0;
+        coord_type y = 0;
+        double angle = 0.0;
+        bool mirror = false;
+        double magnification = 1.0;
+        layout::Repetition<pointT> repetition;
+    };
+
+    /// the modal variables while reading one cell. fields a record leaves
+    /// out take the value the last record gave them; after XYRELATIVE,
+    /// X and Y are added to the previous position. a CELL record starts
+    /// afresh, with the positions at 0.
+    struct Modal {
+        bool relative = false;
+        unsigned int layer = 0;
+        unsigned int datatype = 0;
+        unsigned int width = 0;
+        unsigned int height = 0;
+        unsigned int radius = 0;
+        unsigned int ctrapezoidType = 0;
+        /// geometry-x and geometry-y, shared by all shapes.
+        coord_type x = 0;
+        coord_type y = 0;
+        oasisio::PointList polygon{POINT_LIST_4};
+        unsigned int halfWidth = 0;
+        coord_type startExtension = 0;
+        coord_type endExtension = 0;
+        oasisio::PointList path{POINT_LIST_4};
+        /// the last PROPERTY record's name and values.
+        layout::Property property;
+        /// text-string, as its number in the text pool, and the TEXT
+        /// record's own layer, type and position.
+        unsigned int textString = 0;
+        unsigned int textlayer = 0;
+        unsigned int texttype = 0;
+        coord_type textX = 0;
+        coord_type textY = 0;
+        layout::Repetition<pointT> repetition;
+        /// placement-cell, placement-x and placement-y.
+        PlacementRecord placement;
+    };
+
+    /// what a PROPERTY record in a cell belongs to: the cell until the first
+    /// element, then the element read last. with layer null after that, the
+    /// element is a placement or a text, whose properties are not kept.
+    struct PropertyOwner {
+        bool cell = true;
+        layout::Layer<pointT>* layer = nullptr;
+        /// null for a rectangle of the layer's arrays, number rect.
+        layout::iShape<pointT>* shape = nullptr;
+        std::size_t rect = 0;
+    };
+
+    /// the modal variables as the records written so far in a cell left
+    /// them. a field equal to its modal value is left out. the writer always
+    /// uses XYRELATIVE.
+    struct WrittenModal {
+        std::optional<unsigned int> layer;
+        std::optional<unsigned int> datatype;
+        std::optional<unsigned int> width;
+        std::optional<unsigned int> height;
+        std::optional<unsigned int> radius;
+        std::optional<unsigned int> ctrapezoidType;
+        coord_type x = 0;
+        coord_type y = 0;
+        std::optional<oasisio::PointList> polygon;
+        std::optional<unsigned int> halfWidth;
+        std::optional<coord_type> startExtension;
+        std::optional<coord_type> endExtension;
+        std::optional<oasisio::PointList> path;
+        std::optional<unsigned int> propname;
+        std::optional<unsigned int> textString;
+        std::optional<unsigned int> textlayer;
+        std::optional<unsigned int> texttype;
+        coord_type textX = 0;
+        coord_type textY = 0;
+        std::optional<layout::Repetition<pointT> > repetition;
+        std::optional<unsigned int> placementCell;
+        coord_type placementX = 0;
+        coord_type placementY = 0;
+    };
+
+    /// false, leaving the field out, if v is the modal value. otherwise v
+    /// becomes the modal value.
+    template<typename T, typename V>
+    static bool changed(std::optional<T>& modal, const V& v) {
+        if(modal && *modal == (T)v) {
+            return false;
+        }
+        modal = (T)v;
+        return true;
+    }
 
-            unsigned int ref = table.addCellname(cell->getName());
+    /// CTRAPEZOID types 0-23 as trapezoids: the orientation, and delta-a and
+    /// delta-b in units of the side across the parallel ones (the height, or
+    /// the width if vertical). types 24 and 25 are rectangles.
+    struct CTrapezoid {
+        bool vertical;
+        int a;
+        int b;
+    };
+    static const CTrapezoid& ctrapezoidDeltas(unsigned int type) {
+        static const CTrapezoid types[24] = {
+            {false, 0, -1}, {false, 0, 1}, {false, 1, 0}, {false, -1, 0},
+            {false, 1, -1}, {false, -1, 1}, {false, 1, 1}, {false, -1, -1},
+            {true, 0, -1}, {true, 0, 1}, {true, 1, 0}, {true, -1, 0},
+            {true, 1, -1}, {true, -1, 1}, {true, 1, 1}, {true, -1, -1},
+            // triangles
+            {false, 0, -1}, {false, 0, 1}, {false, 1, 0}, {false, -1, 0},
+            {false, 1, -1}, {false, -1, 1}, {true, 1, -1}, {true, -1, 1}
+        };
+        return types[type];
+    }
+    /// the CTRAPEZOID type leaves its width out: it is twice the height.
+    static bool ctrapezoidImpliesWidth(unsigned int type) {
+        return type == 20 || type == 21;
+    }
+    /// the CTRAPEZOID type leaves its height out: it is the width, or twice it.
+    static bool ctrapezoidImpliesHeight(unsigned int type) {
+        return (type >= 16 && type <= 19) || type == 22 || type == 23 || type == 25;
+    }
+    /// set the width or height the type implies.
+    static void ctrapezoidSize(unsigned int type, unsigned int& width, unsigned int& height) {
+        if(ctrapezoidImpliesWidth(type)) {
+            width = 2 * height;
+        } else if(type == 22 || type == 23) {
+            height = 2 * width;
+        } else if(ctrapezoidImpliesHeight(type)) {
+            height = width;
+        }
+    }
 
-            //Record ID
-            ow.toBytesUnsigned(13);
-            //Reference Number
-            ow.toBytesUnsigned(ref);
-            //XYABSOLUTE record
-            ow.toBytesUnsigned(15);
+    /// byte range of one CELL record's contents, found by the scan phase.
+    /// bbox and placements are only filled when the scan measures the cells.
+    struct CellSpan {
+        std::string_view name;
+        std::size_t begin;
+        std::size_t end;
+        layout::Box<pointT> bbox;
+        std::vector<PlacementRecord> placements;
+    };
 
-            writeCellRecord(ow, table, cell);
+public:
+    OasisFileManager()
+    {}
 
-        }
+    unsigned int getReadThreads() const {
+        return readThreads;
+    }
+    void setReadThreads(unsigned int n) {
+        readThreads = n;
+    }
 
+    /// write straight into a memory mapping of the output file instead of
+    /// through a buffered std::ofstream.
+    bool getMappedOutput() const {
+        return mappedOutput;
+    }
+    void setMappedOutput(bool b) {
+        mappedOutput = b;
+    }
 
-        std::cout << "Cellnames" << std::endl;
-        //Cellname Records
-        if(table.getCellnames().size() > 0) {
+    /// DEFLATE level (1-9) of the CBLOCK written for each cell's contents.
+    /// 0 writes cells uncompressed.
+    int getCompression() const {
+        return compression;
+    }
+    void setCompression(int level) {
+        compression = level;
+    }
 
-            unsigned int pos = ow.getPos();
-            table.setCellnameOffset(pos);
-            std::cout << ofs.tellp() << std::endl;
+    /// signature written into the END record: VALIDATION_NONE,
+    /// VALIDATION_CRC32 or VALIDATION_CHECKSUM32. it is kept as the file is
+    /// written, so it costs no second pass.
+    unsigned int getValidation() const {
+        return validation;
+    }
+    void setValidation(unsigned int scheme) {
+        validation = scheme;
+    }
 
-            typename std::map<unsigned int, std::string>::const_iterator it2 = table.getCellnames().begin();
-            for(; it2 != table.getCellnames().end(); ++it2) {
+    /// group identical shapes of a layer into repetitions when writing.
+    bool getDetectRepetitions() const {
+        return detectRepetitions;
+    }
+    void setDetectRepetitions(bool b) {
+        detectRepetitions = b;
+    }
+    /// once the limit is spent, the remaining shapes are written one by one.
+    unsigned int getRepetitionTimeLimit() const {
+        return repetitionTimeLimit;
+    }
+    void setRepetitionTimeLimit(unsigned int ms) {
+        repetitionTimeLimit = ms;
+    }
+    const RepetitionReport& getRepetitionReport() const {
+        return report;
+    }
+
+    /// read a layout through a memory mapping of the file. a validation
+    /// signature in the END record is checked alongside.
+    void readOasisFile(const std::string& name, layout::Layout<pointT>& outLayout) {
+        MappedByteSource src(name);
+        readOasisFile(src, outLayout);
+    }
+
+    /// read a layout from an already opened stream, in large buffered blocks.
+    void readOasisFile(std::ifstream& ifs, layout::Layout<pointT>& outLayout) {
+        BufferedByteSource src(ifs);
+        readOasisFile(src, outLayout);
+    }
+
+    void readOasisFile(ByteSource& ifs, layout::Layout<pointT>& outLayout) {
+
+        OASIS_TRACE(TRACE_SUMMARY, "Start Reader" << std::endl);
+
+        TableOffsets table = readHeader(ifs, outLayout);
+
+        // a resident file is signed on a thread of its own while the records
+        // are decoded; the future waits for it even if decoding throws.
+        unsigned int scheme = table.getValidationScheme();
+        std::future<std::uint32_t> signature;
+        if(scheme != VALIDATION_NONE && ifs.isResident()) {
+            std::size_t pos = ifs.tell();
+            ifs.seek(0);
+            const byte* data = ifs.data();
+            std::size_t length = std::min(table.getSignedLength(), ifs.ensure(table.getSignedLength()));
+            ifs.seek(pos);
+            signature = std::async(std::launch::async, [scheme, data, length]() {
+                return validationSignature(scheme, 0, data, length);
+            });
+        }
+
+        // with more than one thread, cells are only located here and
+        // decoded afterwards by readCells.
+        unsigned int threads = readThreads ? readThreads : std::max(1u, std::thread::hardware_concurrency());
+        std::vector<CellSpan> spans;
+
+        OASIS_TRACE(TRACE_SUMMARY, "Cells" << std::endl);
+
+        //Every cell has a known offset: no need to scan the file
+        if(threads == 1 || !findCellSpans(ifs, table, spans)) {
+            readRecords(ifs, table, outLayout, threads > 1 ? &spans : nullptr);
+        }
+
+        if(!spans.empty()) {
+            readCells(ifs, table, spans, threads, outLayout);
+        }
+
+        readFileProperties(ifs, table, outLayout);
+
+        if(scheme != VALIDATION_NONE) {
+            std::uint32_t computed = signature.valid() ? signature.get() : signSource(ifs, scheme, table.getSignedLength());
+            if(computed != table.getSignature()) {
+                throw std::exception("Validation signature does not match.");
+            }
+        }
+
+    }
+
+    /// open a layout for browsing. only the START record, the name tables and
+    /// the position of each cell are read here; a cell's shapes are decoded
+    /// from the memory mapping when the cell is first drawn, queried or written.
+    /// the validation signature is not checked, as that reads the whole file.
+    void openOasisFile(const std::string& name, layout::Layout<pointT>& outLayout) {
+
+        OASIS_TRACE(TRACE_SUMMARY, "Open " << name << std::endl);
+
+        // shared with the cells' loaders, which may run long after this returns.
+        std::shared_ptr<MappedByteSource> src(new MappedByteSource(name));
+        std::shared_ptr<TableOffsets> table(new TableOffsets(readHeader(*src, outLayout)));
+
+        // without an offset for every cell, one pass over the records finds the
+        // cells, their extents and their placements without building any shapes.
+        std::vector<CellSpan> spans;
+        bool measured = false;
+        if(!findCellSpans(*src, *table, spans)) {
+            readRecords(*src, *table, outLayout, &spans, true);
+            measured = true;
+        }
+        readFileProperties(*src, *table, outLayout);
+
+        OasisFileManager<pointT> reader(*this);
+        std::vector<layout::Cell<pointT>*> cells(spans.size(), nullptr);
+        std::size_t i;
+        for(i=0; i<spans.size(); ++i) {
+            std::size_t len = spans[i].end - spans[i].begin;
+            src->seek(spans[i].begin);
+            const byte* data = src->data();
+            len = std::min(len, src->ensure(len));
+
+            // the hierarchy is needed up front to tell the top cells.
+            if(!measured) {
+                SpanByteSource cellSrc(data, len);
+                skipCellRecord(cellSrc, nullptr, &spans[i].placements);
+            }
+
+            std::string cellname(spans[i].name);
+            bool known = measured && outLayout.getCell(cellname) == nullptr;
+            layout::Cell<pointT>* cell = outLayout.newCell(cellname);
+            // placements were read above; loading only adds the shapes.
+            cell->addLoader([src, table, data, len, reader](layout::Cell<pointT>& c) mutable {
+                SpanByteSource cellSrc(data, len);
+                reader.readCellRecord(cellSrc, *table, &c);
+            });
+            // the file's S_BOUNDING_BOX, placed cells included, spares loading
+            // the cell to cull it. without one, a cell named twice gets its
+            // extent from loading both parts.
+            TableOffsets::CellBBox indexed;
+            if(table->getCellBBox(table->getCellReference(spans[i].name), indexed)) {
+                if((indexed.flags & 2) == 0) {
+                    cell->setBBox(layout::Box<pointT>(indexed.x, indexed.y, indexed.x + indexed.width, indexed.y + indexed.height));
+                }
+            } else if(known) {
+                cell->setBBox(spans[i].bbox);
+            }
+            cells[i] = cell;
+        }
+        // after all cells exist, so a placement never makes an empty cell
+        // under the name of one still to come.
+        for(i=0; i<spans.size(); ++i) {
+            addPlacements(*table, outLayout, cells[i], spans[i].placements);
+        }
+        OASIS_TRACE(TRACE_SUMMARY, spans.size() << " cells opened" << std::endl);
+
+    }
+
+    void writeOasisFile(const layout::Layout<pointT>* layout, std::string name) {
+
+        OASIS_TRACE(TRACE_SUMMARY, "Start Writer" << std::endl);
+
+        // a lazily opened layout may still be reading from the file replaced here.
+        typename std::map<std::string, layout::Cell<pointT>*>::const_iterator cit;
+        for(cit = layout->getCells().begin(); cit != layout->getCells().end(); ++cit) {
+            cit->second->ensureLoaded();
+        }
+
+        std::unique_ptr<ByteSink> sink;
+        std::ofstream ofs;
+        if(mappedOutput) {
+            sink.reset(new MappedByteSink(name));
+        } else {
+            ofs.open(name, std::ios::out | std::ios::binary);
+            sink.reset(new StreamByteSink(ofs));
+        }
+        OasisWriter ow(*sink);
+        ow.setValidation(validation);
+        report = RepetitionReport();
+
+        //magic bytes
+
+        ow.toBytesRaw(MAGIC, 12);
+
+        //Start Record
+
+        //Record ID
+        ow.toBytesUnsigned(1);
+        ow.toBytesString(VERSION);
+        //Unit
+        if(layout->getUnit() == (unsigned int)layout->getUnit()) {
+            ow.toBytesReal(POSITIVE_WHOLE, layout->getUnit());
+        } else {
+            ow.toBytesReal(DOUBLE_PRECISION_FLOAT, layout->getUnit());
+        }
+        //offset-flag, Table Offsets stored in End Record
+        ow.toBytesUnsigned(1);
+
+        TableOffsets table( 1, 0,
+                           1, 0,
+                           1, 0,
+                           1, 0,
+                           1, 0,
+                           1, 0 );
+
+        //File Properties
+        WrittenModal fileModal;
+        writeProperties(ow, fileModal, table, layout->getProperties());
+
+        VectorByteSink cellSink;
+        OasisWriter cellWriter(cellSink);
+
+        // every cell gets its reference before any is written, so a PLACEMENT
+        // can refer to a cell written after it.
+        typename std::map<std::string, layout::Cell<pointT>*>::const_iterator it;
+        for(it = layout->getCells().begin(); it != layout->getCells().end(); ++it) {
+            table.addCellname(it->second->getName());
+        }
+
+        OASIS_TRACE(TRACE_SUMMARY, "Writing Cells" << std::endl);
+        //Cells
+        for(it = layout->getCells().begin(); it != layout->getCells().end(); ++it) {
+
+            const layout::Cell<pointT>* cell = it->second;
+
+            unsigned int ref = table.getCellReference(cell->getName());
+            table.setCellOffset(ref, ow.getPos());
+
+            //Record ID
+            ow.toBytesUnsigned(13);
+            //Reference Number
+            ow.toBytesUnsigned(ref);
+            //XYRELATIVE record
+            ow.toBytesUnsigned(16);
+
+            if(compression > 0) {
+                // the cell's records are collected in memory, then written as one CBLOCK.
+                cellSink.clear();
+                writeCellRecord(cellWriter, table, cell);
+                if(cellSink.size() > 0) {
+                    ow.toBytesCblock(cellSink.data(), cellSink.size(), compression);
+                }
+            } else {
+                writeCellRecord(ow, table, cell);
+            }
+
+        }
+
+
+        if(detectRepetitions) {
+            OASIS_TRACE(TRACE_SUMMARY, "Repetitions: " << report.shapes << " shapes in " << report.records << " records, "
+                        << report.plainBytes << " -> " << report.bytes << " bytes, "
+                        << report.milliseconds << " ms" << std::endl);
+        }
+
+        OASIS_TRACE(TRACE_SUMMARY, "Cellnames" << std::endl);
+        //Cellname Records
+        if(table.getCellnames().size() > 0) {
+
+            std::uint64_t pos = ow.getPos();
+            table.setCellnameOffset(pos);
+            OASIS_TRACE(TRACE_SUMMARY, pos << std::endl);
+
+            // the table's property names start afresh, as a reader seeking here does.
+            WrittenModal tableModal;
+            typename TableOffsets::tCellnames::const_iterator it2 = table.getCellnames().begin();
+            for(; it2 != table.getCellnames().end(); ++it2) {
 
                 //Record ID
                 ow.toBytesUnsigned(4);
@@ -428,18 +1187,63 @@ public:
                 //Reference Number
                 ow.toBytesUnsigned(it2->first);
 
+                writeCellnameProperties(ow, tableModal, table, it2->first, layout->getCell(std::string(it2->second)));
+
+            }
+
+        }
+
+        OASIS_TRACE(TRACE_SUMMARY, "Propnames" << std::endl);
+        //Propname Records
+        if(table.getPropnames().size() > 0) {
+
+            std::uint64_t pos = ow.getPos();
+            table.setPropnameOffset(pos);
+
+            typename TableOffsets::tPropnames::const_iterator it2 = table.getPropnames().begin();
+            for(; it2 != table.getPropnames().end(); ++it2) {
+
+                //Record ID
+                ow.toBytesUnsigned(8);
+                //Name String
+                ow.toBytesString(it2->second);
+                //Reference Number
+                ow.toBytesUnsigned(it2->first);
+
+            }
+
+        }
+
+        OASIS_TRACE(TRACE_SUMMARY, "Textstrings" << std::endl);
+        //Textstring Records, the whole text pool
+        const layout::TextPool& texts = layout->getTextPool();
+        if(!texts.empty()) {
+
+            std::uint64_t pos = ow.getPos();
+            table.setTextstringOffset(pos);
+
+            unsigned int ref;
+            for(ref=0; ref<texts.size(); ++ref) {
+
+                //Record ID
+                ow.toBytesUnsigned(6);
+                //Text String
+                ow.toBytesString(texts.get(ref));
+                //Reference Number
+                ow.toBytesUnsigned(ref);
+
             }
 
         }
 
-        std::cout << "Layernames" << std::endl;
+        OASIS_TRACE(TRACE_SUMMARY, "Layernames" << std::endl);
         //Layername Records
         if(table.getLayernames().size() > 0) {
 
-            unsigned int pos = ow.getPos();
+            std::uint64_t pos = ow.getPos();
             table.setLayernameOffset(pos);
 
-            typename std::map<std::tuple<unsigned int, unsigned int, unsigned int, unsigned int>, std::string>::const_iterator it = table.getLayernames().begin();
+            typename TableOffsets::tLayernames::const_iterator it = table.getLayernames().begin();
             for(; it != table.getLayernames().end(); ++it) {
 
                 //Only handling Type 3 intervals right now
@@ -471,84 +1275,99 @@ public:
         //Record ID
         ow.toBytesUnsigned(2);
 
-        std::cout << table << std::endl;
+        OASIS_TRACE(TRACE_SUMMARY, table << std::endl);
 
         //Table Offsets
         ow.toBytesUnsigned(table.getCellnameFlag());
-        ow.toBytesUnsigned(table.getCellnameOffset());
+        ow.toBytesUnsigned64(table.getCellnameOffset());
 
         ow.toBytesUnsigned(table.getTextstringFlag());
-        ow.toBytesUnsigned(table.getTextstringOffset());
+        ow.toBytesUnsigned64(table.getTextstringOffset());
 
         ow.toBytesUnsigned(table.getPropnameFlag());
-        ow.toBytesUnsigned(table.getPropnameOffset());
+        ow.toBytesUnsigned64(table.getPropnameOffset());
 
         ow.toBytesUnsigned(table.getPropstringFlag());
-        ow.toBytesUnsigned(table.getPropstringOffset());
+        ow.toBytesUnsigned64(table.getPropstringOffset());
 
         ow.toBytesUnsigned(table.getLayernameFlag());
-        ow.toBytesUnsigned(table.getLayernameOffset());
+        ow.toBytesUnsigned64(table.getLayernameOffset());
 
         ow.toBytesUnsigned(table.getXnameFlag());
-        ow.toBytesUnsigned(table.getXnameOffset());
+        ow.toBytesUnsigned64(table.getXnameOffset());
 
-        unsigned int numPadding = 256 - 1 - tableNumBytes(table) - 1;
+        //Padding String, its length always in two bytes so that any padding fits
+        unsigned int numPadding = 256 - 1 - tableNumBytes(table) - 2 - 1 - (validation != VALIDATION_NONE ? 4 : 0);
+        ow.toBytesChar((char)((numPadding & 0x7f) | 0x80));
+        ow.toBytesChar((char)(numPadding >> 7));
         unsigned int i;
         for(i=0; i<numPadding; ++i) {
             ow.toBytesChar(0);
         }
 
-        //Validation Scheme - None
-        ow.toBytesUnsigned(0);
+        //Validation Scheme
+        ow.toBytesUnsigned(validation);
+        if(validation != VALIDATION_NONE) {
+            //Validation Signature, least significant byte first
+            std::uint32_t signature = ow.getSignature();
+            for(i=0; i<4; ++i) {
+                ow.toBytesChar((char)((signature >> (8 * i)) & 0xff));
+            }
+        }
 
-        ofs.close();
-        std::cout << "End Writer" << std::endl;
+        ow.flush();
+        sink.reset();
+        if(ofs.is_open()) {
+            ofs.close();
+        }
+        OASIS_TRACE(TRACE_SUMMARY, "End Writer" << std::endl);
 
     }
 
 
 
 protected:
-    TableOffsets readStartRecord(std::ifstream& ifs) {
+    TableOffsets readStartRecord(ByteSource& ifs, layout::Layout<pointT>& outLayout) {
 
         unsigned int recordID = OasisReader::fromBytesUnsigned(ifs);
-        std::cout << "Record ID " << recordID << std::endl;
+        OASIS_TRACE(TRACE_RECORD, "Record ID " << recordID << std::endl);
         if(recordID != 1) {
-            std::cout << "No Start Record ID" << std::endl;
+            OASIS_TRACE(TRACE_RECORD, "No Start Record ID" << std::endl);
             throw std::exception("Failed to find Start Record.");
         }
 
-        std::string version = OasisReader::fromBytesString(ifs);
+        std::string_view version = OasisReader::fromBytesStringView(ifs);
         if(version != VERSION) {
             throw std::exception("Incorrect Oasis version.");
         }
-        std::cout << "Version : " << version << std::endl;
+        OASIS_TRACE(TRACE_SUMMARY, "Version : " << version << std::endl);
 
-        //Not yet used for anything
-        float unit = OasisReader::fromBytesReal(ifs);
-        std::cout << "Unit : " << unit << std::endl;
+        //Coordinates stay in DBU, the unit is kept for display
+        double unit = OasisReader::fromBytesReal(ifs);
+        OASIS_TRACE(TRACE_SUMMARY, "Unit : " << unit << std::endl);
+        outLayout.setUnit(unit);
 
         unsigned int offsetFlag = OasisReader::fromBytesUnsigned(ifs);
-        std::cout << "Offset Flag : " << offsetFlag << std::endl;
+        OASIS_TRACE(TRACE_SUMMARY, "Offset Flag : " << offsetFlag << std::endl);
 
-        int curPos = ifs.tellg();
-        std::cout << "Current Pos : " << curPos << std::endl;
+        std::size_t curPos = ifs.tell();
+        OASIS_TRACE(TRACE_SUMMARY, "Current Pos : " << curPos << std::endl);
         if(offsetFlag == 1) {
-            ifs.seekg(-255, ifs.end);
+            ifs.seek(ifs.size() - 255);
         }
 
         unsigned int cellnameFlag = OasisReader::fromBytesUnsigned(ifs);
-        unsigned int cellnameOffset = OasisReader::fromBytesUnsigned(ifs);
+        std::uint64_t cellnameOffset = OasisReader::fromBytesUnsigned64(ifs);
         unsigned int textstringFlag = OasisReader::fromBytesUnsigned(ifs);
-        unsigned int textstringOffset = OasisReader::fromBytesUnsigned(ifs);
+        std::uint64_t textstringOffset = OasisReader::fromBytesUnsigned64(ifs);
         unsigned int propnameFlag = OasisReader::fromBytesUnsigned(ifs);
-        unsigned int propnameOffset = OasisReader::fromBytesUnsigned(ifs);
+        std::uint64_t propnameOffset = OasisReader::fromBytesUnsigned64(ifs);
         unsigned int propstringFlag = OasisReader::fromBytesUnsigned(ifs);
-        unsigned int propstringOffset = OasisReader::fromBytesUnsigned(ifs);
+        std::uint64_t propstringOffset = OasisReader::fromBytesUnsigned64(ifs);
         unsigned int layernameFlag = OasisReader::fromBytesUnsigned(ifs);
-        unsigned int layernameOffset = OasisReader::fromBytesUnsigned(ifs);
+        std::uint64_t layernameOffset = OasisReader::fromBytesUnsigned64(ifs);
         unsigned int xnameFlag = OasisReader::fromBytesUnsigned(ifs);
-        unsigned int xnameOffset = OasisReader::fromBytesUnsigned(ifs);
+        std::uint64_t xnameOffset = OasisReader::fromBytesUnsigned64(ifs);
 
         TableOffsets table(cellnameFlag, cellnameOffset,
                            textstringFlag, textstringOffset,
@@ -558,427 +1377,2525 @@ protected:
                            xnameFlag, xnameOffset);
 
         if(offsetFlag == 1) {
-            ifs.seekg(curPos, ifs.beg);
+            readValidation(ifs, table);
+            ifs.seek(curPos);
+        } else {
+            curPos = ifs.tell();
+            ifs.seek(ifs.size() - 255);
+            readValidation(ifs, table);
+            ifs.seek(curPos);
         }
 
         return table;
 
     }
 
+    /// the rest of the END record after its table offsets.
+    void readValidation(ByteSource& ifs, TableOffsets& table) {
 
-    void writeCellRecord(OasisWriter& ow, TableOffsets& table, const layout::Cell<pointT>* cell) {
-
-        std::cout << "Write Cell Record" << std::endl;
-        typename std::map<std::string, layout::Layer<pointT>*>::const_iterator it;
-        for(it = cell->getLayers().begin(); it != cell->getLayers().end(); ++it) {
-
-            const layout::Layer<pointT>* layer = it->second;
-            table.addLayername(layer->getName(), layer->getLayerNum(), layer->getLayerNum(), layer->getDataType(), layer->getDataType());
-
-            for(layout::iShape<pointT>* shape : layer->getShapes()) {
-
-                if(shape->getShapeType() == BOX) {
-
-                    std::cout << "Box" << std::endl;
-
-                    layout::Box<pointT>* box = (layout::Box<pointT>*) shape;
-                    unsigned char rectangle_info = 0;
-                    unsigned int height = box->getHeight();
-                    unsigned int width = box->getWidth();
-                    bool square = height == width;
-
-                    //Layer Number
-                    rectangle_info += 1;
-                    //Datatype
-                    rectangle_info += 2;
-                    //Repetition, not considered yet
-                    rectangle_info += 0;//4
-                    //Y
-                    rectangle_info += 8;
-                    //X
-                    rectangle_info += 16;
-                    //H
-                    rectangle_info += (square ? 0 : 32);
-                    //W
-                    rectangle_info += 64;
-                    //S
-                    rectangle_info += (square ? 128 : 0);
-
-                    //Record ID
-                    ow.toBytesUnsigned(20);
-                    //Rectangle Info
-                    ow.toBytesChar(rectangle_info);
-                    //Layer Number
-                    ow.toBytesUnsigned(layer->getLayerNum());
-                    //Datatype
-                    ow.toBytesUnsigned(layer->getDataType());
-                    //Width
-                    ow.toBytesUnsigned(width);
-                    //Height
-                    if(true) { // !square?? already specify H is 1.) {
-                        ow.toBytesUnsigned(height);
-                    }
-                    //X
-                    ow.toBytesSigned(box->getMinX());
-                    //Y
-                    ow.toBytesSigned(box->getMinY());
-
-                } else if(shape->getShapeType() == POLYGON) {
-
-                    std::cout << "Polygon" << std::endl;
-
-                    layout::Polygon<pointT>* polygon = (layout::Polygon<pointT>*) shape;
-                    std::vector<QVector3D> vertices;
-                    std::vector<int> count;
-                    polygon->getVertices(vertices, count);
-                    oasisio::PointList pointList(POINT_LIST_4);
-                    fillPointList(pointList, vertices);
-
-                    /*
-                    std::cout << "Write Point List" << std::endl;
-                    int i;
-                    for(i=0; i<pointList.getList().size(); ++i) {
-                        std::cout << "(" << pointList.getList().at(i).getDeltaX() << ", " <<
-                                            pointList.getList().at(i).getDeltaY() << ") ";
-                    }
-                    std::cout << std::endl;
-                    */
-
-                    unsigned char polygon_info = 0;
-
-                    //Layer Number
-                    polygon_info += 1;
-                    //Datatype
-                    polygon_info += 2;
-                    //Repetition, not considered yet
-                    polygon_info += 0;//4
-                    //Y
-                    polygon_info += 8;
-                    //X
-                    polygon_info += 16;
-                    //Point List
-                    polygon_info += 32;
-
-                    //Record ID
-                    ow.toBytesUnsigned(21);
-                    //Polygon Info
-                    ow.toBytesChar(polygon_info);
-                    //Layer Number
-                    ow.toBytesUnsigned(layer->getLayerNum());
-                    //Datatype
-                    ow.toBytesUnsigned(layer->getDataType());
-                    //Point List
-                    ow.toBytesPointList(pointList);
-                    //X
-                    ow.toBytesSigned((int)vertices.at(0).x());
-                    //Y
-                    ow.toBytesSigned((int)vertices.at(0).y());
-
-                } else if(shape->getShapeType() == CIRCLE) {
-
-                    std::cout << "Circle" << std::endl;
-
-                    layout::Circle<pointT>* circle = (layout::Circle<pointT>*) shape;
-                    unsigned int radius = circle->getRadius();
-                    int x = bg::get<0>(circle->getCenter());
-                    int y = bg::get<1>(circle->getCenter());
-
-                    unsigned char circle_info = 0;
-
-                    //Layer Number
-                    circle_info += 1;
-                    //Datatype
-                    circle_info += 2;
-                    //Repetition, not considered yet
-                    circle_info += 0;//4
-                    //Y
-                    circle_info += 8;
-                    //X
-                    circle_info += 16;
-                    //r
-                    circle_info += 32;
-
-                    /*
-                    std::cout << "Writing Circle" << std::endl;
-                    std::cout << "Circle Info " << std::bitset<8>((int)circle_info).to_string() << std::endl;
-                    std::cout << "Layer Num " << layer->getLayerNum() << std::endl;
-                    std::cout << "Data Type " << layer->getDataType() << std::endl;
-                    std::cout << "Radius " << radius << std::endl;
-                    std::cout << "X " << x << std::endl;
-                    std::cout << "Y " << y << std::endl;
-                    */
-
-                    //Record ID
-                    ow.toBytesUnsigned(27);
-                    //Circle Info
-                    ow.toBytesChar(circle_info);
-                    //Layer Number
-                    ow.toBytesUnsigned(layer->getLayerNum());
-                    //Datatype
-                    ow.toBytesUnsigned(layer->getDataType());
-                    //Radius
-                    ow.toBytesUnsigned(radius);
-                    //X
-                    ow.toBytesSigned(x);
-                    //Y
-                    ow.toBytesSigned(y);
-
-                }
-
-            }
-
-        }
-
-    }
-
-    void fillPointList(oasisio::PointList& pointList, const std::vector<QVector3D>& vertices) {
-
-        //pointList.addDelta(DELTA_G2, 0, 0);
-
+        //Padding String
+        OasisReader::skipString(ifs);
+        unsigned int scheme = OasisReader::fromBytesUnsigned(ifs);
+        OASIS_TRACE(TRACE_SUMMARY, "Validation Scheme : " << scheme << std::endl);
+        if(scheme == VALIDATION_NONE) {
+            return;
+        }
+        if(scheme != VALIDATION_CRC32 && scheme != VALIDATION_CHECKSUM32) {
+            throw std::exception("Unknown validation scheme.");
+        }
+        std::size_t length = ifs.tell();
+        //Validation Signature, least significant byte first
+        std::uint32_t signature = 0;
         int i;
-        for(i=1; i<vertices.size(); ++i) {
-            pointList.addDelta(DELTA_G2, (int) (vertices.at(i).x() - vertices.at(i-1).x()),
-                                         (int) (vertices.at(i).y() - vertices.at(i-1).y()));
+        for(i=0; i<4; ++i) {
+            signature |= (std::uint32_t)ifs.get() << (8 * i);
         }
+        table.setValidation(scheme, signature, length);
 
     }
 
-    void fillPointVector(std::vector<pointT>& points, const oasisio::PointList& pointList) {
-        int i;
-        for(i=0; i<pointList.getList().size(); ++i) {
-            pointT next;
-            bg::set<0>(next, pointList.getList().at(i).getDeltaX() + bg::get<0>(points.back()));
-            bg::set<1>(next, pointList.getList().at(i).getDeltaY() + bg::get<1>(points.back()));
-            points.emplace_back(next);
+    /// the signature of the first length bytes of ifs, read window by window.
+    static std::uint32_t signSource(ByteSource& ifs, unsigned int scheme, std::size_t length) {
+
+        ifs.seek(0);
+        std::uint32_t signature = 0;
+        std::size_t pos = 0;
+        while(pos < length) {
+            std::size_t n = std::min(ifs.ensure(1), length - pos);
+            if(n == 0) {
+                break;
+            }
+            signature = validationSignature(scheme, signature, ifs.data(), n);
+            ifs.advance(n);
+            pos += n;
         }
+        return signature;
+
     }
 
-    void readCellRecord(std::ifstream& ifs, TableOffsets& table, layout::Cell<pointT>* cell) {
 
-        while(true) {
+    /// the repetition type of the eleven that holds repetition most compactly,
+    /// type 0 if it is the modal repetition.
+    void writeRepetition(OasisWriter& ow, WrittenModal& modal, const layout::Repetition<pointT>& repetition) {
 
-            unsigned int recordID = OasisReader::fromBytesUnsigned(ifs);
-            std::cout << "Record ID " << recordID << std::endl;
-            switch(recordID) {
-            case 20:
-            {
-                unsigned char rectangle_info = OasisReader::fromBytesChar(ifs);
-                std::cout << "Rectangle Info " << std::bitset<8>((int)rectangle_info).to_string() << std::endl;
-                bool S = rectangle_info & 128;
-                bool W = rectangle_info & 64;
-                bool H = rectangle_info & 32;
-                bool X = rectangle_info & 16;
-                bool Y = rectangle_info & 8;
-                bool R = rectangle_info & 4; //Currently unused
-                bool D = rectangle_info & 2;
-                bool L = rectangle_info & 1;
-                unsigned int layernum, datatype, width, height;
-                int x, y;
-                if(L) {
-                    layernum = OasisReader::fromBytesUnsigned(ifs);
-                    std::cout << "Layer Num " << layernum << std::endl;
-                }
-                if(D) {
-                    datatype = OasisReader::fromBytesUnsigned(ifs);
-                    std::cout << "Datatype " << datatype << std::endl;
-                }
-                if(W) {
-                    width = OasisReader::fromBytesUnsigned(ifs);
-                    std::cout << "Width " << width << std::endl;
-                }
-                if(H) {
-                    height = OasisReader::fromBytesUnsigned(ifs);
-                    std::cout << "Height " << height << std::endl;
-                }
-                if(X) {
-                    x = OasisReader::fromBytesSigned(ifs);
-                    std::cout << "X " << x << std::endl;
-                }
-                if(Y) {
-                    y = OasisReader::fromBytesSigned(ifs);
-                    std::cout << "Y " << y << std::endl;
-                }
-                if(S) {
-                    height = width;
-                }
+        if(!changed(modal.repetition, repetition)) {
+            //Type 0, the previous repetition
+            ow.toBytesUnsigned(0);
+            return;
+        }
 
-                layout::Layer<pointT>* layer = cell->getLayer(layernum, datatype);
-                if(layer == nullptr) {
-                    switch(layernum) {
-                    case 2:
-                        layer = cell->newLayer(layernum, datatype, QColor("green"));
-                        break;
-                    case 3:
-                        layer = cell->newLayer(layernum, datatype, QColor("yellow"));
-                        break;
-                    case 1:
-                    default:
-                        layer = cell->newLayer(layernum, datatype, QColor("red"));
-                        break;
-                    }
-                    typename std::map<std::tuple<unsigned int, unsigned int, unsigned int, unsigned int>, std::string>::const_iterator it = table.getLayernames().begin();
-                    for(; it != table.getLayernames().end(); ++it) {
-                        if(layernum >= std::get<0>(it->first) && layernum <= std::get<1>(it->first) &&
-                            datatype >= std::get<2>(it->first) && datatype <= std::get<3>(it->first)) {
-                            layer->setName(it->second);
-                            break;
-                        }
-                    }
-                }
-                layout::Box<pointT>* box = new layout::Box<pointT>(x, y, x+width, y+height);
-                layer->addShape(box);
+        if(repetition.isLattice()) {
+            unsigned int n = repetition.getCount1();
+            unsigned int m = repetition.getCount2();
+            pointT s1 = repetition.getStep1();
+            pointT s2 = repetition.getStep2();
+            if(m > 1 && s1.x() == 0 && s1.y() > 0 && s2.y() == 0 && s2.x() > 0) {
+                std::swap(n, m);
+                std::swap(s1, s2);
+            }
+            if(m > 1 && s1.y() == 0 && s1.x() > 0 && s2.x() == 0 && s2.y() > 0) {
+                //Type 1, x-dimension, y-dimension, x-space, y-space
+                ow.toBytesUnsigned(1);
+                ow.toBytesUnsigned(n - 2);
+                ow.toBytesUnsigned(m - 2);
+                ow.toBytesUnsigned(s1.x());
+                ow.toBytesUnsigned(s2.y());
+            } else if(m > 1) {
+                //Type 8, n-dimension, m-dimension, n-displacement, m-displacement
+                ow.toBytesUnsigned(8);
+                ow.toBytesUnsigned(n - 2);
+                ow.toBytesUnsigned(m - 2);
+                ow.toBytesDelta(Delta(DELTA_G2, s1.x(), s1.y()));
+                ow.toBytesDelta(Delta(DELTA_G2, s2.x(), s2.y()));
+            } else if(s1.y() == 0 && s1.x() > 0) {
+                //Type 2, x-dimension, x-space
+                ow.toBytesUnsigned(2);
+                ow.toBytesUnsigned(n - 2);
+                ow.toBytesUnsigned(s1.x());
+            } else if(s1.x() == 0 && s1.y() > 0) {
+                //Type 3, y-dimension, y-space
+                ow.toBytesUnsigned(3);
+                ow.toBytesUnsigned(n - 2);
+                ow.toBytesUnsigned(s1.y());
+            } else {
+                //Type 9, dimension, displacement
+                ow.toBytesUnsigned(9);
+                ow.toBytesUnsigned(n - 2);
+                ow.toBytesDelta(Delta(DELTA_G2, s1.x(), s1.y()));
+            }
+            return;
+        }
 
-                break;
+        // irregular: the steps between copies, on a common grid.
+        const std::vector<pointT>& offsets = repetition.getOffsets();
+        std::vector<pointT> steps;
+        steps.reserve(offsets.size() - 1);
+        bool row = true;
+        bool column = true;
+        coord_type grid = 0;
+        std::size_t i;
+        for(i=1; i<offsets.size(); ++i) {
+            pointT d(offsets[i].x() - offsets[i-1].x(), offsets[i].y() - offsets[i-1].y());
+            row = row && d.y() == 0 && d.x() >= 0;
+            column = column && d.x() == 0 && d.y() >= 0;
+            grid = std::gcd(grid, std::gcd(d.x(), d.y()));
+            steps.push_back(d);
+        }
+        if(grid == 0) {
+            grid = 1;
+        }
+        unsigned int type = row ? 4 : (column ? 6 : 10);
+        if(grid > 1) {
+            //Types 5, 7 and 11 add a grid
+            ++type;
+        }
+        ow.toBytesUnsigned(type);
+        ow.toBytesUnsigned((unsigned int)offsets.size() - 2);
+        if(grid > 1) {
+            ow.toBytesUnsigned(grid);
+        }
+        for(const pointT& d : steps) {
+            if(row) {
+                ow.toBytesUnsigned(d.x() / grid);
+            } else if(column) {
+                ow.toBytesUnsigned(d.y() / grid);
+            } else {
+                ow.toBytesDelta(Delta(DELTA_G2, d.x() / grid, d.y() / grid));
             }
-            case 21:
-            {
-                unsigned char polygon_info = OasisReader::fromBytesChar(ifs);
-                std::cout << "Polygon Info " << std::bitset<8>((int)polygon_info).to_string() << std::endl;
-                bool P = polygon_info & 32;
-                bool X = polygon_info & 16;
-                bool Y = polygon_info & 8;
-                bool R = polygon_info & 4; //Currently unused
-                bool D = polygon_info & 2;
-                bool L = polygon_info & 1;
+        }
+    }
 
-                unsigned int layernum, datatype;
-                int x, y;
-                oasisio::PointList pointList(POINT_LIST_4);
-                if(L) {
-                    layernum = OasisReader::fromBytesUnsigned(ifs);
-                    std::cout << "Layer Num " << layernum << std::endl;
-                }
-                if(D) {
-                    datatype = OasisReader::fromBytesUnsigned(ifs);
-                    std::cout << "Datatype " << datatype << std::endl;
-                }
-                if(P) {
-                    OasisReader::fromBytesPointList(ifs, pointList);
-                    std::cout << "Read Point List" << std::endl;
-                    int i;
-                    for(i=0; i<pointList.getList().size(); ++i) {
-                        std::cout << "(" << pointList.getList().at(i).getDeltaX() << ", " <<
-                            pointList.getList().at(i).getDeltaY() << ") ";
-                    }
-                    std::cout << std::endl;
-                }
-                if(X) {
-                    x = OasisReader::fromBytesSigned(ifs);
-                    std::cout << "X " << x << std::endl;
-                }
-                if(Y) {
-                    y = OasisReader::fromBytesSigned(ifs);
-                    std::cout << "Y " << y << std::endl;
-                }
+    void writeRectangle(OasisWriter& ow, WrittenModal& modal, const layout::Layer<pointT>* layer,
+                        coord_type x, coord_type y, unsigned int width, unsigned int height,
+                        const layout::Repetition<pointT>* repetition = nullptr) {
+
+        bool L = changed(modal.layer, layer->getLayerNum());
+        bool D = changed(modal.datatype, layer->getDataType());
+        bool square = height == width;
+        bool W = changed(modal.width, width);
+        // S sets the modal height as well.
+        bool H = square ? (modal.height = height, false) : changed(modal.height, height);
+        coord_type dx = x - modal.x;
+        coord_type dy = y - modal.y;
+        modal.x = x;
+        modal.y = y;
+
+        unsigned char rectangle_info = 0;
+
+        //Layer Number
+        rectangle_info += (L ? 1 : 0);
+        //Datatype
+        rectangle_info += (D ? 2 : 0);
+        //Repetition
+        rectangle_info += (repetition ? 4 : 0);
+        //Y
+        rectangle_info += (dy != 0 ? 8 : 0);
+        //X
+        rectangle_info += (dx != 0 ? 16 : 0);
+        //H
+        rectangle_info += (H ? 32 : 0);
+        //W
+        rectangle_info += (W ? 64 : 0);
+        //S
+        rectangle_info += (square ? 128 : 0);
 
-                layout::Layer<pointT>* layer = cell->getLayer(layernum, datatype);
-                if(layer == nullptr) {
-                    switch(layernum) {
-                    case 2:
-                        layer = cell->newLayer(layernum, datatype, QColor("green"));
-                        break;
-                    case 3:
-                        layer = cell->newLayer(layernum, datatype, QColor("yellow"));
-                        break;
-                    case 1:
-                    default:
-                        layer = cell->newLayer(layernum, datatype, QColor("red"));
-                        break;
-                    }
-                    typename std::map<std::tuple<unsigned int, unsigned int, unsigned int, unsigned int>, std::string>::const_iterator it = table.getLayernames().begin();
-                    for(; it != table.getLayernames().end(); ++it) {
-                        if(layernum >= std::get<0>(it->first) && layernum <= std::get<1>(it->first) &&
-                            datatype >= std::get<2>(it->first) && datatype <= std::get<3>(it->first)) {
-                            layer->setName(it->second);
-                            break;
-                        }
-                    }
-                }
+        //Record ID
+        ow.toBytesUnsigned(20);
+        //Rectangle Info
+        ow.toBytesChar(rectangle_info);
+        if(L) {
+            ow.toBytesUnsigned(layer->getLayerNum());
+        }
+        if(D) {
+            ow.toBytesUnsigned(layer->getDataType());
+        }
+        if(W) {
+            ow.toBytesUnsigned(width);
+        }
+        //Height, implied by the S bit for squares
+        if(H) {
+            ow.toBytesUnsigned(height);
+        }
+        if(dx != 0) {
+            ow.toBytesSigned(dx);
+        }
+        if(dy != 0) {
+            ow.toBytesSigned(dy);
+        }
+        if(repetition) {
+            writeRepetition(ow, modal, *repetition);
+        }
+    }
 
-                std::vector<pointT> points;
-                pointT first;
-                bg::set<0>(first, x);
-                bg::set<1>(first, y);
-                points.emplace_back(first);
-                fillPointVector(points, pointList);
+    /// whole numbers as integers, anything else as a double.
+    void writeReal(OasisWriter& ow, double v) {
+        if(v == std::floor(v) && std::fabs(v) < 18446744073709551616.0) {
+            ow.toBytesReal(v < 0 ? NEGATIVE_WHOLE : POSITIVE_WHOLE, std::fabs(v));
+        } else {
+            ow.toBytesReal(DOUBLE_PRECISION_FLOAT, v);
+        }
+    }
 
-                layout::Polygon<pointT>* polygon = new layout::Polygon<pointT>(points);
-                layer->addShape(polygon);
+    /// PLACEMENT (17) for quarter turns, PLACEMENT (18) with magnification
+    /// and angle otherwise.
+    void writePlacement(OasisWriter& ow, WrittenModal& modal, unsigned int ref, const layout::Placement<pointT>& p) {
+
+        bool C = changed(modal.placementCell, ref);
+        coord_type dx = bg::get<0>(p.getOffset()) - modal.placementX;
+        coord_type dy = bg::get<1>(p.getOffset()) - modal.placementY;
+        modal.placementX = bg::get<0>(p.getOffset());
+        modal.placementY = bg::get<1>(p.getOffset());
+
+        unsigned char placement_info = 0;
+
+        //C, cell reference follows
+        placement_info += (C ? 128 : 0);
+        //N, as a reference number
+        placement_info += (C ? 64 : 0);
+        //X
+        placement_info += (dx != 0 ? 32 : 0);
+        //Y
+        placement_info += (dy != 0 ? 16 : 0);
+        //Repetition
+        placement_info += (p.getRepetition().size() > 1 ? 8 : 0);
+        //F
+        placement_info += (p.isMirrored() ? 1 : 0);
+
+        bool orthogonal = p.isOrthogonal();
+        if(orthogonal) {
+            //AA, counter-clockwise quarter turns
+            int quarter = (((int)(p.getAngle() / 90.0)) % 4 + 4) % 4;
+            placement_info += quarter << 1;
+        } else {
+            //M
+            placement_info += (p.getMagnification() != 1.0 ? 4 : 0);
+            //A
+            placement_info += (p.getAngle() != 0.0 ? 2 : 0);
+        }
 
-                break;
+        //Record ID
+        ow.toBytesUnsigned(orthogonal ? 17 : 18);
+        //Placement Info
+        ow.toBytesChar(placement_info);
+        if(C) {
+            ow.toBytesUnsigned(ref);
+        }
+        if(!orthogonal) {
+            if(placement_info & 4) {
+                writeReal(ow, p.getMagnification());
             }
-            case 27:
-            {
-                unsigned char circle_info = OasisReader::fromBytesChar(ifs);
-                std::cout << "Circle Info " << std::bitset<8>((int)circle_info).to_string() << std::endl;
-                bool r = circle_info & 32;
-                bool X = circle_info & 16;
-                bool Y = circle_info & 8;
-                bool R = circle_info & 4; //Currently unused
-                bool D = circle_info & 2;
-                bool L = circle_info & 1;
-
-                unsigned int radius, layernum, datatype;
-                int x, y;
-
+            if(placement_info & 2) {
+                writeReal(ow, p.getAngle());
+            }
+        }
+        if(dx != 0) {
+            ow.toBytesSigned(dx);
+        }
+        if(dy != 0) {
+            ow.toBytesSigned(dy);
+        }
+        if(placement_info & 8) {
+            writeRepetition(ow, modal, p.getRepetition());
+        }
+    }
+
+    template<typename ringT>
+    void writePolygon(OasisWriter& ow, WrittenModal& modal, const layout::Layer<pointT>* layer, const ringT& vertices,
+                      coord_type x, coord_type y, const layout::Repetition<pointT>* repetition = nullptr) {
+
+        oasisio::PointList pointList(POINT_LIST_4);
+        fillPointList(pointList, vertices);
+
+        bool L = changed(modal.layer, layer->getLayerNum());
+        bool D = changed(modal.datatype, layer->getDataType());
+        bool P = changed(modal.polygon, pointList);
+        coord_type dx = x - modal.x;
+        coord_type dy = y - modal.y;
+        modal.x = x;
+        modal.y = y;
+
+        unsigned char polygon_info = 0;
+
+        //Layer Number
+        polygon_info += (L ? 1 : 0);
+        //Datatype
+        polygon_info += (D ? 2 : 0);
+        //Repetition
+        polygon_info += (repetition ? 4 : 0);
+        //Y
+        polygon_info += (dy != 0 ? 8 : 0);
+        //X
+        polygon_info += (dx != 0 ? 16 : 0);
+        //Point List
+        polygon_info += (P ? 32 : 0);
+
+        //Record ID
+        ow.toBytesUnsigned(21);
+        //Polygon Info
+        ow.toBytesChar(polygon_info);
+        if(L) {
+            ow.toBytesUnsigned(layer->getLayerNum());
+        }
+        if(D) {
+            ow.toBytesUnsigned(layer->getDataType());
+        }
+        if(P) {
+            ow.toBytesPointList(pointList);
+        }
+        if(dx != 0) {
+            ow.toBytesSigned(dx);
+        }
+        if(dy != 0) {
+            ow.toBytesSigned(dy);
+        }
+        if(repetition) {
+            writeRepetition(ow, modal, *repetition);
+        }
+    }
+
+    /// extension scheme of one path end: 0 for the modal value, 1 for none,
+    /// 2 for half the width, 3 when the value follows.
+    static unsigned int extensionScheme(std::optional<coord_type>& modal, coord_type extension, coord_type halfWidth) {
+        if(!changed(modal, extension)) {
+            return 0;
+        }
+        return extension == 0 ? 1 : (extension == halfWidth ? 2 : 3);
+    }
+
+    void writePath(OasisWriter& ow, WrittenModal& modal, const layout::Layer<pointT>* layer, const layout::Path<pointT>& path,
+                   coord_type x, coord_type y, const layout::Repetition<pointT>* repetition = nullptr) {
+
+        // the point list is open: no closing edge or implied vertex.
+        oasisio::PointList pointList(POINT_LIST_4);
+        fillPointList(pointList, path.getPoints(), false);
+
+        coord_type halfWidth = path.getHalfWidth();
+        bool L = changed(modal.layer, layer->getLayerNum());
+        bool D = changed(modal.datatype, layer->getDataType());
+        bool W = changed(modal.halfWidth, halfWidth);
+        unsigned int start = extensionScheme(modal.startExtension, path.getStartExtension(), halfWidth);
+        unsigned int end = extensionScheme(modal.endExtension, path.getEndExtension(), halfWidth);
+        bool E = start != 0 || end != 0;
+        bool P = changed(modal.path, pointList);
+        coord_type dx = x - modal.x;
+        coord_type dy = y - modal.y;
+        modal.x = x;
+        modal.y = y;
+
+        unsigned char path_info = 0;
+
+        //Layer Number
+        path_info += (L ? 1 : 0);
+        //Datatype
+        path_info += (D ? 2 : 0);
+        //Repetition
+        path_info += (repetition ? 4 : 0);
+        //Y
+        path_info += (dy != 0 ? 8 : 0);
+        //X
+        path_info += (dx != 0 ? 16 : 0);
+        //Point List
+        path_info += (P ? 32 : 0);
+        //Half Width
+        path_info += (W ? 64 : 0);
+        //Extension Scheme
+        path_info += (E ? 128 : 0);
+
+        //Record ID
+        ow.toBytesUnsigned(22);
+        //Path Info
+        ow.toBytesChar(path_info);
+        if(L) {
+            ow.toBytesUnsigned(layer->getLayerNum());
+        }
+        if(D) {
+            ow.toBytesUnsigned(layer->getDataType());
+        }
+        if(W) {
+            ow.toBytesUnsigned(halfWidth);
+        }
+        if(E) {
+            //0000SSEE
+            ow.toBytesUnsigned((start << 2) | end);
+            if(start == 3) {
+                ow.toBytesSigned(path.getStartExtension());
+            }
+            if(end == 3) {
+                ow.toBytesSigned(path.getEndExtension());
+            }
+        }
+        if(P) {
+            ow.toBytesPointList(pointList);
+        }
+        if(dx != 0) {
+            ow.toBytesSigned(dx);
+        }
+        if(dy != 0) {
+            ow.toBytesSigned(dy);
+        }
+        if(repetition) {
+            writeRepetition(ow, modal, *repetition);
+        }
+    }
+
+    void writeCircle(OasisWriter& ow, WrittenModal& modal, const layout::Layer<pointT>* layer, unsigned int radius,
+                     coord_type x, coord_type y, const layout::Repetition<pointT>* repetition = nullptr) {
+
+        bool L = changed(modal.layer, layer->getLayerNum());
+        bool D = changed(modal.datatype, layer->getDataType());
+        bool r = changed(modal.radius, radius);
+        coord_type dx = x - modal.x;
+        coord_type dy = y - modal.y;
+        modal.x = x;
+        modal.y = y;
+
+        unsigned char circle_info = 0;
+
+        //Layer Number
+        circle_info += (L ? 1 : 0);
+        //Datatype
+        circle_info += (D ? 2 : 0);
+        //Repetition
+        circle_info += (repetition ? 4 : 0);
+        //Y
+        circle_info += (dy != 0 ? 8 : 0);
+        //X
+        circle_info += (dx != 0 ? 16 : 0);
+        //r
+        circle_info += (r ? 32 : 0);
+
+        //Record ID
+        ow.toBytesUnsigned(27);
+        //Circle Info
+        ow.toBytesChar(circle_info);
+        if(L) {
+            ow.toBytesUnsigned(layer->getLayerNum());
+        }
+        if(D) {
+            ow.toBytesUnsigned(layer->getDataType());
+        }
+        if(r) {
+            ow.toBytesUnsigned(radius);
+        }
+        if(dx != 0) {
+            ow.toBytesSigned(dx);
+        }
+        if(dy != 0) {
+            ow.toBytesSigned(dy);
+        }
+        if(repetition) {
+            writeRepetition(ow, modal, *repetition);
+        }
+    }
+
+    /// the CTRAPEZOID type of a trapezoid, -1 if there is none. the
+    /// triangles are tried first: they leave the width or height out.
+    static int findCTrapezoid(bool vertical, unsigned int width, unsigned int height,
+                              coord_type a, coord_type b) {
+        coord_type side = vertical ? width : height;
+        unsigned int i;
+        for(i=0; i<24; ++i) {
+            unsigned int type = (i + 16) % 24;
+            const CTrapezoid& t = ctrapezoidDeltas(type);
+            if(t.vertical != vertical || a != t.a * side || b != t.b * side) {
+                continue;
+            }
+            unsigned int w = width, h = height;
+            ctrapezoidSize(type, w, h);
+            if(w == width && h == height) {
+                return (int)type;
+            }
+        }
+        return -1;
+    }
+
+    /// CTRAPEZOID (26) for the shapes it has a type for, TRAPEZOID (24 or 25)
+    /// when one delta is 0, TRAPEZOID (23) otherwise. see layout::Trapezoid
+    /// for the deltas.
+    void writeTrapezoid(OasisWriter& ow, WrittenModal& modal, const layout::Layer<pointT>* layer, bool vertical,
+                        coord_type x, coord_type y, unsigned int width, unsigned int height, coord_type a, coord_type b,
+                        const layout::Repetition<pointT>* repetition = nullptr) {
+
+        if(a == 0 && b == 0) {
+            writeRectangle(ow, modal, layer, x, y, width, height, repetition);
+            return;
+        }
+
+        int type = findCTrapezoid(vertical, width, height, a, b);
+        bool L = changed(modal.layer, layer->getLayerNum());
+        bool D = changed(modal.datatype, layer->getDataType());
+        bool T = type >= 0 && changed(modal.ctrapezoidType, type);
+        // an implied width or height still sets the modal variable.
+        bool W = (type >= 0 && ctrapezoidImpliesWidth(type)) ? (modal.width = width, false) : changed(modal.width, width);
+        bool H = (type >= 0 && ctrapezoidImpliesHeight(type)) ? (modal.height = height, false) : changed(modal.height, height);
+        coord_type dx = x - modal.x;
+        coord_type dy = y - modal.y;
+        modal.x = x;
+        modal.y = y;
+
+        unsigned int recordID = type >= 0 ? 26 : (b == 0 ? 24 : (a == 0 ? 25 : 23));
+        unsigned char trapezoid_info = 0;
+
+        //Layer Number
+        trapezoid_info += (L ? 1 : 0);
+        //Datatype
+        trapezoid_info += (D ? 2 : 0);
+        //Repetition
+        trapezoid_info += (repetition ? 4 : 0);
+        //Y
+        trapezoid_info += (dy != 0 ? 8 : 0);
+        //X
+        trapezoid_info += (dx != 0 ? 16 : 0);
+        //H
+        trapezoid_info += (H ? 32 : 0);
+        //W
+        trapezoid_info += (W ? 64 : 0);
+        //T for CTRAPEZOID, O (vertical) for TRAPEZOID
+        trapezoid_info += ((type >= 0 ? T : vertical) ? 128 : 0);
+
+        //Record ID
+        ow.toBytesUnsigned(recordID);
+        //Trapezoid Info
+        ow.toBytesChar(trapezoid_info);
+        if(L) {
+            ow.toBytesUnsigned(layer->getLayerNum());
+        }
+        if(D) {
+            ow.toBytesUnsigned(layer->getDataType());
+        }
+        if(T) {
+            ow.toBytesUnsigned(type);
+        }
+        if(W) {
+            ow.toBytesUnsigned(width);
+        }
+        if(H) {
+            ow.toBytesUnsigned(height);
+        }
+        if(recordID == 23 || recordID == 24) {
+            ow.toBytesSigned(a);
+        }
+        if(recordID == 23 || recordID == 25) {
+            ow.toBytesSigned(b);
+        }
+        if(dx != 0) {
+            ow.toBytesSigned(dx);
+        }
+        if(dy != 0) {
+            ow.toBytesSigned(dy);
+        }
+        if(repetition) {
+            writeRepetition(ow, modal, *repetition);
+        }
+    }
+
+    /// one shape of a layer, as it is stored.
+    /// false if nothing was written, for an empty path.
+    bool writeShape(OasisWriter& ow, WrittenModal& modal, const layout::Layer<pointT>* layer, layout::iShape<pointT>* shape) {
+
+        // an array is written as its first copy and a repetition.
+        const layout::Repetition<pointT>* repetition = nullptr;
+        if(shape->getShapeType() == REPEATED) {
+            layout::RepeatedShape<pointT>* repeated = (layout::RepeatedShape<pointT>*) shape;
+            if(repeated->getRepetition().size() > 1) {
+                repetition = &repeated->getRepetition();
+            }
+            shape = repeated->getShape();
+        }
+
+        switch(shape->getShapeType()) {
+        case BOX:
+        {
+            OASIS_TRACE(TRACE_RECORD, "Box" << std::endl);
+            OASIS_COUNT(ShapesWritten, 1);
+            const layout::Box<pointT>* box = (const layout::Box<pointT>*) shape;
+            writeRectangle(ow, modal, layer, box->getMinX(), box->getMinY(), box->getWidth(), box->getHeight(), repetition);
+            break;
+        }
+        case POLYGON:
+        {
+            OASIS_TRACE(TRACE_RECORD, "Polygon" << std::endl);
+            OASIS_COUNT(ShapesWritten, 1);
+            const auto& vertices = ((const layout::Polygon<pointT>*) shape)->outer();
+            writePolygon(ow, modal, layer, vertices, bg::get<0>(vertices.front()), bg::get<1>(vertices.front()), repetition);
+            break;
+        }
+        case CIRCLE:
+        {
+            OASIS_TRACE(TRACE_RECORD, "Circle" << std::endl);
+            OASIS_COUNT(ShapesWritten, 1);
+            const layout::Circle<pointT>* circle = (const layout::Circle<pointT>*) shape;
+            writeCircle(ow, modal, layer, circle->getRadius(),
+                        bg::get<0>(circle->getCenter()), bg::get<1>(circle->getCenter()), repetition);
+            break;
+        }
+        case PATH:
+        {
+            OASIS_TRACE(TRACE_RECORD, "Path" << std::endl);
+            OASIS_COUNT(ShapesWritten, 1);
+            const layout::Path<pointT>* path = (const layout::Path<pointT>*) shape;
+            // a PATH record needs a first point.
+            if(path->getPoints().empty()) {
+                return false;
+            }
+            const pointT& first = path->getPoints().front();
+            writePath(ow, modal, layer, *path, bg::get<0>(first), bg::get<1>(first), repetition);
+            break;
+        }
+        case TRAPEZOID:
+        {
+            OASIS_TRACE(TRACE_RECORD, "Trapezoid" << std::endl);
+            OASIS_COUNT(ShapesWritten, 1);
+            const layout::Trapezoid<pointT>* trapezoid = (const layout::Trapezoid<pointT>*) shape;
+            const layout::Box<pointT>& box = trapezoid->getBBox();
+            writeTrapezoid(ow, modal, layer, trapezoid->isVertical(), box.getMinX(), box.getMinY(),
+                           box.getWidth(), box.getHeight(), trapezoid->getDeltaA(), trapezoid->getDeltaB(), repetition);
+            break;
+        }
+        }
+        return true;
+    }
+
+    /// shapes of one geometry, each at its own position. for a polygon or a
+    /// path the position is the first vertex, for a circle the center, for
+    /// boxes and trapezoids the bottom left of the box.
+    struct ShapeGroup {
+        const layout::Polygon<pointT>* polygon = nullptr;
+        const layout::Path<pointT>* path = nullptr;
+        std::vector<pointT> positions;
+    };
+    typedef std::map<std::vector<coord_type>, ShapeGroup> tShapeGroups;
+
+    /// one record of a group's geometry at x, y.
+    void writeGrouped(OasisWriter& ow, WrittenModal& modal, const layout::Layer<pointT>* layer,
+                      const std::vector<coord_type>& key, const ShapeGroup& group,
+                      coord_type x, coord_type y, const layout::Repetition<pointT>* repetition) {
+        if(key[0] == BOX) {
+            writeRectangle(ow, modal, layer, x, y, (unsigned int)key[1], (unsigned int)key[2], repetition);
+        } else if(key[0] == CIRCLE) {
+            writeCircle(ow, modal, layer, (unsigned int)key[1], x, y, repetition);
+        } else if(key[0] == TRAPEZOID) {
+            writeTrapezoid(ow, modal, layer, key[5] != 0, x, y, (unsigned int)key[1], (unsigned int)key[2],
+                           key[3], key[4], repetition);
+        } else if(key[0] == PATH) {
+            writePath(ow, modal, layer, *group.path, x, y, repetition);
+        } else {
+            writePolygon(ow, modal, layer, group.polygon->outer(), x, y, repetition);
+        }
+    }
+
+    /// write a layer's plain shapes grouped by geometry, each group as few
+    /// repetitions as RepetitionFinder finds. shapes already repeated, and
+    /// all shapes left once the time limit is spent, are written as they are.
+    void writeLayerRepetitions(OasisWriter& ow, WrittenModal& modal, TableOffsets& table, const layout::Layer<pointT>* layer) {
+
+        typedef std::chrono::steady_clock clock;
+        clock::time_point start = clock::now();
+        bool inTime = true;
+        auto spend = [&]() {
+            clock::time_point now = clock::now();
+            report.milliseconds += std::chrono::duration<double, std::milli>(now - start).count();
+            start = now;
+            inTime = repetitionTimeLimit == 0 || report.milliseconds < repetitionTimeLimit;
+        };
+
+        // one key reused for all shapes; the map only copies new ones.
+        tShapeGroups groups;
+        std::vector<coord_type> key;
+        const layout::Rects<pointT>& rects = layer->getRects();
+        for(std::size_t i = 0; i < rects.size(); ++i) {
+            key.assign({BOX, rects.getMaxX(i) - rects.getMinX(i), rects.getMaxY(i) - rects.getMinY(i)});
+            groups[key].positions.push_back(pointT(rects.getMinX(i), rects.getMinY(i)));
+        }
+        for(layout::iShape<pointT>* shape : layer->getShapes()) {
+            const layout::Properties* properties = layer->getProperties(shape);
+            if(properties) {
+                // in a repetition, the properties would go to every copy.
+                if(writeShape(ow, modal, layer, shape)) {
+                    writeProperties(ow, modal, table, *properties);
+                }
+            } else if(shape->getShapeType() == BOX) {
+                layout::Box<pointT>* box = (layout::Box<pointT>*) shape;
+                key.assign({BOX, box->getWidth(), box->getHeight()});
+                groups[key].positions.push_back(pointT(box->getMinX(), box->getMinY()));
+            } else if(shape->getShapeType() == CIRCLE) {
+                layout::Circle<pointT>* circle = (layout::Circle<pointT>*) shape;
+                key.assign({CIRCLE, (coord_type)circle->getRadius()});
+                groups[key].positions.push_back(circle->getCenter());
+            } else if(shape->getShapeType() == TRAPEZOID) {
+                layout::Trapezoid<pointT>* trapezoid = (layout::Trapezoid<pointT>*) shape;
+                const layout::Box<pointT>& box = trapezoid->getBBox();
+                key.assign({TRAPEZOID, box.getWidth(), box.getHeight(), trapezoid->getDeltaA(), trapezoid->getDeltaB(),
+                            (coord_type)trapezoid->isVertical()});
+                groups[key].positions.push_back(pointT(box.getMinX(), box.getMinY()));
+            } else if(shape->getShapeType() == POLYGON) {
+                layout::Polygon<pointT>* polygon = (layout::Polygon<pointT>*) shape;
+                const auto& vertices = polygon->outer();
+                key.assign(1, POLYGON);
+                std::size_t i;
+                for(i=1; i<vertices.size(); ++i) {
+                    key.push_back(bg::get<0>(vertices[i]) - bg::get<0>(vertices[i-1]));
+                    key.push_back(bg::get<1>(vertices[i]) - bg::get<1>(vertices[i-1]));
+                }
+                ShapeGroup& group = groups[key];
+                group.polygon = polygon;
+                group.positions.push_back(pointT(bg::get<0>(vertices.front()), bg::get<1>(vertices.front())));
+            } else if(shape->getShapeType() == PATH && !((layout::Path<pointT>*) shape)->getPoints().empty()) {
+                layout::Path<pointT>* path = (layout::Path<pointT>*) shape;
+                const std::vector<pointT>& points = path->getPoints();
+                key.assign({PATH, path->getHalfWidth(), path->getStartExtension(), path->getEndExtension()});
+                std::size_t i;
+                for(i=1; i<points.size(); ++i) {
+                    key.push_back(points[i].x() - points[i-1].x());
+                    key.push_back(points[i].y() - points[i-1].y());
+                }
+                ShapeGroup& group = groups[key];
+                group.path = path;
+                group.positions.push_back(points.front());
+            } else {
+                writeShape(ow, modal, layer, shape);
+            }
+        }
+        spend();
+
+        // the one-by-one size is measured with modal variables of its own.
+        VectorByteSink scratch(256);
+        OasisWriter scratchWriter(scratch);
+        WrittenModal scratchModal = modal;
+        std::vector<typename RepetitionFinder<pointT>::Group> found;
+        typename tShapeGroups::iterator it;
+        for(it = groups.begin(); it != groups.end(); ++it) {
+
+            ShapeGroup& group = it->second;
+            OASIS_COUNT(ShapesWritten, group.positions.size());
+            if(!inTime) {
+                for(const pointT& p : group.positions) {
+                    writeGrouped(ow, modal, layer, it->first, group, p.x(), p.y(), nullptr);
+                }
+                continue;
+            }
+
+            found.clear();
+            RepetitionFinder<pointT>::find(group.positions, found);
+            spend();
+
+            // the size of the same shapes written one by one.
+            for(const pointT& p : group.positions) {
+                scratch.clear();
+                writeGrouped(scratchWriter, scratchModal, layer, it->first, group, p.x(), p.y(), nullptr);
+                report.plainBytes += scratch.size();
+            }
+
+            std::uint64_t pos = ow.getPos();
+            for(const typename RepetitionFinder<pointT>::Group& g : found) {
+                writeGrouped(ow, modal, layer, it->first, group, g.origin.x(), g.origin.y(),
+                             g.repetition.size() > 1 ? &g.repetition : nullptr);
+            }
+            report.bytes += ow.getPos() - pos;
+            report.shapes += group.positions.size();
+            report.records += found.size();
+        }
+    }
+
+    /// a PROPERTY record, the name by PROPNAME reference. the name is left
+    /// out when it is the modal one; the values are always written.
+    void writeProperty(OasisWriter& ow, WrittenModal& modal, TableOffsets& table, const layout::Property& property) {
+
+        unsigned int ref = table.propnameReference(property.name);
+        bool C = changed(modal.propname, ref);
+        std::size_t count = property.values.size();
+
+        unsigned char property_info = 0;
+
+        //Standard
+        property_info += (property.standard ? 1 : 0);
+        //Name, by reference
+        property_info += (C ? 2 + 4 : 0);
+        //Value count, 15 when it follows
+        property_info += (unsigned char)(std::min<std::size_t>(count, 15) << 4);
+
+        //Record ID
+        ow.toBytesUnsigned(28);
+        //Property Info
+        ow.toBytesChar(property_info);
+        if(C) {
+            ow.toBytesUnsigned(ref);
+        }
+        if(count >= 15) {
+            ow.toBytesUnsigned((unsigned int)count);
+        }
+        for(const layout::PropertyValue& value : property.values) {
+            writePropertyValue(ow, value);
+        }
+    }
+
+    void writeProperties(OasisWriter& ow, WrittenModal& modal, TableOffsets& table, const layout::Properties& properties) {
+        for(const layout::Property& property : properties) {
+            writeProperty(ow, modal, table, property);
+        }
+    }
+
+    /// strings are written as b-strings, reals as whole numbers when they are.
+    void writePropertyValue(OasisWriter& ow, const layout::PropertyValue& value) {
+
+        switch(value.index()) {
+        case 0:
+            ow.toBytesUnsigned(8);
+            ow.toBytesUnsigned(std::get<unsigned int>(value));
+            break;
+        case 1:
+            ow.toBytesUnsigned(9);
+            ow.toBytesSigned(std::get<int>(value));
+            break;
+        case 2:
+            ow.toBytesUnsigned(8);
+            ow.toBytesUnsigned64(std::get<std::uint64_t>(value));
+            break;
+        case 3:
+            ow.toBytesUnsigned(9);
+            ow.toBytesSigned64(std::get<std::int64_t>(value));
+            break;
+        case 4:
+        {
+            // the real's type is the value type.
+            double d = std::get<double>(value);
+            double magnitude = std::fabs(d);
+            if(magnitude < 18446744073709551616.0 && magnitude == std::floor(magnitude)) {
+                ow.toBytesReal(d < 0 ? NEGATIVE_WHOLE : POSITIVE_WHOLE, magnitude);
+            } else {
+                ow.toBytesReal(DOUBLE_PRECISION_FLOAT, d);
+            }
+            break;
+        }
+        default:
+            ow.toBytesUnsigned(11);
+            ow.toBytesString(std::get<std::string>(value));
+            break;
+        }
+    }
+
+    /// S_CELL_OFFSET and S_BOUNDING_BOX after a cell's CELLNAME record, so a
+    /// reader can find the cell and cull it without reading its records.
+    void writeCellnameProperties(OasisWriter& ow, WrittenModal& modal, TableOffsets& table, unsigned int ref,
+                                 const layout::Cell<pointT>* cell) {
+
+        std::map<unsigned int, std::uint64_t>::const_iterator it = table.getCellOffsets().find(ref);
+        if(it != table.getCellOffsets().end()) {
+            layout::Property offset;
+            offset.name = "S_CELL_OFFSET";
+            offset.standard = true;
+            offset.values.push_back(layout::PropertyValue(it->second));
+            writeProperty(ow, modal, table, offset);
+        }
+
+        if(cell) {
+            const layout::Box<pointT>& box = cell->getBBox();
+            layout::Property bbox;
+            bbox.name = "S_BOUNDING_BOX";
+            bbox.standard = true;
+            if(box.isValid()) {
+                bbox.values.push_back(layout::PropertyValue(0u));
+                // 64-bit layouts may go past 32 bits either way.
+                bbox.values.push_back(layout::PropertyValue((std::int64_t)box.getMinX()));
+                bbox.values.push_back(layout::PropertyValue((std::int64_t)box.getMinY()));
+                bbox.values.push_back(layout::PropertyValue((std::uint64_t)box.getWidth()));
+                bbox.values.push_back(layout::PropertyValue((std::uint64_t)box.getHeight()));
+            } else {
+                // flag bit 1: the cell is empty.
+                bbox.values.push_back(layout::PropertyValue(2u));
+                bbox.values.push_back(layout::PropertyValue(0));
+                bbox.values.push_back(layout::PropertyValue(0));
+                bbox.values.push_back(layout::PropertyValue(0u));
+                bbox.values.push_back(layout::PropertyValue(0u));
+            }
+            writeProperty(ow, modal, table, bbox);
+        }
+    }
+
+    /// a TEXT record. the string goes by its number in the layout's text
+    /// pool, which is also its reference in the TEXTSTRING table.
+    void writeText(OasisWriter& ow, WrittenModal& modal, const layout::Layer<pointT>* layer,
+                   const layout::Text<pointT>& text) {
+
+        bool C = changed(modal.textString, text.string);
+        bool L = changed(modal.textlayer, layer->getLayerNum());
+        bool T = changed(modal.texttype, layer->getDataType());
+        coord_type dx = text.x - modal.textX;
+        coord_type dy = text.y - modal.textY;
+        modal.textX = text.x;
+        modal.textY = text.y;
+
+        unsigned char text_info = 0;
+
+        //Textlayer
+        text_info += (L ? 1 : 0);
+        //Texttype
+        text_info += (T ? 2 : 0);
+        //Y
+        text_info += (dy != 0 ? 8 : 0);
+        //X
+        text_info += (dx != 0 ? 16 : 0);
+        //Text String, by reference
+        text_info += (C ? 64 + 32 : 0);
+
+        //Record ID
+        ow.toBytesUnsigned(19);
+        //Text Info
+        ow.toBytesChar(text_info);
+        if(C) {
+            ow.toBytesUnsigned(text.string);
+        }
+        if(L) {
+            ow.toBytesUnsigned(layer->getLayerNum());
+        }
+        if(T) {
+            ow.toBytesUnsigned(layer->getDataType());
+        }
+        if(dx != 0) {
+            ow.toBytesSigned(dx);
+        }
+        if(dy != 0) {
+            ow.toBytesSigned(dy);
+        }
+    }
+
+    /// the layer's labels, by position like its shapes.
+    void writeTexts(OasisWriter& ow, WrittenModal& modal, const layout::Layer<pointT>* layer) {
+
+        OASIS_TRACE(TRACE_RECORD, "Texts " << layer->getTexts().size() << std::endl);
+        std::vector<layout::Text<pointT> > texts(layer->getTexts());
+        std::sort(texts.begin(), texts.end(), [](const layout::Text<pointT>& a, const layout::Text<pointT>& b) {
+            return std::make_tuple(a.y, a.x, a.string) < std::make_tuple(b.y, b.x, b.string);
+        });
+        for(const layout::Text<pointT>& text : texts) {
+            writeText(ow, modal, layer, text);
+        }
+    }
+
+    void writeCellRecord(OasisWriter& ow, TableOffsets& table, const layout::Cell<pointT>* cell) {
+
+        OASIS_TRACE(TRACE_RECORD, "Write Cell Record" << std::endl);
+        WrittenModal modal;
+        writeProperties(ow, modal, table, cell->getProperties());
+        typename std::map<std::string, layout::Layer<pointT>*>::const_iterator it;
+        for(it = cell->getLayers().begin(); it != cell->getLayers().end(); ++it) {
+
+            const layout::Layer<pointT>* layer = it->second;
+            table.addLayername(layer->getName(), layer->getLayerNum(), layer->getLayerNum(), layer->getDataType(), layer->getDataType());
+
+            writeTexts(ow, modal, layer);
+
+            if(detectRepetitions && (repetitionTimeLimit == 0 || report.milliseconds < repetitionTimeLimit)) {
+                writeLayerRepetitions(ow, modal, table, layer);
+                continue;
+            }
+
+            OASIS_TRACE(TRACE_RECORD, "Rectangles " << layer->getRects().size() << std::endl);
+            OASIS_COUNT(ShapesWritten, layer->getRects().size());
+            const layout::Rects<pointT>& rects = layer->getRects();
+            for(std::size_t i = 0; i < rects.size(); ++i) {
+                writeRectangle(ow, modal, layer, rects.getMinX(i), rects.getMinY(i),
+                               rects.getMaxX(i) - rects.getMinX(i), rects.getMaxY(i) - rects.getMinY(i));
+            }
+
+            // a layer keeps its shapes unordered. by position, neighbouring
+            // records share more fields and their steps are small.
+            std::vector<std::tuple<int, coord_type, coord_type, layout::iShape<pointT>*> > shapes;
+            shapes.reserve(layer->getShapes().size());
+            for(layout::iShape<pointT>* shape : layer->getShapes()) {
+                const layout::Box<pointT>& box = shape->getBBox();
+                shapes.emplace_back(shape->getShapeType(), box.getMinY(), box.getMinX(), shape);
+            }
+            std::sort(shapes.begin(), shapes.end());
+            for(const auto& shape : shapes) {
+                const layout::Properties* properties = layer->getProperties(std::get<3>(shape));
+                if(writeShape(ow, modal, layer, std::get<3>(shape)) && properties) {
+                    writeProperties(ow, modal, table, *properties);
+                }
+            }
+
+        }
+
+        OASIS_TRACE(TRACE_RECORD, "Placements " << cell->getPlacements().size() << std::endl);
+        for(const layout::Placement<pointT>& p : cell->getPlacements()) {
+            writePlacement(ow, modal, table.getCellReference(p.getCell()->getName()), p);
+        }
+
+    }
+
+    /// the point list of a polygon in the smallest type that holds it:
+    /// 1-deltas (types 0 and 1) for Manhattan polygons whose edges alternate
+    /// between horizontal and vertical, 2-deltas (type 2) for other Manhattan
+    /// polygons, 3-deltas (type 3) for octangular ones and g-deltas (type 4)
+    /// otherwise. the closing edge is implied, for types 0 and 1 the last
+    /// vertex as well. a path's list (closed false) has neither.
+    template<typename ringT>
+    void fillPointList(oasisio::PointList& pointList, const ringT& vertices, bool closed = true) {
+
+        std::size_t n = vertices.size();
+        // a closed ring repeats its first vertex.
+        if(closed && n > 1 && bg::get<0>(vertices[n-1]) == bg::get<0>(vertices[0]) &&
+                              bg::get<1>(vertices[n-1]) == bg::get<1>(vertices[0])) {
+            --n;
+        }
+        if(n < 2) {
+            return;
+        }
+
+        // one pass over the edges, the closing one included.
+        std::size_t edges = closed ? n : n - 1;
+        bool manhattan = true;
+        bool octangular = true;
+        bool horizontalFirst = !closed || (n >= 4 && n % 2 == 0);
+        bool verticalFirst = horizontalFirst;
+        std::size_t i;
+        for(i=0; i<edges; ++i) {
+            const auto& a = vertices[i];
+            const auto& b = vertices[(i+1) % n];
+            coord_type dx = bg::get<0>(b) - bg::get<0>(a);
+            coord_type dy = bg::get<1>(b) - bg::get<1>(a);
+            bool horizontal = dy == 0;
+            bool vertical = dx == 0;
+            manhattan = manhattan && (horizontal || vertical);
+            octangular = octangular && (horizontal || vertical || dx == dy || dx == -dy);
+            horizontalFirst = horizontalFirst && ((i % 2 == 0) ? horizontal : vertical);
+            verticalFirst = verticalFirst && ((i % 2 == 0) ? vertical : horizontal);
+        }
+
+        int delta;
+        std::size_t count = n - 1;
+        if(horizontalFirst || verticalFirst) {
+            pointList.setType(horizontalFirst ? POINT_LIST_0 : POINT_LIST_1);
+            delta = DELTA_1;
+            count = closed ? n - 2 : n - 1;
+        } else if(manhattan) {
+            pointList.setType(POINT_LIST_2);
+            delta = DELTA_2;
+        } else if(octangular) {
+            pointList.setType(POINT_LIST_3);
+            delta = DELTA_3;
+        } else {
+            pointList.setType(POINT_LIST_4);
+            delta = DELTA_G2;
+        }
+
+        // deltas straight from the DBU coordinates, no round trip through float.
+        pointList.reserve(count);
+        for(i=1; i<=count; ++i) {
+            pointList.addDelta(delta, (int) (bg::get<0>(vertices[i]) - bg::get<0>(vertices[i-1])),
+                                      (int) (bg::get<1>(vertices[i]) - bg::get<1>(vertices[i-1])));
+        }
+
+    }
+
+    /// append the vertices after points.back(), the first vertex, from a
+    /// polygon's point list, with the implied last vertex of types 0 and 1.
+    /// a path's list (closed false) has no implied vertex.
+    void fillPointVector(std::vector<pointT>& points, const oasisio::PointList& pointList, bool closed = true) {
+        const std::vector<Delta>& deltas = pointList.getList();
+        int type = pointList.getType();
+        pointT first = points.back();
+        points.reserve(points.size() + deltas.size() + 1);
+        std::size_t i;
+        for(i=0; i<deltas.size(); ++i) {
+            coord_type dx = deltas[i].getDeltaX();
+            coord_type dy = deltas[i].getDeltaY();
+            if(type == POINT_LIST_0 || type == POINT_LIST_1) {
+                // 1-deltas alternate, starting horizontal for type 0.
+                bool horizontal = (i % 2 == 0) == (type == POINT_LIST_0);
+                dy = horizontal ? 0 : dx;
+                dx = horizontal ? dx : 0;
+            }
+            pointT next;
+            bg::set<0>(next, dx + bg::get<0>(points.back()));
+            bg::set<1>(next, dy + bg::get<1>(points.back()));
+            points.emplace_back(next);
+        }
+        if(closed && (type == POINT_LIST_0 || type == POINT_LIST_1)) {
+            pointT last;
+            bg::set<0>(last, type == POINT_LIST_0 ? bg::get<0>(first) : bg::get<0>(points.back()));
+            bg::set<1>(last, type == POINT_LIST_0 ? bg::get<1>(points.back()) : bg::get<1>(first));
+            points.emplace_back(last);
+        }
+    }
+
+    /// check the magic bytes, then read the START record and the name tables.
+    TableOffsets readHeader(ByteSource& ifs, layout::Layout<pointT>& outLayout) {
+
+        char magic[12] = {0};
+        ifs.read(magic, 12);
+        // files written through a text mode stream on Windows carry "\r\n".
+        if(magic[11] == '\r' && ifs.get() == '\n') {
+            magic[11] = '\n';
+        }
+        int i;
+        for(i=0; i<12; ++i) {
+            //std::cout << std::hex << (int)(magic[i]) << " ";
+            if(magic[i] != MAGIC[i]) {
+                OASIS_TRACE(TRACE_SUMMARY, std::endl << "Mismatch" << std::endl);
+                throw std::exception("Magic bytes do not match.");
+            }
+        }
+        //std::cout << std::endl;
+
+        OASIS_TRACE(TRACE_SUMMARY, "Start Record" << std::endl);
+
+        TableOffsets table = readStartRecord(ifs, outLayout);
+        OASIS_TRACE(TRACE_SUMMARY, table << std::endl);
+        OASIS_TRACE(TRACE_SUMMARY, "Extract Cellnames" << std::endl);
+        OASIS_TRACE(TRACE_SUMMARY, "Extract Propnames" << std::endl);
+        table.extractPropnames(ifs);
+        table.extractPropstrings(ifs);
+        table.extractCellnames(ifs);
+        OASIS_TRACE(TRACE_SUMMARY, "Extract Textstrings" << std::endl);
+        table.setTextPool(&outLayout.getTextPool());
+        table.extractTextstrings(ifs);
+        OASIS_TRACE(TRACE_SUMMARY, "Extract Layernames" << std::endl);
+        table.extractLayernames(ifs);
+
+        // the file's own properties follow the START record. a non-strict
+        // file may name them only further on, see readFileProperties.
+        table.setFilePropertyOffset(ifs.tell());
+        while(true) {
+            unsigned int recordID = OasisReader::fromBytesUnsigned(ifs);
+            if(recordID != 28 && recordID != 29) {
+                ifs.unget();
+                break;
+            }
+            TableOffsets::skipProperty(ifs, recordID);
+        }
+
+        return table;
+
+    }
+
+    /// read the file's own properties once the name tables are complete.
+    void readFileProperties(ByteSource& ifs, TableOffsets& table, layout::Layout<pointT>& outLayout) {
+
+        ifs.seek(table.getFilePropertyOffset());
+        layout::Property property;
+        while(true) {
+            unsigned int recordID = OasisReader::fromBytesUnsigned(ifs);
+            if(recordID != 28 && recordID != 29) {
+                break;
+            }
+            table.readProperty(ifs, recordID, property);
+            outLayout.getProperties().push_back(property);
+        }
+
+    }
+
+    /// read the records up to the END record. cells are decoded into outLayout,
+    /// or with spans only located, and with measure their extents and
+    /// placements read as well. without untilEnd, the end of the data ends
+    /// the records too.
+    void readRecords(ByteSource& ifs, TableOffsets& table, layout::Layout<pointT>& outLayout,
+                     std::vector<CellSpan>* spans = nullptr, bool measure = false, bool untilEnd = true) {
+
+        TableOffsets::tCellnames& cellnames = table.getCellnames();
+        // the cell name the PROPERTY records that follow belong to, if any.
+        std::optional<unsigned int> propertyCellname;
+        layout::Property property;
+
+        bool done = false;
+        while(!done) {
+
+            unsigned int recordID = OasisReader::fromBytesUnsigned(ifs);
+            OASIS_TRACE(TRACE_RECORD, "Record ID : " << recordID << std::endl);
+            OASIS_COUNT(RecordsRead, 1);
+            if(recordID != 28 && recordID != 29 && recordID != 34) {
+                propertyCellname.reset();
+            }
+
+            switch(recordID) {
+
+            case 2: //End Record
+            {
+                done = true;
+                //Validation was read along with the START record, see readValidation
+                break;
+            }
+
+            case 4: //Cellname with reference number
+            {
+                if(table.getCellnameFlag() == 1) { //Strict, already read from the table
+                    OASIS_TRACE(TRACE_RECORD, "Skip cellname" << std::endl);
+                    OasisReader::skipString(ifs);
+                    OasisReader::fromBytesUnsigned(ifs);
+                } else {
+                    std::string_view cellname = table.intern(OasisReader::fromBytesStringView(ifs), ifs.isResident());
+                    unsigned int reference = OasisReader::fromBytesUnsigned(ifs);
+                    OASIS_TRACE(TRACE_RECORD, "Cellname : " << cellname << std::endl);
+                    OASIS_TRACE(TRACE_RECORD, "Reference : " << reference << std::endl);
+                    table.setCellname(reference, cellname, true);
+                    propertyCellname = reference;
+                }
+                break;
+            }
+
+            case 7: //Propname, numbered in file order
+            case 8: //Propname with reference number
+            {
+                if(table.getPropnameFlag() == 1) { //Strict, already read from the table
+                    OasisReader::skipString(ifs);
+                    if(recordID == 8) {
+                        OasisReader::fromBytesUnsigned(ifs);
+                    }
+                } else {
+                    std::string_view propname = table.intern(OasisReader::fromBytesStringView(ifs), ifs.isResident());
+                    if(recordID == 8) {
+                        table.setPropname(OasisReader::fromBytesUnsigned(ifs), propname, true);
+                    } else {
+                        table.addPropname(propname, true);
+                    }
+                }
+                break;
+            }
+
+            case 9: //Propstring, numbered in file order
+            case 10: //Propstring with reference number
+            {
+                if(table.getPropstringFlag() == 1) { //Strict, already read from the table
+                    OasisReader::skipString(ifs);
+                    if(recordID == 10) {
+                        OasisReader::fromBytesUnsigned(ifs);
+                    }
+                } else {
+                    std::string_view propstring = table.intern(OasisReader::fromBytesStringView(ifs), ifs.isResident());
+                    if(recordID == 10) {
+                        table.setPropstring(OasisReader::fromBytesUnsigned(ifs), propstring, true);
+                    } else {
+                        table.addPropstring(propstring, true);
+                    }
+                }
+                break;
+            }
+
+            case 28: //Property
+            case 29: //Property, the previous one again
+            {
+                // outside a cell, only a cell name's S_ properties are kept.
+                table.readProperty(ifs, recordID, property);
+                if(propertyCellname) {
+                    table.setCellnameProperty(*propertyCellname, property);
+                }
+                break;
+            }
+
+            case 5: //Textstring, numbered in file order
+            case 6: //Textstring with reference number
+            {
+                if(table.getTextstringFlag() == 1) { //Strict, already read from the table
+                    OASIS_TRACE(TRACE_RECORD, "Skip textstring" << std::endl);
+                    OasisReader::skipString(ifs);
+                    if(recordID == 6) {
+                        OasisReader::fromBytesUnsigned(ifs);
+                    }
+                } else {
+                    unsigned int string = table.internText(OasisReader::fromBytesStringView(ifs));
+                    if(recordID == 6) {
+                        table.setTextstring(OasisReader::fromBytesUnsigned(ifs), string);
+                    } else {
+                        table.addTextstring(string);
+                    }
+                }
+                break;
+            }
+
+            case 11:
+            {
+                if(table.getLayernameFlag() == 1) {
+                    OASIS_TRACE(TRACE_RECORD, "Skip layername" << std::endl);
+                    OasisReader::skipString(ifs);
+                    OasisReader::skipInterval(ifs);
+                    OasisReader::skipInterval(ifs);
+                } else {
+                    unsigned int li1, li2, di1, di2;
+                    std::string_view layername = table.intern(OasisReader::fromBytesStringView(ifs), ifs.isResident());
+                    unsigned int layer_interval_type = OasisReader::fromBytesUnsigned(ifs);
+                    switch(layer_interval_type) {
+                    case 3: //Only supported case atm
+                        li1 = OasisReader::fromBytesUnsigned(ifs);
+                        li2 = li1;
+                        break;
+                    }
+                    unsigned int data_interval_type = OasisReader::fromBytesUnsigned(ifs);
+                    switch(data_interval_type) {
+                    case 3: //Only supported case atm
+                        di1 = OasisReader::fromBytesUnsigned(ifs);
+                        di2 = di1;
+                        break;
+                    }
+                    table.addLayername(layername, li1, li2, di1, di2, true);
+                }
+                break;
+            }
+
+            case 13: //Cell with reference number
+            {
+                unsigned int reference = OasisReader::fromBytesUnsigned(ifs);
+                std::string_view cellname = cellnames.find(reference)->second;
+                //Add functionality to look up cellname table if the reference hasn't been added yet
+                OASIS_TRACE(TRACE_RECORD, "Cellname : " << cellname << std::endl);
+                OASIS_TRACE(TRACE_RECORD, "Reference : " << reference << std::endl);
+
+                // a cell starting inside a CBLOCK has no file range of its own.
+                if(spans && !ifs.inBlock()) {
+                    CellSpan span;
+                    span.name = cellname;
+                    span.begin = ifs.tell();
+                    span.bbox.makeInvalid();
+                    if(measure) {
+                        skipCellRecord(ifs, &span.bbox, &span.placements);
+                    } else {
+                        skipCellRecord(ifs);
+                    }
+                    span.end = ifs.tell();
+                    spans->push_back(std::move(span));
+                } else {
+                    layout::Cell<pointT>* cell = outLayout.newCell(std::string(cellname));
+                    std::vector<PlacementRecord> placements;
+                    readCellRecord(ifs, table, cell, &placements);
+                    addPlacements(table, outLayout, cell, placements);
+                }
+
+                break;
+            }
+
+            case 34: //CBLOCK
+            {
+                OasisReader::fromBytesCblock(ifs);
+                break;
+            }
+
+            }
+
+            if(ifs.eof()) {
+                done = true;
+                if(!untilEnd) {
+                    break;
+                }
+                throw std::exception("Failed to find End Record.");
+            }
+
+        }
+
+    }
+
+    /// cell ranges from the S_CELL_OFFSET offsets. false unless every cell has
+    /// one leading to its CELL record; ifs is then left where it was, so the
+    /// caller can scan the records instead.
+    bool findCellSpans(ByteSource& ifs, TableOffsets& table, std::vector<CellSpan>& spans) {
+
+        std::size_t start = ifs.tell();
+        const std::map<unsigned int, std::uint64_t>& offsets = table.getCellOffsets();
+        if(offsets.empty() || offsets.size() != table.getCellnames().size()) {
+            return false;
+        }
+        // without strict tables, text strings and property names are only
+        // found by the scan.
+        if(table.getTextstringFlag() != 1 || table.getPropnameFlag() != 1 || table.getPropstringFlag() != 1) {
+            return false;
+        }
+        std::vector<std::pair<std::uint64_t, unsigned int> > sorted;
+        std::map<unsigned int, std::uint64_t>::const_iterator it = offsets.begin();
+        for(; it != offsets.end(); ++it) {
+            if(table.getCellnames().find(it->first) == table.getCellnames().end()) {
+                return false;
+            }
+            sorted.push_back(std::make_pair(it->second, it->first));
+        }
+        std::sort(sorted.begin(), sorted.end());
+
+        std::size_t i;
+        for(i=0; i<sorted.size(); ++i) {
+            // a stale offset, or one pointing at the CBLOCK that holds the
+            // CELL record, does not lead to "13 <reference>".
+            bool found = sorted[i].first < ifs.size();
+            if(found) {
+                ifs.seek(sorted[i].first);
+                found = OasisReader::fromBytesUnsigned(ifs) == 13 &&
+                        OasisReader::fromBytesUnsigned(ifs) == sorted[i].second;
+            }
+            if(!found) {
+                spans.clear();
+                ifs.seek(start);
+                return false;
+            }
+            // a cell can only end at the next one; readCellRecord stops at
+            // the first record that is not part of it.
+            CellSpan span;
+            span.name = table.getCellnames()[sorted[i].second];
+            span.begin = ifs.tell();
+            span.end = (i+1 < sorted.size()) ? sorted[i+1].first : ifs.size();
+            span.bbox.makeInvalid();
+            spans.push_back(std::move(span));
+        }
+        OASIS_TRACE(TRACE_SUMMARY, spans.size() << " cells at known offsets" << std::endl);
+        return true;
+    }
+
+    /// decode the cells in spans on up to threads threads, each into its own
+    /// Cell and arena, then hand them to outLayout in file order.
+    void readCells(ByteSource& ifs, TableOffsets& table, const std::vector<CellSpan>& spans,
+                   unsigned int threads, layout::Layout<pointT>& outLayout) {
+
+        // a resident source is decoded in place; otherwise each cell is copied
+        // out first, since the buffered window moves.
+        std::vector<std::vector<byte> > copies;
+        std::vector<SpanByteSource> sources;
+        sources.reserve(spans.size());
+        if(!ifs.isResident()) {
+            copies.reserve(spans.size());
+        }
+        // a cell name that shows up twice (or is already in the layout) is
+        // appended to the existing cell afterwards, like the sequential reader does.
+        std::vector<bool> merge(spans.size(), false);
+        std::set<std::string_view> seen;
+        std::size_t i;
+        for(i=0; i<spans.size(); ++i) {
+            std::size_t len = spans[i].end - spans[i].begin;
+            ifs.seek(spans[i].begin);
+            if(ifs.isResident()) {
+                sources.emplace_back(ifs.data(), std::min(len, ifs.ensure(len)));
+            } else {
+                copies.emplace_back(len);
+                ifs.read((char *)copies.back().data(), len);
+                sources.emplace_back(copies.back().data(), len);
+            }
+            merge[i] = !seen.insert(spans[i].name).second ||
+                       outLayout.getCell(std::string(spans[i].name)) != nullptr;
+        }
+
+        std::vector<layout::Cell<pointT>*> cells(spans.size(), nullptr);
+        std::vector<std::vector<PlacementRecord> > placements(spans.size());
+        std::atomic<std::size_t> next(0);
+        std::atomic<bool> failed(false);
+        std::exception_ptr error;
+        std::mutex errorMutex;
+        auto work = [&](layout::Arena* arena) {
+            try {
+                while(!failed) {
+                    std::size_t k = next++;
+                    if(k >= spans.size()) {
+                        break;
+                    }
+                    if(merge[k]) {
+                        continue;
+                    }
+                    cells[k] = new layout::Cell<pointT>(std::string(spans[k].name), arena);
+                    readCellRecord(sources[k], table, cells[k], &placements[k]);
+                }
+            } catch(...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if(!error) {
+                    error = std::current_exception();
+                }
+                failed = true;
+            }
+        };
+
+        threads = (unsigned int)std::min<std::size_t>(threads, spans.size());
+        OASIS_TRACE(TRACE_SUMMARY, "Decode " << spans.size() << " cells on " << threads << " threads" << std::endl);
+        std::vector<std::thread> workers;
+        unsigned int t;
+        for(t=1; t<threads; ++t) {
+            workers.emplace_back(work, outLayout.newArena());
+        }
+        work(outLayout.newArena());
+        for(std::thread& w : workers) {
+            w.join();
+        }
+
+        if(error) {
+            for(layout::Cell<pointT>* cell : cells) {
+                delete cell;
+            }
+            std::rethrow_exception(error);
+        }
+
+        for(i=0; i<spans.size(); ++i) {
+            if(merge[i]) {
+                cells[i] = outLayout.newCell(std::string(spans[i].name));
+                readCellRecord(sources[i], table, cells[i], &placements[i]);
+            } else {
+                outLayout.adoptCell(cells[i]);
+            }
+        }
+        // only once every span's cell is adopted: both may create cells.
+        for(i=0; i<spans.size(); ++i) {
+            addPlacements(table, outLayout, cells[i], placements[i]);
+            // the cell ended inside a CBLOCK: the rest of it holds further cells.
+            if(sources[i].inBlock()) {
+                readRecords(sources[i], table, outLayout, nullptr, false, false);
+            }
+        }
+    }
+
+    /// walk over a cell's records like readCellRecord, without decoding them.
+    /// with bbox, only the coordinates are decoded, into the extent of the
+    /// cell's own shapes (invalid when there are none). with placements, the
+    /// cell's PLACEMENT records are collected.
+    void skipCellRecord(ByteSource& ifs, layout::Box<pointT>* bbox = nullptr,
+                        std::vector<PlacementRecord>* placements = nullptr) {
+
+        Modal modal;
+
+        if(bbox) {
+            bbox->makeInvalid();
+        }
+
+        while(true) {
+
+            unsigned int recordID = OasisReader::fromBytesUnsigned(ifs);
+            switch(recordID) {
+            case 20:
+            {
+                unsigned char info = OasisReader::fromBytesChar(ifs);
+                if(!bbox) {
+                    //L, D, W, H, X, Y
+                    OasisReader::skipUnsigned(ifs, ((info & 1) != 0) + ((info & 2) != 0) + ((info & 64) != 0) +
+                                                   ((info & 32) != 0) + ((info & 16) != 0) + ((info & 8) != 0));
+                    if(info & 4) {
+                        readRepetition(ifs, modal.repetition);
+                    }
+                    break;
+                }
+                OasisReader::skipUnsigned(ifs, ((info & 1) != 0) + ((info & 2) != 0));
+                unsigned int fields[4];
+                const unsigned int* field = fields;
+                OasisReader::fromBytesUnsigned(ifs, fields, ((info & 64) != 0) + ((info & 32) != 0) +
+                                                            ((info & 16) != 0) + ((info & 8) != 0));
+                if(info & 64) {
+                    modal.width = *field++;
+                }
+                if(info & 32) {
+                    modal.height = *field++;
+                }
+                if(info & 16) {
+                    modal.x = modalXY(modal, modal.x, varint::toSigned(*field++));
+                }
+                if(info & 8) {
+                    modal.y = modalXY(modal, modal.y, varint::toSigned(*field++));
+                }
+                if(info & 128) {
+                    modal.height = modal.width;
+                }
+                layout::Box<pointT> box(modal.x, modal.y, modal.x+modal.width, modal.y+modal.height);
+                if(info & 4) {
+                    readRepetition(ifs, modal.repetition);
+                    box = modal.repetition.apply(box);
+                }
+                expandBBox(*bbox, box);
+                break;
+            }
+            case 21:
+            {
+                unsigned char info = OasisReader::fromBytesChar(ifs);
+                OasisReader::skipUnsigned(ifs, ((info & 1) != 0) + ((info & 2) != 0));
+                if(!bbox) {
+                    if(info & 32) {
+                        OasisReader::skipPointList(ifs);
+                    }
+                    OasisReader::skipUnsigned(ifs, ((info & 16) != 0) + ((info & 8) != 0));
+                    if(info & 4) {
+                        readRepetition(ifs, modal.repetition);
+                    }
+                    break;
+                }
+                if(info & 32) {
+                    modal.polygon.clear();
+                    OasisReader::fromBytesPointList(ifs, modal.polygon);
+                }
+                unsigned int fields[2];
+                const unsigned int* field = fields;
+                OasisReader::fromBytesUnsigned(ifs, fields, ((info & 16) != 0) + ((info & 8) != 0));
+                if(info & 16) {
+                    modal.x = modalXY(modal, modal.x, varint::toSigned(*field++));
+                }
+                if(info & 8) {
+                    modal.y = modalXY(modal, modal.y, varint::toSigned(*field++));
+                }
+                std::vector<pointT> points(1, pointT(modal.x, modal.y));
+                fillPointVector(points, modal.polygon);
+                layout::Box<pointT> box(modal.x, modal.y, modal.x, modal.y);
+                for(const pointT& pt : points) {
+                    box.expand(layout::Box<pointT>(pt.x(), pt.y(), pt.x(), pt.y()));
+                }
+                if(info & 4) {
+                    readRepetition(ifs, modal.repetition);
+                    box = modal.repetition.apply(box);
+                }
+                expandBBox(*bbox, box);
+                break;
+            }
+            case 27:
+            {
+                unsigned char info = OasisReader::fromBytesChar(ifs);
+                if(!bbox) {
+                    //L, D, r, X, Y
+                    OasisReader::skipUnsigned(ifs, ((info & 1) != 0) + ((info & 2) != 0) + ((info & 32) != 0) +
+                                                   ((info & 16) != 0) + ((info & 8) != 0));
+                    if(info & 4) {
+                        readRepetition(ifs, modal.repetition);
+                    }
+                    break;
+                }
+                OasisReader::skipUnsigned(ifs, ((info & 1) != 0) + ((info & 2) != 0));
+                unsigned int fields[3];
+                const unsigned int* field = fields;
+                OasisReader::fromBytesUnsigned(ifs, fields, ((info & 32) != 0) + ((info & 16) != 0) + ((info & 8) != 0));
+                if(info & 32) {
+                    modal.radius = *field++;
+                }
+                if(info & 16) {
+                    modal.x = modalXY(modal, modal.x, varint::toSigned(*field++));
+                }
+                if(info & 8) {
+                    modal.y = modalXY(modal, modal.y, varint::toSigned(*field++));
+                }
+                coord_type r = modal.radius;
+                layout::Box<pointT> box(modal.x-r, modal.y-r, modal.x+r, modal.y+r);
+                if(info & 4) {
+                    readRepetition(ifs, modal.repetition);
+                    box = modal.repetition.apply(box);
+                }
+                expandBBox(*bbox, box);
+                break;
+            }
+            case 22:
+            {
+                unsigned char info = OasisReader::fromBytesChar(ifs);
+                if(!bbox) {
+                    //L, D, W
+                    OasisReader::skipUnsigned(ifs, ((info & 1) != 0) + ((info & 2) != 0) + ((info & 64) != 0));
+                    if(info & 128) {
+                        unsigned int scheme = OasisReader::fromBytesUnsigned(ifs);
+                        OasisReader::skipUnsigned(ifs, ((scheme & 12) == 12) + ((scheme & 3) == 3));
+                    }
+                    if(info & 32) {
+                        OasisReader::skipPointList(ifs);
+                    }
+                    OasisReader::skipUnsigned(ifs, ((info & 16) != 0) + ((info & 8) != 0));
+                    if(info & 4) {
+                        readRepetition(ifs, modal.repetition);
+                    }
+                    break;
+                }
+                OasisReader::skipUnsigned(ifs, ((info & 1) != 0) + ((info & 2) != 0));
+                readPathFields(ifs, info, modal);
+                unsigned int fields[2];
+                const unsigned int* field = fields;
+                OasisReader::fromBytesUnsigned(ifs, fields, ((info & 16) != 0) + ((info & 8) != 0));
+                if(info & 16) {
+                    modal.x = modalXY(modal, modal.x, varint::toSigned(*field++));
+                }
+                if(info & 8) {
+                    modal.y = modalXY(modal, modal.y, varint::toSigned(*field++));
+                }
+                std::vector<pointT> points(1, pointT(modal.x, modal.y));
+                fillPointVector(points, modal.path, false);
+                layout::Box<pointT> box = layout::Path<pointT>(points, modal.halfWidth, modal.startExtension,
+                                                               modal.endExtension).getBBox();
+                if(info & 4) {
+                    readRepetition(ifs, modal.repetition);
+                    box = modal.repetition.apply(box);
+                }
+                expandBBox(*bbox, box);
+                break;
+            }
+            case 23:
+            case 24:
+            case 25:
+            case 26:
+            {
+                unsigned char info = OasisReader::fromBytesChar(ifs);
+                bool ctrapezoid = recordID == 26;
+                //delta-a, delta-b
+                unsigned int deltas = ctrapezoid ? 0 : (recordID == 23 ? 2 : 1);
+                if(!bbox) {
+                    //L, D, T, W, H, deltas, X, Y
+                    OasisReader::skipUnsigned(ifs, ((info & 1) != 0) + ((info & 2) != 0) + (ctrapezoid && (info & 128)) +
+                                                   ((info & 64) != 0) + ((info & 32) != 0) + deltas +
+                                                   ((info & 16) != 0) + ((info & 8) != 0));
+                    if(info & 4) {
+                        readRepetition(ifs, modal.repetition);
+                    }
+                    break;
+                }
+                OasisReader::skipUnsigned(ifs, ((info & 1) != 0) + ((info & 2) != 0));
+                unsigned int fields[3];
+                const unsigned int* field = fields;
+                OasisReader::fromBytesUnsigned(ifs, fields, (ctrapezoid && (info & 128)) + ((info & 64) != 0) +
+                                                            ((info & 32) != 0));
+                if(ctrapezoid && (info & 128)) {
+                    modal.ctrapezoidType = *field++;
+                }
+                if(info & 64) {
+                    modal.width = *field++;
+                }
+                if(info & 32) {
+                    modal.height = *field++;
+                }
+                if(ctrapezoid) {
+                    ctrapezoidSize(modal.ctrapezoidType, modal.width, modal.height);
+                }
+                OasisReader::skipUnsigned(ifs, deltas);
+                field = fields;
+                OasisReader::fromBytesUnsigned(ifs, fields, ((info & 16) != 0) + ((info & 8) != 0));
+                if(info & 16) {
+                    modal.x = modalXY(modal, modal.x, varint::toSigned(*field++));
+                }
+                if(info & 8) {
+                    modal.y = modalXY(modal, modal.y, varint::toSigned(*field++));
+                }
+                layout::Box<pointT> box(modal.x, modal.y, modal.x+modal.width, modal.y+modal.height);
+                if(info & 4) {
+                    readRepetition(ifs, modal.repetition);
+                    box = modal.repetition.apply(box);
+                }
+                expandBBox(*bbox, box);
+                break;
+            }
+            case 19:
+            {
+                // labels are not part of the extent.
+                unsigned char info = OasisReader::fromBytesChar(ifs);
+                if(info & 64) {
+                    if(info & 32) {
+                        OasisReader::skipUnsigned(ifs, 1);
+                    } else {
+                        OasisReader::skipString(ifs);
+                    }
+                }
+                //L, T, X, Y
+                OasisReader::skipUnsigned(ifs, ((info & 1) != 0) + ((info & 2) != 0) + ((info & 16) != 0) + ((info & 8) != 0));
+                if(info & 4) {
+                    readRepetition(ifs, modal.repetition);
+                }
+                break;
+            }
+            case 28:
+            case 29:
+                TableOffsets::skipProperty(ifs, recordID);
+                break;
+            case 17:
+            case 18:
+            {
+                readPlacement(ifs, recordID, modal);
+                if(placements) {
+                    placements->push_back(modal.placement);
+                }
+                break;
+            }
+            case 34:
+            {
+                // only looked into when it matters: the cell may end inside it.
+                if(bbox || placements) {
+                    OasisReader::fromBytesCblock(ifs);
+                } else {
+                    OasisReader::skipCblock(ifs);
+                }
+                break;
+            }
+            case 15: //XYABSOLUTE
+                modal.relative = false;
+                break;
+            case 16: //XYRELATIVE
+                modal.relative = true;
+                break;
+            default:
+                ifs.unget();
+                return;
+            }
+
+        }
+
+    }
+
+    static void expandBBox(layout::Box<pointT>& bbox, const layout::Box<pointT>& box) {
+        if(bbox.isValid()) {
+            bbox.expand(box);
+        } else {
+            bbox = box;
+        }
+    }
+
+    /// read the repetition at the end of a record whose R bit is set into
+    /// repetition. type 0 keeps the previous one, which repetition holds.
+    static void readRepetition(ByteSource& ifs, layout::Repetition<pointT>& repetition) {
+
+        unsigned int type = OasisReader::fromBytesUnsigned(ifs);
+        OASIS_TRACE(TRACE_DETAIL, "Repetition Type " << type << std::endl);
+        switch(type) {
+        case 0: //Previous repetition
+            break;
+        case 1: //x-dimension, y-dimension, x-space, y-space
+        {
+            unsigned int fields[4];
+            OasisReader::fromBytesUnsigned(ifs, fields, 4);
+            repetition = layout::Repetition<pointT>(fields[0] + 2, pointT(fields[2], 0), fields[1] + 2, pointT(0, fields[3]));
+            break;
+        }
+        case 2: //x-dimension, x-space
+        case 3: //y-dimension, y-space
+        {
+            unsigned int fields[2];
+            OasisReader::fromBytesUnsigned(ifs, fields, 2);
+            repetition = layout::Repetition<pointT>(fields[0] + 2, type == 2 ? pointT(fields[1], 0) : pointT(0, fields[1]));
+            break;
+        }
+        case 4: //x-dimension, x-space 1 .. n-1
+        case 5: //x-dimension, grid, x-space 1 .. n-1
+        case 6: //y-dimension, y-space 1 .. n-1
+        case 7: //y-dimension, grid, y-space 1 .. n-1
+        {
+            unsigned int n = OasisReader::fromBytesUnsigned(ifs) + 2;
+            coord_type grid = (type == 5 || type == 7) ? OasisReader::fromBytesUnsigned(ifs) : 1;
+            std::vector<unsigned int> spaces(n - 1);
+            OasisReader::fromBytesUnsigned(ifs, spaces.data(), spaces.size());
+            std::vector<pointT> offsets;
+            offsets.reserve(n);
+            offsets.emplace_back(0, 0);
+            coord_type pos = 0;
+            for(unsigned int space : spaces) {
+                pos += (coord_type)space * grid;
+                offsets.push_back(type <= 5 ? pointT(pos, 0) : pointT(0, pos));
+            }
+            repetition = layout::Repetition<pointT>(offsets);
+            break;
+        }
+        case 8: //n-dimension, m-dimension, n-displacement, m-displacement
+        {
+            unsigned int fields[2];
+            OasisReader::fromBytesUnsigned(ifs, fields, 2);
+            Delta n = OasisReader::fromBytesDelta(ifs, DELTA_G);
+            Delta m = OasisReader::fromBytesDelta(ifs, DELTA_G);
+            repetition = layout::Repetition<pointT>(fields[0] + 2, pointT(n.getDeltaX(), n.getDeltaY()),
+                                                    fields[1] + 2, pointT(m.getDeltaX(), m.getDeltaY()));
+            break;
+        }
+        case 9: //dimension, displacement
+        {
+            unsigned int n = OasisReader::fromBytesUnsigned(ifs) + 2;
+            Delta d = OasisReader::fromBytesDelta(ifs, DELTA_G);
+            repetition = layout::Repetition<pointT>(n, pointT(d.getDeltaX(), d.getDeltaY()));
+            break;
+        }
+        case 10: //dimension, displacement 1 .. n-1
+        case 11: //dimension, grid, displacement 1 .. n-1
+        {
+            unsigned int n = OasisReader::fromBytesUnsigned(ifs) + 2;
+            coord_type grid = (type == 11) ? OasisReader::fromBytesUnsigned(ifs) : 1;
+            std::vector<pointT> offsets;
+            offsets.reserve(n);
+            offsets.emplace_back(0, 0);
+            coord_type x = 0, y = 0;
+            unsigned int i;
+            for(i=1; i<n; ++i) {
+                Delta d = OasisReader::fromBytesDelta(ifs, DELTA_G);
+                x += d.getDeltaX() * grid;
+                y += d.getDeltaY() * grid;
+                offsets.emplace_back(x, y);
+            }
+            repetition = layout::Repetition<pointT>(offsets);
+            break;
+        }
+        default:
+            throw std::exception("Invalid repetition type.");
+        }
+    }
+
+    /// an X or Y field read as v: the position itself, or after XYRELATIVE
+    /// the step from the modal position.
+    static coord_type modalXY(const Modal& modal, coord_type previous, int v) {
+        return modal.relative ? previous + v : v;
+    }
+
+    /// read the PLACEMENT record (17 or 18) after its record ID into
+    /// modal.placement, which holds the previous placement of the cell.
+    static void readPlacement(ByteSource& ifs, unsigned int recordID, Modal& modal) {
+
+        PlacementRecord& p = modal.placement;
+        layout::Repetition<pointT>& repetition = modal.repetition;
+
+        unsigned char placement_info = OasisReader::fromBytesChar(ifs);
+        OASIS_TRACE(TRACE_DETAIL, "Placement Info " << std::bitset<8>((int)placement_info).to_string() << std::endl);
+        bool C = placement_info & 128;
+        bool N = placement_info & 64;
+        bool X = placement_info & 32;
+        bool Y = placement_info & 16;
+        bool R = placement_info & 8;
+        bool F = placement_info & 1;
+
+        //without C, the previous placement's cell
+        if(C) {
+            p.byName = !N;
+            if(N) {
+                p.reference = OasisReader::fromBytesUnsigned(ifs);
+                OASIS_TRACE(TRACE_DETAIL, "Reference " << p.reference << std::endl);
+            } else {
+                p.name = std::string(OasisReader::fromBytesStringView(ifs));
+                OASIS_TRACE(TRACE_DETAIL, "Cellname " << p.name << std::endl);
+            }
+        }
+        if(recordID == 17) {
+            //AA, counter-clockwise quarter turns
+            p.angle = 90.0 * ((placement_info >> 1) & 3);
+            p.magnification = 1.0;
+        } else {
+            p.magnification = (placement_info & 4) ? OasisReader::fromBytesReal(ifs) : 1.0;
+            p.angle = (placement_info & 2) ? OasisReader::fromBytesReal(ifs) : 0.0;
+        }
+        p.mirror = F;
+        if(X) {
+            p.x = modalXY(modal, p.x, OasisReader::fromBytesSigned(ifs));
+            OASIS_TRACE(TRACE_DETAIL, "X " << p.x << std::endl);
+        }
+        if(Y) {
+            p.y = modalXY(modal, p.y, OasisReader::fromBytesSigned(ifs));
+            OASIS_TRACE(TRACE_DETAIL, "Y " << p.y << std::endl);
+        }
+        if(R) {
+            readRepetition(ifs, repetition);
+            p.repetition = repetition;
+        } else {
+            p.repetition = layout::Repetition<pointT>();
+        }
+    }
+
+    /// the half-width, extensions and point list of a PATH record whose
+    /// info byte is info, into the modal variables.
+    static void readPathFields(ByteSource& ifs, unsigned char info, Modal& modal) {
+        if(info & 64) {
+            modal.halfWidth = OasisReader::fromBytesUnsigned(ifs);
+            OASIS_TRACE(TRACE_DETAIL, "Half Width " << modal.halfWidth << std::endl);
+        }
+        if(info & 128) {
+            //0000SSEE: 0 modal, 1 none, 2 half-width, 3 explicit
+            unsigned int scheme = OasisReader::fromBytesUnsigned(ifs);
+            coord_type* extensions[2] = {&modal.startExtension, &modal.endExtension};
+            int k;
+            for(k=0; k<2; ++k) {
+                switch((scheme >> (2 - 2*k)) & 3) {
+                case 1:
+                    *extensions[k] = 0;
+                    break;
+                case 2:
+                    *extensions[k] = modal.halfWidth;
+                    break;
+                case 3:
+                    *extensions[k] = OasisReader::fromBytesSigned(ifs);
+                    break;
+                }
+            }
+            OASIS_TRACE(TRACE_DETAIL, "Extensions " << modal.startExtension << " " << modal.endExtension << std::endl);
+        }
+        if(info & 32) {
+            modal.path.clear();
+            OasisReader::fromBytesPointList(ifs, modal.path);
+            OASIS_TRACE(TRACE_DETAIL, "Read Point List " << modal.path << std::endl);
+        }
+    }
+
+    /// place the cells named by records in cell, creating the ones not read yet.
+    void addPlacements(TableOffsets& table, layout::Layout<pointT>& outLayout, layout::Cell<pointT>* cell,
+                       const std::vector<PlacementRecord>& records) {
+
+        typename std::vector<PlacementRecord>::const_iterator it = records.begin();
+        for(; it != records.end(); ++it) {
+            std::string cellname = it->name;
+            if(!it->byName) {
+                TableOffsets::tCellnames::const_iterator nit = table.getCellnames().find(it->reference);
+                if(nit == table.getCellnames().end()) {
+                    throw std::exception("Unknown cell reference in placement.");
+                }
+                cellname = std::string(nit->second);
+            }
+            layout::Cell<pointT>* child = outLayout.newCell(cellname);
+            pointT offset;
+            bg::set<0>(offset, it->x);
+            bg::set<1>(offset, it->y);
+            cell->addPlacement(child, offset, it->angle, it->mirror, it->magnification, it->repetition);
+        }
+    }
+
+    /// the layer of cell that shapes on layernum/datatype go to, made on first
+    /// use and named from the LAYERNAME range that covers it.
+    layout::Layer<pointT>* layerFor(layout::Cell<pointT>* cell, TableOffsets& table,
+                                    unsigned int layernum, unsigned int datatype) {
+
+        layout::Layer<pointT>* layer = cell->getLayer(layernum, datatype);
+        if(layer != nullptr) {
+            return layer;
+        }
+        switch(layernum) {
+        case 2:
+            layer = cell->newLayer(layernum, datatype, QColor("green"));
+            break;
+        case 3:
+            layer = cell->newLayer(layernum, datatype, QColor("yellow"));
+            break;
+        case 1:
+        default:
+            layer = cell->newLayer(layernum, datatype, QColor("red"));
+            break;
+        }
+        typename TableOffsets::tLayernames::const_iterator it = table.getLayernames().begin();
+        for(; it != table.getLayernames().end(); ++it) {
+            if(layernum >= std::get<0>(it->first) && layernum <= std::get<1>(it->first) &&
+                datatype >= std::get<2>(it->first) && datatype <= std::get<3>(it->first)) {
+                layer->setName(std::string(it->second));
+                break;
+            }
+        }
+        return layer;
+
+    }
+
+    /// decode a cell's records into cell. the placements are collected in
+    /// placements, to be added once the placed cells exist; without it they
+    /// are read over, for cells whose placements are already known.
+    void readCellRecord(ByteSource& ifs, TableOffsets& table, layout::Cell<pointT>* cell,
+                        std::vector<PlacementRecord>* placements = nullptr) {
+
+        Modal modal;
+        // the layer of textlayer and texttype, looked up again when they change.
+        layout::Layer<pointT>* textLayer = nullptr;
+        PropertyOwner owner;
+
+        while(true) {
+
+            unsigned int recordID = OasisReader::fromBytesUnsigned(ifs);
+            OASIS_TRACE(TRACE_RECORD, "Record ID " << recordID << std::endl);
+            OASIS_COUNT(RecordsRead, 1);
+            switch(recordID) {
+            case 20:
+            {
+                unsigned char rectangle_info = OasisReader::fromBytesChar(ifs);
+                OASIS_TRACE(TRACE_DETAIL, "Rectangle Info " << std::bitset<8>((int)rectangle_info).to_string() << std::endl);
+                bool S = rectangle_info & 128;
+                bool W = rectangle_info & 64;
+                bool H = rectangle_info & 32;
+                bool X = rectangle_info & 16;
+                bool Y = rectangle_info & 8;
+                bool R = rectangle_info & 4;
+                bool D = rectangle_info & 2;
+                bool L = rectangle_info & 1;
+                unsigned int& layernum = modal.layer;
+                unsigned int& datatype = modal.datatype;
+                unsigned int& width = modal.width;
+                unsigned int& height = modal.height;
+                coord_type& x = modal.x;
+                coord_type& y = modal.y;
+                // the present fields are consecutive integers: decode them in one go.
+                unsigned int fields[6];
+                const unsigned int* field = fields;
+                OasisReader::fromBytesUnsigned(ifs, fields, L + D + W + H + X + Y);
+                if(L) {
+                    layernum = *field++;
+                    OASIS_TRACE(TRACE_DETAIL, "Layer Num " << layernum << std::endl);
+                }
+                if(D) {
+                    datatype = *field++;
+                    OASIS_TRACE(TRACE_DETAIL, "Datatype " << datatype << std::endl);
+                }
+                if(W) {
+                    width = *field++;
+                    OASIS_TRACE(TRACE_DETAIL, "Width " << width << std::endl);
+                }
+                if(H) {
+                    height = *field++;
+                    OASIS_TRACE(TRACE_DETAIL, "Height " << height << std::endl);
+                }
+                if(X) {
+                    x = modalXY(modal, x, varint::toSigned(*field++));
+                    OASIS_TRACE(TRACE_DETAIL, "X " << x << std::endl);
+                }
+                if(Y) {
+                    y = modalXY(modal, y, varint::toSigned(*field++));
+                    OASIS_TRACE(TRACE_DETAIL, "Y " << y << std::endl);
+                }
+                if(S) {
+                    height = width;
+                }
+                if(R) {
+                    readRepetition(ifs, modal.repetition);
+                }
+
+                layout::Layer<pointT>* layer = layerFor(cell, table, layernum, datatype);
+                if(R) {
+                    // an array stays one shape; its copies are never built.
+                    owner.shape = layer->template newShape<layout::RepeatedShape<pointT> >(
+                        new layout::Box<pointT>(x, y, x+width, y+height), modal.repetition);
+                } else {
+                    owner.shape = nullptr;
+                    owner.rect = layer->addRect(x, y, x+width, y+height);
+                }
+                owner.cell = false;
+                owner.layer = layer;
+                OASIS_COUNT(ShapesRead, 1);
+
+                break;
+            }
+            case 21:
+            {
+                unsigned char polygon_info = OasisReader::fromBytesChar(ifs);
+                OASIS_TRACE(TRACE_DETAIL, "Polygon Info " << std::bitset<8>((int)polygon_info).to_string() << std::endl);
+                bool P = polygon_info & 32;
+                bool X = polygon_info & 16;
+                bool Y = polygon_info & 8;
+                bool R = polygon_info & 4;
+                bool D = polygon_info & 2;
+                bool L = polygon_info & 1;
+
+                unsigned int& layernum = modal.layer;
+                unsigned int& datatype = modal.datatype;
+                coord_type& x = modal.x;
+                coord_type& y = modal.y;
+                oasisio::PointList& pointList = modal.polygon;
+                unsigned int fields[2];
+                const unsigned int* field = fields;
+                OasisReader::fromBytesUnsigned(ifs, fields, L + D);
+                if(L) {
+                    layernum = *field++;
+                    OASIS_TRACE(TRACE_DETAIL, "Layer Num " << layernum << std::endl);
+                }
+                if(D) {
+                    datatype = *field++;
+                    OASIS_TRACE(TRACE_DETAIL, "Datatype " << datatype << std::endl);
+                }
+                if(P) {
+                    pointList.clear();
+                    OasisReader::fromBytesPointList(ifs, pointList);
+                    OASIS_TRACE(TRACE_DETAIL, "Read Point List " << pointList << std::endl);
+                }
+                field = fields;
+                OasisReader::fromBytesUnsigned(ifs, fields, X + Y);
+                if(X) {
+                    x = modalXY(modal, x, varint::toSigned(*field++));
+                    OASIS_TRACE(TRACE_DETAIL, "X " << x << std::endl);
+                }
+                if(Y) {
+                    y = modalXY(modal, y, varint::toSigned(*field++));
+                    OASIS_TRACE(TRACE_DETAIL, "Y " << y << std::endl);
+                }
+                if(R) {
+                    readRepetition(ifs, modal.repetition);
+                }
+
+                layout::Layer<pointT>* layer = layerFor(cell, table, layernum, datatype);
+
+                std::vector<pointT> points;
+                pointT first;
+                bg::set<0>(first, x);
+                bg::set<1>(first, y);
+                points.emplace_back(first);
+                fillPointVector(points, pointList);
+
+                if(R) {
+                    owner.shape = layer->template newShape<layout::RepeatedShape<pointT> >(new layout::Polygon<pointT>(points), modal.repetition);
+                } else {
+                    owner.shape = layer->template newShape<layout::Polygon<pointT> >(points);
+                }
+                owner.cell = false;
+                owner.layer = layer;
+                OASIS_COUNT(ShapesRead, 1);
+
+                break;
+            }
+            case 27:
+            {
+                unsigned char circle_info = OasisReader::fromBytesChar(ifs);
+                OASIS_TRACE(TRACE_DETAIL, "Circle Info " << std::bitset<8>((int)circle_info).to_string() << std::endl);
+                bool r = circle_info & 32;
+                bool X = circle_info & 16;
+                bool Y = circle_info & 8;
+                bool R = circle_info & 4;
+                bool D = circle_info & 2;
+                bool L = circle_info & 1;
+
+                unsigned int& radius = modal.radius;
+                unsigned int& layernum = modal.layer;
+                unsigned int& datatype = modal.datatype;
+                coord_type& x = modal.x;
+                coord_type& y = modal.y;
+
                 if(L) {
                     layernum = OasisReader::fromBytesUnsigned(ifs);
-                    std::cout << "Layer Num " << layernum << std::endl;
+                    OASIS_TRACE(TRACE_DETAIL, "Layer Num " << layernum << std::endl);
                 }
                 if(D) {
                     datatype = OasisReader::fromBytesUnsigned(ifs);
-                    std::cout << "Datatype " << datatype << std::endl;
+                    OASIS_TRACE(TRACE_DETAIL, "Datatype " << datatype << std::endl);
                 }
                 if(r) {
                     radius = OasisReader::fromBytesUnsigned(ifs);
-                    std::cout << "Radius " << radius << std::endl;
+                    OASIS_TRACE(TRACE_DETAIL, "Radius " << radius << std::endl);
                 }
                 if(X) {
-                    x = OasisReader::fromBytesSigned(ifs);
-                    std::cout << "X " << x << std::endl;
+                    x = modalXY(modal, x, OasisReader::fromBytesSigned(ifs));
+                    OASIS_TRACE(TRACE_DETAIL, "X " << x << std::endl);
                 }
                 if(Y) {
-                    y = OasisReader::fromBytesSigned(ifs);
-                    std::cout << "Y " << y << std::endl;
+                    y = modalXY(modal, y, OasisReader::fromBytesSigned(ifs));
+                    OASIS_TRACE(TRACE_DETAIL, "Y " << y << std::endl);
                 }
-
-                layout::Layer<pointT>* layer = cell->getLayer(layernum, datatype);
-                if(layer == nullptr) {
-                    switch(layernum) {
-                    case 2:
-                        layer = cell->newLayer(layernum, datatype, QColor("green"));
-                        break;
-                    case 3:
-                        layer = cell->newLayer(layernum, datatype, QColor("yellow"));
-                        break;
-                    case 1:
-                    default:
-                        layer = cell->newLayer(layernum, datatype, QColor("red"));
-                        break;
-                    }
-                    typename std::map<std::tuple<unsigned int, unsigned int, unsigned int, unsigned int>, std::string>::const_iterator it = table.getLayernames().begin();
-                    for(; it != table.getLayernames().end(); ++it) {
-                        if(layernum >= std::get<0>(it->first) && layernum <= std::get<1>(it->first) &&
-                            datatype >= std::get<2>(it->first) && datatype <= std::get<3>(it->first)) {
-                            layer->setName(it->second);
-                            break;
-                        }
-                    }
+                if(R) {
+                    readRepetition(ifs, modal.repetition);
                 }
 
+                layout::Layer<pointT>* layer = layerFor(cell, table, layernum, datatype);
+
                 pointT center;
                 bg::set<0>(center, x);
                 bg::set<1>(center, y);
-                layer->addShape(new layout::Circle<pointT>(center, radius));
+                if(R) {
+                    owner.shape = layer->template newShape<layout::RepeatedShape<pointT> >(new layout::Circle<pointT>(center, radius), modal.repetition);
+                } else {
+                    owner.shape = layer->template newShape<layout::Circle<pointT> >(center, radius);
+                }
+                owner.cell = false;
+                owner.layer = layer;
+                OASIS_COUNT(ShapesRead, 1);
+
+                break;
+            }
+            case 22:
+            {
+                unsigned char path_info = OasisReader::fromBytesChar(ifs);
+                OASIS_TRACE(TRACE_DETAIL, "Path Info " << std::bitset<8>((int)path_info).to_string() << std::endl);
+                bool X = path_info & 16;
+                bool Y = path_info & 8;
+                bool R = path_info & 4;
+                bool D = path_info & 2;
+                bool L = path_info & 1;
+
+                unsigned int& layernum = modal.layer;
+                unsigned int& datatype = modal.datatype;
+                coord_type& x = modal.x;
+                coord_type& y = modal.y;
+                unsigned int fields[2];
+                const unsigned int* field = fields;
+                OasisReader::fromBytesUnsigned(ifs, fields, L + D);
+                if(L) {
+                    layernum = *field++;
+                    OASIS_TRACE(TRACE_DETAIL, "Layer Num " << layernum << std::endl);
+                }
+                if(D) {
+                    datatype = *field++;
+                    OASIS_TRACE(TRACE_DETAIL, "Datatype " << datatype << std::endl);
+                }
+                readPathFields(ifs, path_info, modal);
+                field = fields;
+                OasisReader::fromBytesUnsigned(ifs, fields, X + Y);
+                if(X) {
+                    x = modalXY(modal, x, varint::toSigned(*field++));
+                    OASIS_TRACE(TRACE_DETAIL, "X " << x << std::endl);
+                }
+                if(Y) {
+                    y = modalXY(modal, y, varint::toSigned(*field++));
+                    OASIS_TRACE(TRACE_DETAIL, "Y " << y << std::endl);
+                }
+                if(R) {
+                    readRepetition(ifs, modal.repetition);
+                }
+
+                layout::Layer<pointT>* layer = layerFor(cell, table, layernum, datatype);
+
+                std::vector<pointT> points(1, pointT(x, y));
+                fillPointVector(points, modal.path, false);
+
+                if(R) {
+                    owner.shape = layer->template newShape<layout::RepeatedShape<pointT> >(
+                        new layout::Path<pointT>(points, modal.halfWidth, modal.startExtension, modal.endExtension),
+                        modal.repetition);
+                } else {
+                    owner.shape = layer->template newShape<layout::Path<pointT> >(points, modal.halfWidth, modal.startExtension,
+                                                                                   modal.endExtension);
+                }
+                owner.cell = false;
+                owner.layer = layer;
+                OASIS_COUNT(ShapesRead, 1);
+
+                break;
+            }
+            case 23:
+            case 24:
+            case 25:
+            case 26:
+            {
+                unsigned char trapezoid_info = OasisReader::fromBytesChar(ifs);
+                OASIS_TRACE(TRACE_DETAIL, "Trapezoid Info " << std::bitset<8>((int)trapezoid_info).to_string() << std::endl);
+                bool ctrapezoid = recordID == 26;
+                bool O = !ctrapezoid && (trapezoid_info & 128);
+                bool T = ctrapezoid && (trapezoid_info & 128);
+                bool W = trapezoid_info & 64;
+                bool H = trapezoid_info & 32;
+                bool X = trapezoid_info & 16;
+                bool Y = trapezoid_info & 8;
+                bool R = trapezoid_info & 4;
+                bool D = trapezoid_info & 2;
+                bool L = trapezoid_info & 1;
+                unsigned int& layernum = modal.layer;
+                unsigned int& datatype = modal.datatype;
+                unsigned int& type = modal.ctrapezoidType;
+                unsigned int& width = modal.width;
+                unsigned int& height = modal.height;
+                coord_type& x = modal.x;
+                coord_type& y = modal.y;
+                unsigned int fields[5];
+                const unsigned int* field = fields;
+                OasisReader::fromBytesUnsigned(ifs, fields, L + D + T + W + H);
+                if(L) {
+                    layernum = *field++;
+                    OASIS_TRACE(TRACE_DETAIL, "Layer Num " << layernum << std::endl);
+                }
+                if(D) {
+                    datatype = *field++;
+                    OASIS_TRACE(TRACE_DETAIL, "Datatype " << datatype << std::endl);
+                }
+                if(T) {
+                    type = *field++;
+                    OASIS_TRACE(TRACE_DETAIL, "CTrapezoid Type " << type << std::endl);
+                }
+                if(W) {
+                    width = *field++;
+                    OASIS_TRACE(TRACE_DETAIL, "Width " << width << std::endl);
+                }
+                if(H) {
+                    height = *field++;
+                    OASIS_TRACE(TRACE_DETAIL, "Height " << height << std::endl);
+                }
+                bool vertical = O;
+                coord_type a = 0;
+                coord_type b = 0;
+                if(ctrapezoid) {
+                    if(type > 25) {
+                        throw std::exception("Invalid CTRAPEZOID type.");
+                    }
+                    ctrapezoidSize(type, width, height);
+                    if(type < 24) {
+                        const CTrapezoid& t = ctrapezoidDeltas(type);
+                        coord_type side = t.vertical ? width : height;
+                        vertical = t.vertical;
+                        a = t.a * side;
+                        b = t.b * side;
+                    }
+                } else {
+                    if(recordID != 25) {
+                        a = OasisReader::fromBytesSigned(ifs);
+                    }
+                    if(recordID != 24) {
+                        b = OasisReader::fromBytesSigned(ifs);
+                    }
+                    OASIS_TRACE(TRACE_DETAIL, "Deltas " << a << " " << b << std::endl);
+                }
+                field = fields;
+                OasisReader::fromBytesUnsigned(ifs, fields, X + Y);
+                if(X) {
+                    x = modalXY(modal, x, varint::toSigned(*field++));
+                    OASIS_TRACE(TRACE_DETAIL, "X " << x << std::endl);
+                }
+                if(Y) {
+                    y = modalXY(modal, y, varint::toSigned(*field++));
+                    OASIS_TRACE(TRACE_DETAIL, "Y " << y << std::endl);
+                }
+                if(R) {
+                    readRepetition(ifs, modal.repetition);
+                }
+
+                layout::Layer<pointT>* layer = layerFor(cell, table, layernum, datatype);
+
+                // without deltas it is a rectangle, kept like one.
+                layout::Box<pointT> box(x, y, x+width, y+height);
+                if(a == 0 && b == 0) {
+                    if(R) {
+                        owner.shape = layer->template newShape<layout::RepeatedShape<pointT> >(new layout::Box<pointT>(box), modal.repetition);
+                    } else {
+                        owner.shape = nullptr;
+                        owner.rect = layer->addRect(x, y, x+width, y+height);
+                    }
+                } else if(R) {
+                    owner.shape = layer->template newShape<layout::RepeatedShape<pointT> >(
+                        new layout::Trapezoid<pointT>(box, a, b, vertical), modal.repetition);
+                } else {
+                    owner.shape = layer->template newShape<layout::Trapezoid<pointT> >(box, a, b, vertical);
+                }
+                owner.cell = false;
+                owner.layer = layer;
+                OASIS_COUNT(ShapesRead, 1);
 
                 break;
             }
-            case 15:
+            case 19:
+            {
+                unsigned char text_info = OasisReader::fromBytesChar(ifs);
+                OASIS_TRACE(TRACE_DETAIL, "Text Info " << std::bitset<8>((int)text_info).to_string() << std::endl);
+                bool C = text_info & 64;
+                bool N = text_info & 32;
+                bool X = text_info & 16;
+                bool Y = text_info & 8;
+                bool R = text_info & 4;
+                bool T = text_info & 2;
+                bool L = text_info & 1;
+
+                unsigned int& layernum = modal.textlayer;
+                unsigned int& datatype = modal.texttype;
+                coord_type& x = modal.textX;
+                coord_type& y = modal.textY;
+                if(C) {
+                    if(N) {
+                        modal.textString = table.getTextstring(OasisReader::fromBytesUnsigned(ifs));
+                    } else {
+                        modal.textString = table.internText(OasisReader::fromBytesStringView(ifs));
+                    }
+                    OASIS_TRACE(TRACE_DETAIL, "Text String " << modal.textString << std::endl);
+                }
+                unsigned int fields[4];
+                const unsigned int* field = fields;
+                OasisReader::fromBytesUnsigned(ifs, fields, L + T + X + Y);
+                if(L) {
+                    layernum = *field++;
+                    OASIS_TRACE(TRACE_DETAIL, "Text Layer " << layernum << std::endl);
+                }
+                if(T) {
+                    datatype = *field++;
+                    OASIS_TRACE(TRACE_DETAIL, "Text Type " << datatype << std::endl);
+                }
+                if(X) {
+                    x = modalXY(modal, x, varint::toSigned(*field++));
+                    OASIS_TRACE(TRACE_DETAIL, "X " << x << std::endl);
+                }
+                if(Y) {
+                    y = modalXY(modal, y, varint::toSigned(*field++));
+                    OASIS_TRACE(TRACE_DETAIL, "Y " << y << std::endl);
+                }
+                if(R) {
+                    readRepetition(ifs, modal.repetition);
+                }
+
+                if(textLayer == nullptr || L || T) {
+                    textLayer = layerFor(cell, table, layernum, datatype);
+                }
+                layout::Layer<pointT>* layer = textLayer;
+
+                // labels are small: every copy of a repeated one is kept on its own.
+                if(R) {
+                    modal.repetition.forEach([&](coord_type dx, coord_type dy) {
+                        layer->addText(x + dx, y + dy, modal.textString);
+                    });
+                } else {
+                    layer->addText(x, y, modal.textString);
+                }
+                owner.cell = false;
+                owner.layer = nullptr;
+
+                break;
+            }
+            case 17:
+            case 18:
+            {
+                readPlacement(ifs, recordID, modal);
+                if(placements) {
+                    placements->push_back(modal.placement);
+                }
+                owner.cell = false;
+                owner.layer = nullptr;
+                break;
+            }
+            case 28:
+            case 29:
+            {
+                table.readProperty(ifs, recordID, modal.property);
+                if(owner.layer) {
+                    if(owner.shape == nullptr) {
+                        // rectangles in the arrays carry no properties: this one becomes a shape.
+                        layout::Box<pointT> box = owner.layer->getRects().getBox(owner.rect);
+                        owner.layer->deleteRect(owner.rect);
+                        owner.shape = owner.layer->template newShape<layout::Box<pointT> >(box);
+                    }
+                    owner.layer->addProperty(owner.shape, modal.property);
+                } else if(owner.cell) {
+                    cell->getProperties().push_back(modal.property);
+                }
+                break;
+            }
+            case 34:
+            {
+                OasisReader::fromBytesCblock(ifs);
+                break;
+            }
+            case 15: //XYABSOLUTE
+                modal.relative = false;
+                break;
+            case 16: //XYRELATIVE
+                modal.relative = true;
                 break;
             case 13:
             case 2:
             default:
-                ifs.seekg(-1, ifs.cur);
+                ifs.unget();
                 return;
             }
 
@@ -1002,13 +3919,13 @@ protected:
         num += intNumBytes(table.getXnameFlag());
         num += intNumBytes(table.getXnameOffset());
 
-        std::cout << "Table Num Bytes " << num << std::endl;
+        OASIS_TRACE(TRACE_SUMMARY, "Table Num Bytes " << num << std::endl);
 
         return num;
 
     }
 
-    int intNumBytes(unsigned int i) {
+    int intNumBytes(std::uint64_t i) {
 
         //std::cout << i << " ";
 
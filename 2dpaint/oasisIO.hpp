@@ -7,10 +7,18 @@
 #include <fstream>
 #include <vector>
 #include <iomanip>
+#include <memory>
+#include <deque>
+#include <string_view>
+#include <unordered_set>
 
-namespace oasisio {
+#include <zlib.h>
+
+#include "byteStream.hpp"
+#include "trace.hpp"
+#include "varint.hpp"
 
-using byte = unsigned char;
+namespace oasisio {
 
 
 namespace {
@@ -65,6 +73,11 @@ public:
         return deltaY;
     }
 
+    /// the same displacement, however it is encoded.
+    bool operator==(const Delta& d) const {
+        return deltaX == d.deltaX && deltaY == d.deltaY;
+    }
+
 };
 
 #define POINT_LIST_0 0
@@ -92,72 +105,170 @@ public:
         type = t;
     }
 
-    std::vector<Delta> getList() const {
+    const std::vector<Delta>& getList() const {
         return list;
     }
 
+    void clear() {
+        list.clear();
+    }
+
     void addDelta(Delta& delta) {
         list.push_back(delta);
     }
 
+    void reserve(std::size_t n) {
+        list.reserve(n);
+    }
+
     void addDelta(int t, int dx, int dy=0) {
         Delta next(t, dx, dy);
         list.push_back(next);
     }
+
+    bool operator==(const PointList& pl) const {
+        return type == pl.type && list == pl.list;
+    }
 };
 
 std::ostream& operator<<(std::ostream& o, const PointList& pl);
 
+/// Names and strings of one file, each stored once.
+/// Views into a resident source are kept as they are; anything else is
+/// copied into the pool. Views handed out stay valid for the pool's life,
+/// also across moves.
+class StringPool {
+protected:
+    std::unordered_set<std::string_view> views;
+    std::deque<std::string> storage;
+
+public:
+    StringPool() = default;
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+    StringPool(StringPool&&) = default;
+    StringPool& operator=(StringPool&&) = default;
+
+    std::string_view intern(std::string_view s, bool resident = false) {
+        std::unordered_set<std::string_view>::const_iterator it = views.find(s);
+        if(it != views.end()) {
+            return *it;
+        }
+        if(!resident) {
+            storage.emplace_back(s);
+            s = storage.back();
+        }
+        views.insert(s);
+        return s;
+    }
+
+    std::size_t size() const {
+        return views.size();
+    }
+    /// strings that had to be copied.
+    std::size_t getCopiedCount() const {
+        return storage.size();
+    }
+};
+
 class OasisWriter {
 
 protected:
-    unsigned int pos = 1;
-    std::ofstream* f;
+    std::unique_ptr<ByteSink> ownedSink;
+    ByteSink* f;
+    /// output buffer of toBytesCblock, kept between blocks.
+    std::vector<byte> compressed;
 
 public:
+    /// encode into a block buffer in front of ofs. call flush() before closing ofs.
     OasisWriter(std::ofstream* ofs)
-        : f(ofs)
+        : ownedSink(new StreamByteSink(*ofs))
+        , f(ownedSink.get())
     {
     }
 
-    unsigned int getPos() {
-        return pos;
+    OasisWriter(ByteSink& sink)
+        : f(&sink)
+    {
+    }
+
+    /// file offset of the next byte written.
+    std::uint64_t getPos() {
+        return f->tell();
+    }
+
+    void flush() {
+        f->flush();
     }
 
-    void increasePos(unsigned int i) {
-        pos += i;
+    /// sign every byte written from now on under an OASIS validation scheme.
+    void setValidation(unsigned int scheme) {
+        f->setValidation(scheme);
+    }
+    std::uint32_t getSignature() {
+        return f->getSignature();
+    }
+
+    void toBytesRaw(const char* data, std::size_t len) {
+        f->write(data, len);
     }
 
     void toBytesChar(char c) {
-        char out[1] = {c};
-        f->write(out, 1);
-        ++pos;
+        f->put(c);
+    }
+
+    /// a CBLOCK record holding data, raw DEFLATE at level (1 fastest, 9 smallest).
+    /// data must be whole records.
+    void toBytesCblock(const byte* data, std::size_t len, int level) {
+
+        z_stream zs;
+        std::memset(&zs, 0, sizeof(zs));
+        if(deflateInit2(&zs, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::exception("Failed to start deflate.");
+        }
+        compressed.resize(deflateBound(&zs, (uLong)len));
+        zs.next_in = const_cast<byte*>(data);
+        zs.avail_in = (uInt)len;
+        zs.next_out = compressed.data();
+        zs.avail_out = (uInt)compressed.size();
+        int ret = deflate(&zs, Z_FINISH);
+        deflateEnd(&zs);
+        if(ret != Z_STREAM_END) {
+            throw std::exception("Failed to compress CBLOCK.");
+        }
+
+        //Record ID
+        toBytesUnsigned(34);
+        //comp-type, DEFLATE
+        toBytesUnsigned(0);
+        toBytesUnsigned((unsigned int)len);
+        toBytesUnsigned((unsigned int)zs.total_out);
+        toBytesRaw((const char *)compressed.data(), zs.total_out);
     }
 
-    void toBytesReal(int type, float flo) {
+    /// whole and reciprocal types take the magnitude, up to 64 bits.
+    void toBytesReal(int type, double d) {
 
         if(type < 0 || type > 7) {
             return;
         }
 
-        char format[1] = {(char)type};
-        f->write(format, 1);
-        ++pos;
+        f->put((byte)type);
 
         switch(type){
         case POSITIVE_WHOLE:
         case NEGATIVE_WHOLE:
-            toBytesUnsigned((unsigned int)flo);
+            toBytesUnsigned64((std::uint64_t)d);
             break;
         case POSITIVE_RECIPROCAL:
         case NEGATIVE_RECIPROCAL:
-            toBytesUnsigned((unsigned int)flo);
+            toBytesUnsigned64((std::uint64_t)d);
             break;
         case SINGLE_PRECISION_FLOAT:
-            toBytesFloat(flo, true);
+            toBytesFloat(d, true);
             break;
         case DOUBLE_PRECISION_FLOAT:
-            toBytesFloat(flo, false);
+            toBytesFloat(d, false);
             break;
         default:
             throw std::exception("Type does not match input.");
@@ -171,9 +282,7 @@ public:
             return;
         }
 
-        char format[1] = {(char)type};
-        f->write(format, 1);
-        ++pos;
+        f->put((byte)type);
 
         switch(type){
         case POSITIVE_RATIO:
@@ -189,27 +298,33 @@ public:
 
     void toBytesUnsigned(unsigned int u_int) {
 
-        byte out[1] = {0};
+        // at most 5 bytes for 32 bits; encode straight into the sink window.
+        byte* out = f->ensure(5);
         byte mask = 127;
+        int len = 0;
 
-        if(u_int == 0) {
-            f->write((char *)out, 1);
-            ++pos;
-            //std::cout << std::bitset<8>((int)out[0]).to_string() << std::endl;
-            return;
+        while(u_int > mask) {
+            out[len++] = (u_int & mask) | 128;
+            u_int = u_int >> 7;
         }
+        out[len++] = u_int;
+        //std::cout << std::bitset<8>((int)out[len-1]).to_string() << std::endl;
 
-        while(u_int > 0) {
-            out[0] = (u_int & mask) + 128;
-            u_int = u_int >> 7;
-            if(u_int <= 0) {
-                out[0] = out[0] & mask;
-            }
-            f->write((char *)out, 1);
-            ++pos;
-            //std::cout << std::bitset<8>((int)out[0]).to_string() << " ";
+        f->advance(len);
+
+    }
+
+    /// an unsigned integer of up to 64 bits, e.g. a file offset.
+    void toBytesUnsigned64(std::uint64_t u) {
+
+        byte* out = f->ensure(10);
+        int len = 0;
+        while(u > 127) {
+            out[len++] = (byte)((u & 127) | 128);
+            u = u >> 7;
         }
-        //std::cout << std::endl;
+        out[len++] = (byte)u;
+        f->advance(len);
 
     }
 
@@ -226,7 +341,15 @@ public:
 
     }
 
-    void toBytesFloat(float fl, bool singlePrec) {
+    /// a signed integer of up to 64 bits, e.g. a 64-bit coordinate.
+    void toBytesSigned64(std::int64_t s) {
+
+        std::uint64_t magnitude = s < 0 ? 0 - (std::uint64_t)s : (std::uint64_t)s;
+        toBytesUnsigned64((magnitude << 1) | (s < 0 ? 1 : 0));
+
+    }
+
+    void toBytesFloat(double fl, bool singlePrec) {
 
         int size, expoBias, expoPos, expoLen;
         if(singlePrec) {
@@ -253,7 +376,7 @@ public:
         //std::cout << "Decimal : " << decimal << std::endl;
 
         int shift = 0;
-        while(decimal != 0 && whole < (((long long)1) << (expoPos-1))) {
+        while(decimal != 0 && whole < (((long long)1) << expoPos)) {
 
             whole = whole << 1;
             ++shift;
@@ -286,7 +409,6 @@ public:
         */
 
         f->write((char *)out, size);
-        pos += size;
 
     }
 
@@ -334,10 +456,10 @@ public:
         return i;
     }
 
-    void toBytesString(std::string s, int type = BINARY) {
+    void toBytesString(std::string_view s, int type = BINARY) {
 
-        char* data = s.data();
-        char len = (char)s.length();
+        const char* data = s.data();
+        std::size_t len = s.length();
 
         /*
         std::cout << "Input :" << std::endl;
@@ -364,16 +486,13 @@ public:
             break;
         }
 
-        char length[1] = {len};
-
-        f->write(length, 1);
+        toBytesUnsigned((unsigned int)len);
         f->write(data, len);
-        pos += (len+1);
 
     }
 
-    bool printable(char* data, int len, bool space = true) {
-        int i;
+    bool printable(const char* data, std::size_t len, bool space = true) {
+        std::size_t i;
         for(i=0; i<len; ++i) {
             if( (data[i] < 33 || data[i] > 126) && (!space || data[i] != ' ') ) {
                 return false;
@@ -430,7 +549,9 @@ public:
                 delta = abs(d.getDeltaY());
             }
             delta = delta << 3;
-            if( d.getDeltaX() == 0 && d.getDeltaY() >= 0 ) {
+            if( d.getDeltaX() > 0 && d.getDeltaY() == 0 ) {
+                //East, direction 0
+            } else if( d.getDeltaX() == 0 && d.getDeltaY() >= 0 ) {
                 delta += 1;
             } else if( d.getDeltaX() < 0 && d.getDeltaY() == 0 ) {
                 delta += 2;
@@ -458,7 +579,9 @@ public:
                 delta = abs(d.getDeltaY());
             }
             delta = delta << 3;
-            if( d.getDeltaX() == 0 && d.getDeltaY() >= 0 ) {
+            if( d.getDeltaX() > 0 && d.getDeltaY() == 0 ) {
+                //East, direction 0
+            } else if( d.getDeltaX() == 0 && d.getDeltaY() >= 0 ) {
                 delta += 1;
             } else if( d.getDeltaX() < 0 && d.getDeltaY() == 0 ) {
                 delta += 2;
@@ -496,12 +619,13 @@ public:
 
     void toBytesPointList(const PointList& pl) {
 
+        const std::vector<Delta>& deltas = pl.getList();
         toBytesUnsigned(pl.getType());
-        toBytesUnsigned((unsigned int)(pl.getList().size()));
+        toBytesUnsigned((unsigned int)(deltas.size()));
 
-        int i;
-        for(i=0; i<pl.getList().size(); ++i) {
-            toBytesDelta(pl.getList()[i]);
+        std::size_t i;
+        for(i=0; i<deltas.size(); ++i) {
+            toBytesDelta(deltas[i]);
         }
 
     }
@@ -514,54 +638,49 @@ class OasisReader{
 
 public:
 
-    static unsigned char fromBytesChar(std::ifstream& f) {
-        byte bytes[1] = {0};
-        f.read((char *)bytes, 1);
-        return bytes[0];
+    static unsigned char fromBytesChar(ByteSource& f) {
+        return f.get();
     }
 
-    static float fromBytesReal(std::ifstream& f) {
-
-        byte bytes[1] = {0};
-        f.read((char *)bytes, 1);
+    static double fromBytesReal(ByteSource& f) {
 
-        int type = bytes[0];
+        int type = f.get();
 
-        float out = 0;
+        double out = 0;
 
         switch(type) {
 
         case POSITIVE_WHOLE:
         {
-            out = (float)fromBytesUnsigned(f);
+            out = (double)fromBytesUnsigned64(f);
             break;
         }
         case NEGATIVE_WHOLE:
         {
-            out = ((float)fromBytesUnsigned(f)) * -1;
+            out = ((double)fromBytesUnsigned64(f)) * -1;
             break;
         }
         case POSITIVE_RECIPROCAL:
         {
-            out = 1.0f / fromBytesUnsigned(f);
+            out = 1.0 / fromBytesUnsigned64(f);
             break;
         }
         case NEGATIVE_RECIPROCAL:
         {
-            out = -1.0f / fromBytesUnsigned(f);
+            out = -1.0 / fromBytesUnsigned64(f);
             break;
         }
         case POSITIVE_RATIO:
         {
-            float top = (float)fromBytesUnsigned(f);
-            float bot = (float)fromBytesUnsigned(f);
+            double top = (double)fromBytesUnsigned64(f);
+            double bot = (double)fromBytesUnsigned64(f);
             out =  top / bot;
             break;
         }
         case NEGATIVE_RATIO:
         {
-            float top = (float)fromBytesUnsigned(f);
-            float bot = (float)fromBytesUnsigned(f);
+            double top = (double)fromBytesUnsigned64(f);
+            double bot = (double)fromBytesUnsigned64(f);
             out =  -top / bot;
             break;
         }
@@ -583,10 +702,18 @@ public:
         return out;
     }
 
-    static unsigned int fromBytesUnsigned(std::ifstream& f) {
-
-        byte bytes[1] = {0};
+    static unsigned int fromBytesUnsigned(ByteSource& f) {
 
+        // whole integer in the window: no per-byte get().
+        std::size_t avail = f.ensure(5);
+        if(avail > 0) {
+            unsigned int value;
+            std::size_t len = varint::decodeOne(f.data(), f.data() + avail, value);
+            if(len > 0) {
+                f.advance(len);
+                return value;
+            }
+        }
 
         byte mask = 127;
         unsigned int out = 0;
@@ -594,13 +721,12 @@ public:
         unsigned int i = -1;
         while(true) {
             ++i;
-            bytes[0] = {0};
-            f.read((char *)bytes, 1);
-            //std::cout << std::bitset<8>((int)bytes[0]).to_string() << " ";
-            //std::cout << std::setw(2) << std::setfill('0') << std::hex << (int)(bytes[0]) << " ";
-            byte next = bytes[0] & mask;
+            byte in = f.get();
+            //std::cout << std::bitset<8>((int)in).to_string() << " ";
+            //std::cout << std::setw(2) << std::setfill('0') << std::hex << (int)(in) << " ";
+            byte next = in & mask;
             out += (next << (7*i));
-            if((bytes[0] & 128) == 0 || f.eof()) {
+            if((in & 128) == 0 || f.eof()) {
                 break;
             }
         }
@@ -609,7 +735,78 @@ public:
         return out;
     }
 
-    static signed int fromBytesSigned(std::ifstream& f) {
+    /// an unsigned integer of up to 64 bits, e.g. a file offset.
+    static std::uint64_t fromBytesUnsigned64(ByteSource& f) {
+
+        std::uint64_t out = 0;
+        unsigned int shift = 0;
+        while(true) {
+            byte in = f.get();
+            if(shift < 64) {
+                out |= (std::uint64_t)(in & 127) << shift;
+            }
+            shift += 7;
+            if((in & 128) == 0 || f.eof()) {
+                break;
+            }
+        }
+        return out;
+    }
+
+    /// a signed integer of up to 64 bits.
+    static std::int64_t fromBytesSigned64(ByteSource& f) {
+
+        std::uint64_t initial = fromBytesUnsigned64(f);
+        std::uint64_t magnitude = initial >> 1;
+        return (initial & 1) ? (std::int64_t)(0 - magnitude) : (std::int64_t)magnitude;
+    }
+
+    /// decode n consecutive unsigned integers into out, in chunks of the
+    /// source's window. see varint::decodeUnsigned.
+    static void fromBytesUnsigned(ByteSource& f, unsigned int* out, std::size_t n) {
+
+        while(n > 0) {
+            std::size_t chunk = std::min(n, (std::size_t)4096);
+            std::size_t avail = f.ensure(chunk * 5);
+            const byte* p = f.data();
+            std::size_t cnt = varint::decodeUnsigned(p, p + avail, out, chunk);
+            f.advance(p - f.data());
+            out += cnt;
+            n -= cnt;
+            if(cnt < chunk) {
+                // the window ends inside an integer (or the data does).
+                *out++ = fromBytesUnsigned(f);
+                --n;
+            }
+        }
+    }
+
+    static void fromBytesSigned(ByteSource& f, int* out, std::size_t n) {
+
+        fromBytesUnsigned(f, reinterpret_cast<unsigned int*>(out), n);
+        for(std::size_t i=0; i<n; ++i) {
+            out[i] = varint::toSigned((unsigned int)out[i]);
+        }
+    }
+
+    /// move past n integers (signed or unsigned) without decoding them.
+    static void skipUnsigned(ByteSource& f, std::size_t n) {
+
+        while(n > 0) {
+            std::size_t chunk = std::min(n, (std::size_t)4096);
+            std::size_t avail = f.ensure(chunk * 5);
+            const byte* p = f.data();
+            std::size_t cnt = varint::skipUnsigned(p, p + avail, chunk);
+            f.advance(p - f.data());
+            n -= cnt;
+            if(cnt < chunk) {
+                fromBytesUnsigned(f);
+                --n;
+            }
+        }
+    }
+
+    static signed int fromBytesSigned(ByteSource& f) {
 
         unsigned int initial = fromBytesUnsigned(f);
         bool negative = initial & 1;
@@ -651,7 +848,7 @@ public:
 
     }
 
-    static float fromBytesFloat(std::ifstream& f, bool singlePrec) {
+    static double fromBytesFloat(ByteSource& f, bool singlePrec) {
 
         byte bytes[8] = {0};
         if(singlePrec) {
@@ -729,7 +926,7 @@ public:
 
         }
 
-        float out = (float)(whole + decimal_value);
+        double out = whole + decimal_value;
 
         if(bytes[0] >= 128) {
             out = out * -1;
@@ -739,8 +936,8 @@ public:
 
     }
 
-    static bool printable(char* data, int len, bool space = true) {
-        int i;
+    static bool printable(const char* data, std::size_t len, bool space = true) {
+        std::size_t i;
         for(i=0; i<len; ++i) {
             if( (data[i] < 33 || data[i] > 126) && (!space || data[i] != ' ') ) {
                 return false;
@@ -749,61 +946,124 @@ public:
         return true;
     }
 
-    static std::string fromBytesString(std::ifstream& f, int type = BINARY) {
-
-        char len[1];
-        f.read(len, 1);
-        unsigned char length = len[0];
-
-        char* data = new char[length+1];
-        f.read(data, length);
-        data[length] = '\0';
-
-        /*
-        std::cout << "Output :" << std::endl;
+    /// a string (unsigned length, then the bytes) as a view into the source.
+    /// the view lives as long as the source for resident sources, otherwise
+    /// only until the next read: intern it to keep it.
+    static std::string_view fromBytesStringView(ByteSource& f, int type = BINARY) {
 
-        int i;
-        for(i=0; i<len[0]+1; ++i) {
-            std::cout << data[i] << "\t" << std::bitset<8>((int)data[i]).to_string() << std::endl;
+        unsigned int length = fromBytesUnsigned(f);
+        if((!f.inBlock() && length > f.size() - f.tell()) || f.ensure(length) < length) {
+            throw std::exception("Truncated string.");
         }
-        */
+        const char* data = (const char *)f.data();
+        f.advance(length);
 
         switch(type) {
         case ASCII:
-            if(!printable(data, len[0])) {
+            if(!printable(data, length)) {
                 throw std::exception("Invalid characters.");
             }
             break;
         case NAME:
-            if(len[0] == 0) {
+            if(length == 0) {
                 throw std::exception("Empty name.");
             }
-            if(!printable(data, len[0], false)) {
+            if(!printable(data, length, false)) {
                 throw std::exception("Invalid characters.");
             }
             break;
         }
 
-        std::string out(data);
-        delete[] data;
-        return out;
+        return std::string_view(data, length);
+
+    }
+
+    static std::string fromBytesString(ByteSource& f, int type = BINARY) {
+        return std::string(fromBytesStringView(f, type));
+    }
+
+    /// the rest of a CBLOCK record. its contents are inflated straight from
+    /// the source's window and then read ahead of the rest of f.
+    static void fromBytesCblock(ByteSource& f) {
+
+        unsigned int compType = fromBytesUnsigned(f);
+        unsigned int uncompCount = fromBytesUnsigned(f);
+        unsigned int compCount = fromBytesUnsigned(f);
+        if(compType != 0) {
+            throw std::exception("Unsupported CBLOCK compression.");
+        }
+        OASIS_TRACE(TRACE_RECORD, "CBLOCK " << compCount << " -> " << uncompCount << " bytes" << std::endl);
+
+        std::vector<byte> data(uncompCount);
+        z_stream zs;
+        std::memset(&zs, 0, sizeof(zs));
+        // raw DEFLATE, no zlib header
+        if(inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
+            throw std::exception("Failed to start inflate.");
+        }
+        zs.next_out = data.data();
+        zs.avail_out = uncompCount;
+        std::size_t left = compCount;
+        int ret = Z_OK;
+        while(left > 0 && ret == Z_OK) {
+            std::size_t avail = std::min(left, f.ensure(1));
+            if(avail == 0) {
+                break;
+            }
+            avail = std::min(avail, (std::size_t)1 << 30);
+            zs.next_in = const_cast<byte*>(f.data());
+            zs.avail_in = (uInt)avail;
+            ret = inflate(&zs, Z_NO_FLUSH);
+            std::size_t used = avail - zs.avail_in;
+            f.advance(used);
+            left -= used;
+        }
+        inflateEnd(&zs);
+        if(ret != Z_STREAM_END || zs.total_out != uncompCount) {
+            throw std::exception("Corrupt CBLOCK.");
+        }
+        f.skip(left);
+
+        f.pushBlock(data);
+    }
 
+    /// the rest of a CBLOCK record, without inflating it.
+    static void skipCblock(ByteSource& f) {
+        fromBytesUnsigned(f);
+        fromBytesUnsigned(f);
+        unsigned int compCount = fromBytesUnsigned(f);
+        f.skip(compCount);
     }
 
-    static Delta fromBytesDelta(std::ifstream& f, int type) {
+    static void skipString(ByteSource& f) {
+        unsigned int length = fromBytesUnsigned(f);
+        f.skip(length);
+    }
+
+    /// skip a layer or datatype interval of any type.
+    static void skipInterval(ByteSource& f) {
+        unsigned int type = fromBytesUnsigned(f);
+        if(type >= 1 && type <= 3) {
+            fromBytesUnsigned(f);
+        } else if(type == 4) {
+            fromBytesUnsigned(f);
+            fromBytesUnsigned(f);
+        }
+    }
+
+    /// a 1-, 2- or 3-delta from its already decoded integer.
+    static Delta toDelta(unsigned int data, int type) {
 
         switch(type) {
         case DELTA_1:
         {
-            int data = fromBytesSigned(f);
-            Delta out(type, data);
+            Delta out(type, varint::toSigned(data));
             return out;
         }
 
         case DELTA_2:
         {
 
-            unsigned int data = fromBytesUnsigned(f);
             char dir = data & 3;
             data = data >> 2;
 
@@ -842,7 +1102,6 @@ public:
         case DELTA_3:
         {
 
-            unsigned int data = fromBytesUnsigned(f);
             char dir = data & 7;
             data = data >> 3;
 
@@ -900,6 +1159,20 @@ public:
             }
         }
 
+        default:
+            throw std::exception("Invalid type.");
+        }
+
+    }
+
+    static Delta fromBytesDelta(ByteSource& f, int type) {
+
+        switch(type) {
+        case DELTA_1:
+        case DELTA_2:
+        case DELTA_3:
+            return toDelta(fromBytesUnsigned(f), type);
+
         case DELTA_G:
         case DELTA_G1:
         case DELTA_G2:
@@ -992,12 +1265,28 @@ public:
 
     }
 
-    static void fromBytesPointList(std::ifstream& f, PointList& pl) {
+    static void skipPointList(ByteSource& f) {
+
+        unsigned int type = fromBytesUnsigned(f);
+        unsigned int length = fromBytesUnsigned(f);
+        if(type <= 3) {
+            skipUnsigned(f, length);
+        } else {
+            // a g-delta is one integer, or two when bit 0 of the first is set.
+            for(unsigned i=0; i<length; ++i) {
+                if(fromBytesUnsigned(f) & 1) {
+                    skipUnsigned(f, 1);
+                }
+            }
+        }
+    }
+
+    static void fromBytesPointList(ByteSource& f, PointList& pl) {
 
         unsigned int type = fromBytesUnsigned(f);
         unsigned int length = fromBytesUnsigned(f);
 
-        std::cout << "Type " << type << " Length " << length << std::endl;
+        OASIS_TRACE(TRACE_DETAIL, "Type " << type << " Length " << length << std::endl);
 
         int delta;
         switch(type) {
@@ -1019,14 +1308,35 @@ public:
             throw std::exception("Invalid type.");
         }
 
+        // every delta takes at least a byte: a longer count is a corrupt file.
+        if(!f.inBlock() && length > f.size() - f.tell()) {
+            throw std::exception("Truncated point list.");
+        }
         pl.setType(type);
-
-        for(unsigned i=0; i<length; ++i) {
-            Delta next = fromBytesDelta(f, delta);
-            std::cout << "(" << next.getDeltaX() << ", " << next.getDeltaY() << ") ";
-            pl.addDelta(next);
+        pl.reserve(std::min(length, 4096u));
+
+        if(delta == DELTA_G) {
+            // g-deltas take one or two integers each, so they are decoded one by one.
+            for(unsigned i=0; i<length; ++i) {
+                Delta next = fromBytesDelta(f, delta);
+                OASIS_TRACE(TRACE_DETAIL, "(" << next.getDeltaX() << ", " << next.getDeltaY() << ") ");
+                pl.addDelta(next);
+            }
+        } else {
+            // decoded in bulk a chunk at a time, without a heap buffer per list.
+            unsigned int data[1024];
+            while(length > 0) {
+                unsigned int chunk = std::min(length, 1024u);
+                fromBytesUnsigned(f, data, chunk);
+                for(unsigned i=0; i<chunk; ++i) {
+                    Delta next = toDelta(data[i], delta);
+                    OASIS_TRACE(TRACE_DETAIL, "(" << next.getDeltaX() << ", " << next.getDeltaY() << ") ");
+                    pl.addDelta(next);
+                }
+                length -= chunk;
+            }
         }
-        std::cout << std::endl;
+        OASIS_TRACE(TRACE_DETAIL, std::endl);
 
     }
 
@@ -0,0 +1,203 @@
+#ifndef __LAYOUT_PATH_HPP__
+#define __LAYOUT_PATH_HPP__
+
+
+#include "box.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+
+namespace layout {
+
+/// A wire: its centerline, half its width and how far it reaches past the
+/// first and last point, as in an OASIS PATH record. The outline is never
+/// stored; it is stroked when vertices are asked for, one quad per segment.
+/// Each quad is lengthened at a join so that neighbours meet in a miter;
+/// joins sharper than a right angle are cut square at half the width.
+template<typename pointT>
+class Path : public iShape<pointT> {
+public:
+    typedef typename pointT::coord_type coord_type;
+
+protected:
+    std::vector<pointT> points;
+    coord_type halfWidth;
+    /// signed, along the first and the last segment. negative shortens the path.
+    coord_type startExtension;
+    coord_type endExtension;
+    Box<pointT> bbox{std::numeric_limits<coord_type>::min(),
+                     std::numeric_limits<coord_type>::min(),
+                     std::numeric_limits<coord_type>::min(),
+                     std::numeric_limits<coord_type>::min()};
+
+public:
+    Path(const std::vector<pointT>& pts, coord_type hw, coord_type start = 0, coord_type end = 0)
+        : points(pts)
+        , halfWidth(hw)
+        , startExtension(start)
+        , endExtension(end) {
+        computeBBox();
+    }
+
+    virtual ~Path() {}
+
+    void print(std::string prefix) {
+
+        std::cout << prefix << "Path " << halfWidth << " " << startExtension << " " << endExtension << std::endl;
+        std::cout << prefix;
+        typename std::vector<pointT>::const_iterator it = points.begin();
+        for (; it != points.end(); ++it) {
+            std::cout << "(" << bg::get<0>(*it) << ", " << bg::get<1>(*it) << ") ";
+        }
+        std::cout << std::endl;
+
+    }
+
+    const std::vector<pointT>& getPoints() const {
+        return points;
+    }
+    coord_type getHalfWidth() const {
+        return halfWidth;
+    }
+    coord_type getStartExtension() const {
+        return startExtension;
+    }
+    coord_type getEndExtension() const {
+        return endExtension;
+    }
+
+    /// call f(x, y) with the 4 corners of each segment's quad, counter-clockwise.
+    /// a path of one point, or of points all in one place, is a single quad
+    /// along x.
+    template<typename F>
+    void forEachQuad(F f) const {
+        if (points.empty())
+            return;
+        double hw = (double)halfWidth;
+        double x[4], y[4];
+        std::size_t i = 0, j = 0;
+        double ux = 1.0, uy = 0.0;
+        if (!segment(i, j, ux, uy)) {
+            double ax = (double)bg::get<0>(points[0]), ay = (double)bg::get<1>(points[0]);
+            quad(ax - (double)startExtension, ay, ax + (double)endExtension, ay, 0.0, hw, x, y);
+            f(x, y);
+            return;
+        }
+        double back = (double)startExtension;
+        while (true) {
+            std::size_t next = j, k = j;
+            double vx = 0.0, vy = 0.0;
+            bool more = segment(next, k, vx, vy);
+            // both segments reach the same distance into a join.
+            double ahead = more ? hw * miter(ux, uy, vx, vy) : (double)endExtension;
+            double ax = (double)bg::get<0>(points[i]), ay = (double)bg::get<1>(points[i]);
+            double bx = (double)bg::get<0>(points[j]), by = (double)bg::get<1>(points[j]);
+            quad(ax - ux * back, ay - uy * back, bx + ux * ahead, by + uy * ahead, -uy * hw, ux * hw, x, y);
+            f(x, y);
+            if (!more)
+                break;
+            back = ahead;
+            i = next;
+            j = k;
+            ux = vx;
+            uy = vy;
+        }
+    }
+
+    const Box<pointT>& computeBBox() {
+        double minX = 0.0, minY = 0.0, maxX = 0.0, maxY = 0.0;
+        bool any = false;
+        forEachQuad([&](const double* x, const double* y) {
+            for (int k = 0; k < 4; ++k) {
+                if (!any || x[k] < minX) minX = x[k];
+                if (!any || y[k] < minY) minY = y[k];
+                if (!any || x[k] > maxX) maxX = x[k];
+                if (!any || y[k] > maxY) maxY = y[k];
+                any = true;
+            }
+        });
+        if (!any) {
+            bbox.makeInvalid();
+            return bbox;
+        }
+        if (std::is_integral<coord_type>::value) {
+            // slanted quads have corners between grid points.
+            minX = std::floor(minX + 1e-9);
+            minY = std::floor(minY + 1e-9);
+            maxX = std::ceil(maxX - 1e-9);
+            maxY = std::ceil(maxY - 1e-9);
+        }
+        bbox = Box<pointT>((coord_type)minX, (coord_type)minY, (coord_type)maxX, (coord_type)maxY);
+        return bbox;
+    }
+    const Box<pointT>& getBBox() const {
+        return bbox;
+    }
+
+    int getVertexCount() const {
+        int cnt = 0;
+        forEachQuad([&cnt](const double*, const double*) { cnt += 4; });
+        return cnt;
+    }
+
+    void getVertices(std::vector<QVector3D>& vertices,
+                     std::vector<int>& vertexCnts) const {
+        OASIS_TRACE(TRACE_RECORD, "draw Path: " << points.size() << " points..." << std::endl);
+        forEachQuad([&](const double* x, const double* y) {
+            for (int k = 0; k < 4; ++k) {
+                vertices.emplace_back((float)x[k], (float)y[k], pointZval);
+            }
+            vertexCnts.emplace_back(4);
+        });
+    }
+
+    int getShapeType() {
+        return PATH;
+    }
+
+protected:
+    /// how far, in half widths, a segment reaches past a join for its outer
+    /// edge to meet the next one's: tan of half the turn, at most 1.
+    static double miter(double ux, double uy, double vx, double vy) {
+        double cross = std::fabs(ux * vy - uy * vx);
+        double dot = ux * vx + uy * vy;
+        if (dot <= 0.0)
+            return 1.0;
+        return std::min(1.0, cross / (1.0 + dot));
+    }
+
+    /// the first segment of non-zero length from points[i] on: i and j are
+    /// set to its ends, (ux, uy) to its direction. false if there is none.
+    bool segment(std::size_t& i, std::size_t& j, double& ux, double& uy) const {
+        for (; i + 1 < points.size(); ++i) {
+            double dx = (double)bg::get<0>(points[i + 1]) - (double)bg::get<0>(points[i]);
+            double dy = (double)bg::get<1>(points[i + 1]) - (double)bg::get<1>(points[i]);
+            double len = std::hypot(dx, dy);
+            if (len != 0.0) {
+                j = i + 1;
+                ux = dx / len;
+                uy = dy / len;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// the quad from (ax, ay) to (bx, by), (nx, ny) to its left side.
+    static void quad(double ax, double ay, double bx, double by, double nx, double ny, double* x, double* y) {
+        x[0] = ax - nx;            y[0] = ay - ny;
+        x[1] = bx - nx;            y[1] = by - ny;
+        x[2] = bx + nx;            y[2] = by + ny;
+        x[3] = ax + nx;            y[3] = ay + ny;
+    }
+}; // class Path
+
+typedef Path<dPoint> dPath;
+typedef Path<iPoint> iPath;
+typedef Path<lPoint> lPath;
+
+} // namespace layout
+
+#endif // __LAYOUT_PATH_HPP__
@@ -0,0 +1,190 @@
+#ifndef __LAYOUT_PLACEMENT_HPP__
+#define __LAYOUT_PLACEMENT_HPP__
+
+
+#include "repetition.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+#include <QVector3D>
+
+
+namespace layout {
+
+template<typename pointT> class Cell;
+
+/// Affine map from a placed cell's coordinates into its parent's:
+/// x' = xx*x + xy*y + dx, y' = yx*x + yy*y + dy.
+class Transform {
+protected:
+    double xx = 1.0, xy = 0.0, yx = 0.0, yy = 1.0;
+    double dx = 0.0, dy = 0.0;
+
+public:
+    Transform() = default;
+
+    /// in OASIS order: mirror about the x axis, magnify, rotate counter-clockwise
+    /// by angle degrees, then move by (x, y).
+    Transform(double x, double y, double angle, bool mirror, double mag) {
+        double c, s;
+        double quarter = angle / 90.0;
+        if (quarter == std::floor(quarter)) {
+            // quarter turns stay exact.
+            static const double cosines[4] = {1.0, 0.0, -1.0, 0.0};
+            static const double sines[4] = {0.0, 1.0, 0.0, -1.0};
+            int q = ((int)quarter % 4 + 4) % 4;
+            c = cosines[q];
+            s = sines[q];
+        } else {
+            double rad = angle * 3.14159265358979323846 / 180.0;
+            c = std::cos(rad);
+            s = std::sin(rad);
+        }
+        double m = mirror ? -1.0 : 1.0;
+        xx = mag * c;
+        xy = -mag * s * m;
+        yx = mag * s;
+        yy = mag * c * m;
+        dx = x;
+        dy = y;
+    }
+
+    bool isIdentity() const {
+        return xx == 1.0 && xy == 0.0 && yx == 0.0 && yy == 1.0 && dx == 0.0 && dy == 0.0;
+    }
+
+    /// inner applied first, then this.
+    Transform operator*(const Transform& inner) const {
+        Transform t;
+        t.xx = xx * inner.xx + xy * inner.yx;
+        t.xy = xx * inner.xy + xy * inner.yy;
+        t.yx = yx * inner.xx + yy * inner.yx;
+        t.yy = yx * inner.xy + yy * inner.yy;
+        t.dx = xx * inner.dx + xy * inner.dy + dx;
+        t.dy = yx * inner.dx + yy * inner.dy + dy;
+        return t;
+    }
+
+    Transform inverted() const {
+        double det = xx * yy - xy * yx;
+        Transform t;
+        t.xx = yy / det;
+        t.xy = -xy / det;
+        t.yx = -yx / det;
+        t.yy = xx / det;
+        t.dx = -(t.xx * dx + t.xy * dy);
+        t.dy = -(t.yx * dx + t.yy * dy);
+        return t;
+    }
+
+    QVector3D apply(const QVector3D& v) const {
+        return QVector3D((float)(xx * v.x() + xy * v.y() + dx),
+                         (float)(yx * v.x() + yy * v.y() + dy), v.z());
+    }
+
+    /// map vertices[first..] in place.
+    void apply(std::vector<QVector3D>& vertices, std::size_t first) const {
+        if (isIdentity())
+            return;
+        for (std::size_t i = first; i < vertices.size(); ++i) {
+            vertices[i] = apply(vertices[i]);
+        }
+    }
+
+    /// bounding box of the mapped box. integer boxes are rounded outwards.
+    template<typename pointT>
+    Box<pointT> apply(const Box<pointT>& box) const {
+        typedef typename pointT::coord_type coord_type;
+        if (!box.isValid() || isIdentity())
+            return box;
+        double x0 = box.getMinX(), y0 = box.getMinY(), x1 = box.getMaxX(), y1 = box.getMaxY();
+        double px[4] = {x0, x1, x1, x0};
+        double py[4] = {y0, y0, y1, y1};
+        double minX = 0.0, minY = 0.0, maxX = 0.0, maxY = 0.0;
+        for (int i = 0; i < 4; ++i) {
+            double x = xx * px[i] + xy * py[i] + dx;
+            double y = yx * px[i] + yy * py[i] + dy;
+            if (i == 0 || x < minX) minX = x;
+            if (i == 0 || y < minY) minY = y;
+            if (i == 0 || x > maxX) maxX = x;
+            if (i == 0 || y > maxY) maxY = y;
+        }
+        if (std::is_integral<coord_type>::value) {
+            minX = std::floor(minX);
+            minY = std::floor(minY);
+            maxX = std::ceil(maxX);
+            maxY = std::ceil(maxY);
+        }
+        return Box<pointT>((coord_type)minX, (coord_type)minY, (coord_type)maxX, (coord_type)maxY);
+    }
+}; // class Transform
+
+/// One instance of a cell inside another. The placed cell is shared, not
+/// copied: any number of placements point at the same Cell.
+template<typename pointT>
+class Placement {
+public:
+    typedef typename pointT::coord_type coord_type;
+
+protected:
+    Cell<pointT>* cell;
+    pointT offset;
+    /// counter-clockwise, in degrees.
+    double angle;
+    /// about the x axis, before the rotation.
+    bool mirror;
+    double magnification;
+    /// further copies, moved by the repetition's offsets in the parent.
+    Repetition<pointT> repetition;
+
+public:
+    Placement(Cell<pointT>* c, const pointT& o, double a = 0.0, bool m = false, double mag = 1.0,
+              const Repetition<pointT>& r = Repetition<pointT>())
+        : cell(c)
+        , offset(o)
+        , angle(a)
+        , mirror(m)
+        , magnification(mag)
+        , repetition(r) {
+    }
+
+    Cell<pointT>* getCell() const {
+        return cell;
+    }
+    const pointT& getOffset() const {
+        return offset;
+    }
+    double getAngle() const {
+        return angle;
+    }
+    bool isMirrored() const {
+        return mirror;
+    }
+    double getMagnification() const {
+        return magnification;
+    }
+    const Repetition<pointT>& getRepetition() const {
+        return repetition;
+    }
+
+    /// a plain quarter turn without magnification, as a PLACEMENT record without
+    /// real numbers can hold.
+    bool isOrthogonal() const {
+        return magnification == 1.0 && angle / 90.0 == std::floor(angle / 90.0);
+    }
+
+    Transform getTransform() const {
+        return Transform(bg::get<0>(offset), bg::get<1>(offset), angle, mirror, magnification);
+    }
+
+    /// the placed cell's bounding box in the parent's coordinates, all copies.
+    Box<pointT> getBBox() const {
+        return repetition.apply(getTransform().apply(cell->getBBox()));
+    }
+}; // class Placement
+
+} // namespace layout
+
+#endif // __LAYOUT_PLACEMENT_HPP__
@@ -87,6 +87,8 @@ public:
 }; // class Polygon
 
 typedef Polygon<dPoint> dPolygon;
+typedef Polygon<iPoint> iPolygon;
+typedef Polygon<lPoint> lPolygon;
 
 } // namespace layout
 
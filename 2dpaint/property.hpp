@@ -0,0 +1,49 @@
+#ifndef __LAYOUT_PROPERTY_HPP__
+#define __LAYOUT_PROPERTY_HPP__
+
+
+#include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
+
+
+namespace layout {
+
+/// One value of a property: an unsigned or signed integer, a real or a string.
+/// integers too large for 32 bits, e.g. file offsets or 64-bit coordinates,
+/// take 64.
+typedef std::variant<unsigned int, int, std::uint64_t, std::int64_t, double, std::string> PropertyValue;
+
+/// A named list of values on a layout, a cell or a shape, as OASIS PROPERTY
+/// records carry them. standard marks the S_ properties of the OASIS
+/// specification, e.g. S_MAX_SIGNED_INTEGER or S_TOP_CELL.
+struct Property {
+    std::string name;
+    std::vector<PropertyValue> values;
+    bool standard = false;
+};
+
+typedef std::vector<Property> Properties;
+
+/// a value as an integer, reals truncated. 0 for a string.
+inline long long propertyInteger(const PropertyValue& v) {
+    switch (v.index()) {
+    case 0:
+        return std::get<unsigned int>(v);
+    case 1:
+        return std::get<int>(v);
+    case 2:
+        return (long long)std::get<std::uint64_t>(v);
+    case 3:
+        return std::get<std::int64_t>(v);
+    case 4:
+        return (long long)std::get<double>(v);
+    default:
+        return 0;
+    }
+}
+
+} // namespace layout
+
+#endif // __LAYOUT_PROPERTY_HPP__
@@ -0,0 +1,150 @@
+#ifndef __LAYOUT_RECTS_HPP__
+#define __LAYOUT_RECTS_HPP__
+
+
+#include "box.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+
+namespace layout {
+
+/// Axis aligned rectangles of a layer, stored as one array per edge.
+/// Rectangles carry no vtable or heap node, so bbox, vertex generation and
+/// writing are plain loops over contiguous coordinates.
+template<typename pointT>
+class Rects {
+public:
+    typedef typename pointT::coord_type coord_type;
+
+protected:
+    std::vector<coord_type> minX;
+    std::vector<coord_type> minY;
+    std::vector<coord_type> maxX;
+    std::vector<coord_type> maxY;
+
+public:
+    std::size_t size() const {
+        return minX.size();
+    }
+    bool empty() const {
+        return minX.empty();
+    }
+
+    void reserve(std::size_t n) {
+        minX.reserve(n);
+        minY.reserve(n);
+        maxX.reserve(n);
+        maxY.reserve(n);
+    }
+
+    void clear() {
+        minX.clear();
+        minY.clear();
+        maxX.clear();
+        maxY.clear();
+    }
+
+    /// append a rectangle, returns its index.
+    std::size_t add(coord_type x0, coord_type y0, coord_type x1, coord_type y1) {
+        minX.push_back(x0);
+        minY.push_back(y0);
+        maxX.push_back(x1);
+        maxY.push_back(y1);
+        return minX.size() - 1;
+    }
+
+    /// remove rectangle i by moving the last one into its slot.
+    void remove(std::size_t i) {
+        std::size_t last = size() - 1;
+        minX[i] = minX[last];
+        minY[i] = minY[last];
+        maxX[i] = maxX[last];
+        maxY[i] = maxY[last];
+        minX.pop_back();
+        minY.pop_back();
+        maxX.pop_back();
+        maxY.pop_back();
+    }
+
+    coord_type getMinX(std::size_t i) const {
+        return minX[i];
+    }
+    coord_type getMinY(std::size_t i) const {
+        return minY[i];
+    }
+    coord_type getMaxX(std::size_t i) const {
+        return maxX[i];
+    }
+    coord_type getMaxY(std::size_t i) const {
+        return maxY[i];
+    }
+    Box<pointT> getBox(std::size_t i) const {
+        return Box<pointT>(minX[i], minY[i], maxX[i], maxY[i]);
+    }
+
+    /// bounding box of all rectangles. invalid when there are none.
+    Box<pointT> computeBBox() const {
+        Box<pointT> box;
+        std::size_t n = size();
+        if (n == 0) {
+            box.makeInvalid();
+            return box;
+        }
+        coord_type x0 = minX[0], y0 = minY[0], x1 = maxX[0], y1 = maxY[0];
+        const coord_type* ax0 = minX.data();
+        const coord_type* ay0 = minY.data();
+        const coord_type* ax1 = maxX.data();
+        const coord_type* ay1 = maxY.data();
+        for (std::size_t i = 1; i < n; ++i) {
+            x0 = std::min(x0, ax0[i]);
+            y0 = std::min(y0, ay0[i]);
+            x1 = std::max(x1, ax1[i]);
+            y1 = std::max(y1, ay1[i]);
+        }
+        return Box<pointT>(x0, y0, x1, y1);
+    }
+
+    /// the 4 corners of every rectangle, in Box::getVertices order.
+    void getVertices(std::vector<QVector3D>& vertices,
+                     std::vector<int>& vertexCnts) const {
+        std::size_t n = size();
+        std::size_t first = vertices.size();
+        vertices.resize(first + 4 * n);
+        QVector3D* v = vertices.data() + first;
+        for (std::size_t i = 0; i < n; ++i, v += 4) {
+            float x0 = (float)minX[i], y0 = (float)minY[i];
+            float x1 = (float)maxX[i], y1 = (float)maxY[i];
+            v[0] = QVector3D(x0, y0, pointZval);
+            v[1] = QVector3D(x1, y0, pointZval);
+            v[2] = QVector3D(x1, y1, pointZval);
+            v[3] = QVector3D(x0, y1, pointZval);
+        }
+        vertexCnts.insert(vertexCnts.end(), n, 4);
+    }
+
+    /// same as above for the rectangles listed in which.
+    void getVertices(const std::vector<std::size_t>& which,
+                     std::vector<QVector3D>& vertices,
+                     std::vector<int>& vertexCnts) const {
+        std::size_t first = vertices.size();
+        vertices.resize(first + 4 * which.size());
+        QVector3D* v = vertices.data() + first;
+        std::vector<std::size_t>::const_iterator it = which.begin();
+        for (; it != which.end(); ++it, v += 4) {
+            float x0 = (float)minX[*it], y0 = (float)minY[*it];
+            float x1 = (float)maxX[*it], y1 = (float)maxY[*it];
+            v[0] = QVector3D(x0, y0, pointZval);
+            v[1] = QVector3D(x1, y0, pointZval);
+            v[2] = QVector3D(x1, y1, pointZval);
+            v[3] = QVector3D(x0, y1, pointZval);
+        }
+        vertexCnts.insert(vertexCnts.end(), which.size(), 4);
+    }
+}; // class Rects
+
+} // namespace layout
+
+#endif // __LAYOUT_RECTS_HPP__
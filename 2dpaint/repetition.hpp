@@ -0,0 +1,221 @@
+#ifndef __LAYOUT_REPETITION_HPP__
+#define __LAYOUT_REPETITION_HPP__
+
+
+#include "box.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+namespace layout {
+
+/// Where the copies of a repeated shape or placement go, as offsets from the
+/// first copy. Arrays are kept as a lattice (two steps and two counts), so a
+/// million vias cost the same as one; only irregular repetitions keep an
+/// offset per copy.
+template<typename pointT>
+class Repetition {
+public:
+    typedef typename pointT::coord_type coord_type;
+
+protected:
+    /// copy (i, j) sits at i*step1 + j*step2, i < count1, j < count2.
+    pointT step1{0, 0};
+    pointT step2{0, 0};
+    unsigned int count1 = 1;
+    unsigned int count2 = 1;
+    /// irregular repetitions only: every copy's offset, the first is (0, 0).
+    std::vector<pointT> offsets;
+
+public:
+    /// a single copy.
+    Repetition() = default;
+
+    /// count1 copies step1 apart, that row repeated count2 times step2 apart.
+    Repetition(unsigned int n1, const pointT& s1, unsigned int n2 = 1, const pointT& s2 = pointT(0, 0))
+        : step1(s1)
+        , step2(s2)
+        , count1(std::max(n1, 1u))
+        , count2(std::max(n2, 1u)) {
+        // a single column is kept as a single row.
+        if (count1 == 1 && count2 > 1) {
+            std::swap(step1, step2);
+            std::swap(count1, count2);
+        }
+    }
+
+    /// copies at arbitrary offsets. offs[0] must be (0, 0).
+    explicit Repetition(const std::vector<pointT>& offs)
+        : offsets(offs) {
+        if (offsets.size() <= 1)
+            offsets.clear();
+    }
+
+    bool isLattice() const {
+        return offsets.empty();
+    }
+
+    std::size_t size() const {
+        return isLattice() ? (std::size_t)count1 * count2 : offsets.size();
+    }
+
+    unsigned int getCount1() const {
+        return count1;
+    }
+    unsigned int getCount2() const {
+        return count2;
+    }
+    const pointT& getStep1() const {
+        return step1;
+    }
+    const pointT& getStep2() const {
+        return step2;
+    }
+    const std::vector<pointT>& getOffsets() const {
+        return offsets;
+    }
+
+    /// call f(dx, dy) for every copy, the first copy (0, 0) included.
+    template<typename F>
+    void forEach(F f) const {
+        if (!isLattice()) {
+            typename std::vector<pointT>::const_iterator it = offsets.begin();
+            for (; it != offsets.end(); ++it) {
+                f(it->x(), it->y());
+            }
+            return;
+        }
+        for (unsigned int j = 0; j < count2; ++j) {
+            coord_type x = j * step2.x();
+            coord_type y = j * step2.y();
+            for (unsigned int i = 0; i < count1; ++i) {
+                f(x, y);
+                x += step1.x();
+                y += step1.y();
+            }
+        }
+    }
+
+    /// the box covering every copy of box.
+    Box<pointT> apply(const Box<pointT>& box) const {
+        if (size() <= 1)
+            return box;
+        coord_type x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+        if (isLattice()) {
+            coord_type ax = (count1 - 1) * step1.x(), ay = (count1 - 1) * step1.y();
+            coord_type bx = (count2 - 1) * step2.x(), by = (count2 - 1) * step2.y();
+            x0 = std::min<coord_type>(ax, 0) + std::min<coord_type>(bx, 0);
+            y0 = std::min<coord_type>(ay, 0) + std::min<coord_type>(by, 0);
+            x1 = std::max<coord_type>(ax, 0) + std::max<coord_type>(bx, 0);
+            y1 = std::max<coord_type>(ay, 0) + std::max<coord_type>(by, 0);
+        } else {
+            typename std::vector<pointT>::const_iterator it = offsets.begin();
+            for (; it != offsets.end(); ++it) {
+                x0 = std::min(x0, it->x());
+                y0 = std::min(y0, it->y());
+                x1 = std::max(x1, it->x());
+                y1 = std::max(y1, it->y());
+            }
+        }
+        return Box<pointT>(box.getMinX() + x0, box.getMinY() + y0, box.getMaxX() + x1, box.getMaxY() + y1);
+    }
+
+    bool operator==(const Repetition& r) const {
+        return count1 == r.count1 && count2 == r.count2 && step1 == r.step1 && step2 == r.step2 &&
+               offsets == r.offsets;
+    }
+    bool operator!=(const Repetition& r) const {
+        return !(*this == r);
+    }
+}; // class Repetition
+
+/// One shape drawn at every position of a Repetition, e.g. a via array.
+/// The copies are never built; vertices are generated per copy on demand.
+template<typename pointT>
+class RepeatedShape : public iShape<pointT> {
+public:
+    typedef typename pointT::coord_type coord_type;
+
+protected:
+    std::unique_ptr<iShape<pointT> > shape;
+    Repetition<pointT> repetition;
+    Box<pointT> bbox{std::numeric_limits<coord_type>::min(),
+                     std::numeric_limits<coord_type>::min(),
+                     std::numeric_limits<coord_type>::min(),
+                     std::numeric_limits<coord_type>::min()};
+
+public:
+    /// takes ownership of s, the first copy.
+    RepeatedShape(iShape<pointT>* s, const Repetition<pointT>& r)
+        : shape(s)
+        , repetition(r) {
+        computeBBox();
+    }
+
+    virtual ~RepeatedShape() {}
+
+    void print(std::string prefix) {
+        std::cout << prefix << "Repeated x" << repetition.size() << std::endl;
+        shape->print(prefix + "  ");
+    }
+
+    const iShape<pointT>* getShape() const {
+        return shape.get();
+    }
+    iShape<pointT>* getShape() {
+        return shape.get();
+    }
+    const Repetition<pointT>& getRepetition() const {
+        return repetition;
+    }
+
+    const Box<pointT>& computeBBox() {
+        bbox = repetition.apply(shape->getBBox());
+        return bbox;
+    }
+    const Box<pointT>& getBBox() const {
+        return bbox;
+    }
+
+    int getVertexCount() const {
+        return (int)(shape->getVertexCount() * repetition.size());
+    }
+
+    void getVertices(std::vector<QVector3D>& vertices,
+                     std::vector<int>& vertexCnts) const {
+        Box<pointT> all;
+        all.makeInvalid();
+        getVertices(all, vertices, vertexCnts);
+    }
+
+    /// vertices of the copies intersecting region. an invalid region means all copies.
+    void getVertices(const Box<pointT>& region,
+                     std::vector<QVector3D>& vertices,
+                     std::vector<int>& vertexCnts) const {
+        std::vector<QVector3D> first;
+        std::vector<int> firstCnts;
+        shape->getVertices(first, firstCnts);
+        const Box<pointT>& b = shape->getBBox();
+        repetition.forEach([&](coord_type dx, coord_type dy) {
+            if (region.isValid() &&
+                !region.intersects(Box<pointT>(b.getMinX() + dx, b.getMinY() + dy, b.getMaxX() + dx, b.getMaxY() + dy)))
+                return;
+            QVector3D d((float)dx, (float)dy, 0.0f);
+            for (std::size_t i = 0; i < first.size(); ++i) {
+                vertices.push_back(first[i] + d);
+            }
+            vertexCnts.insert(vertexCnts.end(), firstCnts.begin(), firstCnts.end());
+        });
+    }
+
+    int getShapeType() {
+        return REPEATED;
+    }
+}; // class RepeatedShape
+
+} // namespace layout
+
+#endif // __LAYOUT_REPETITION_HPP__
@@ -0,0 +1,163 @@
+#ifndef REPETITIONFINDER_H
+#define REPETITIONFINDER_H
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <vector>
+#include "repetition.hpp"
+
+namespace oasisio {
+
+/// Writer pass that covers the positions of identical shapes with as few
+/// repetitions as it can find. Each position ends up in exactly one group.
+///
+/// Rows (equal y) are split into evenly spaced runs; equal runs stacked at
+/// an even pitch become matrices (type 1), the others rows (type 2). The
+/// rest of a row becomes one irregular row (type 4/5). Shapes left alone in
+/// their row are gathered into columns the same way (type 3, 6/7).
+template<class pointT>
+class RepetitionFinder {
+public:
+    typedef typename pointT::coord_type coord_type;
+
+    /// the first copy and where the others go.
+    struct Group {
+        pointT origin;
+        layout::Repetition<pointT> repetition;
+    };
+
+    /// group positions, which are sorted in place.
+    static void find(std::vector<pointT>& positions, std::vector<Group>& groups) {
+
+        std::sort(positions.begin(), positions.end(), [](const pointT& a, const pointT& b) {
+            return std::make_tuple(a.y(), a.x()) < std::make_tuple(b.y(), b.x());
+        });
+
+        // evenly spaced runs by (x, count, step), each with the rows' y.
+        std::map<std::tuple<coord_type, unsigned int, coord_type>, std::vector<coord_type> > runs;
+        // alone in their row, or a second shape at the same place.
+        std::vector<pointT> single;
+
+        std::size_t first = 0;
+        while(first < positions.size()) {
+            std::size_t last = first + 1;
+            while(last < positions.size() && positions[last].y() == positions[first].y()) {
+                ++last;
+            }
+            splitRow(positions, first, last, runs, single, groups);
+            first = last;
+        }
+
+        typename std::map<std::tuple<coord_type, unsigned int, coord_type>, std::vector<coord_type> >::const_iterator it;
+        for(it = runs.begin(); it != runs.end(); ++it) {
+            coord_type x = std::get<0>(it->first);
+            unsigned int count = std::get<1>(it->first);
+            coord_type step = std::get<2>(it->first);
+            const std::vector<coord_type>& ys = it->second;
+            std::size_t i = 0;
+            while(i < ys.size()) {
+                std::size_t j = i + 1;
+                if(j < ys.size()) {
+                    coord_type pitch = ys[j] - ys[i];
+                    while(j + 1 < ys.size() && ys[j+1] - ys[j] == pitch) {
+                        ++j;
+                    }
+                    groups.push_back({pointT(x, ys[i]), layout::Repetition<pointT>(count, pointT(step, 0),
+                                                                                   (unsigned int)(j - i + 1), pointT(0, pitch))});
+                    i = j + 1;
+                } else {
+                    groups.push_back({pointT(x, ys[i]), layout::Repetition<pointT>(count, pointT(step, 0))});
+                    ++i;
+                }
+            }
+        }
+
+        findColumns(single, groups);
+    }
+
+protected:
+    /// positions[first..last) share one y and are sorted by x.
+    static void splitRow(const std::vector<pointT>& positions, std::size_t first, std::size_t last,
+                         std::map<std::tuple<coord_type, unsigned int, coord_type>, std::vector<coord_type> >& runs,
+                         std::vector<pointT>& single, std::vector<Group>& groups) {
+
+        coord_type y = positions[first].y();
+        std::vector<coord_type> rest;
+        std::size_t i = first;
+        while(i < last) {
+            if(i + 1 < last && positions[i+1].x() == positions[i].x()) {
+                // stacked shapes: the extra copy is written on its own.
+                single.push_back(positions[i]);
+                ++i;
+                continue;
+            }
+            std::size_t j = i + 1;
+            if(j < last) {
+                coord_type step = positions[j].x() - positions[i].x();
+                while(j + 1 < last && positions[j+1].x() - positions[j].x() == step) {
+                    ++j;
+                }
+                // two shapes are only a run when they make up the whole row.
+                std::size_t n = j - i + 1;
+                if(n >= 3 || (i == first && j + 1 == last)) {
+                    runs[std::make_tuple(positions[i].x(), (unsigned int)n, step)].push_back(y);
+                    i = j + 1;
+                    continue;
+                }
+            }
+            rest.push_back(positions[i].x());
+            ++i;
+        }
+
+        if(rest.size() == 1) {
+            single.push_back(pointT(rest[0], y));
+        } else if(rest.size() > 1) {
+            std::vector<pointT> offsets;
+            offsets.reserve(rest.size());
+            for(coord_type x : rest) {
+                offsets.push_back(pointT(x - rest[0], 0));
+            }
+            groups.push_back({pointT(rest[0], y), layout::Repetition<pointT>(offsets)});
+        }
+    }
+
+    static void findColumns(std::vector<pointT>& single, std::vector<Group>& groups) {
+
+        std::sort(single.begin(), single.end(), [](const pointT& a, const pointT& b) {
+            return std::make_tuple(a.x(), a.y()) < std::make_tuple(b.x(), b.y());
+        });
+
+        std::size_t first = 0;
+        while(first < single.size()) {
+            std::size_t last = first + 1;
+            while(last < single.size() && single[last].x() == single[first].x()) {
+                ++last;
+            }
+            std::vector<pointT> offsets;
+            std::size_t i;
+            for(i=first; i<last; ++i) {
+                // a second shape at the same place stays on its own.
+                if(i > first && single[i].y() == single[i-1].y()) {
+                    groups.push_back({single[i], layout::Repetition<pointT>()});
+                    continue;
+                }
+                offsets.push_back(pointT(0, single[i].y() - single[first].y()));
+            }
+            bool even = offsets.size() > 1;
+            for(i=2; even && i<offsets.size(); ++i) {
+                even = offsets[i].y() - offsets[i-1].y() == offsets[1].y();
+            }
+            if(even) {
+                groups.push_back({single[first], layout::Repetition<pointT>((unsigned int)offsets.size(), offsets[1])});
+            } else {
+                groups.push_back({single[first], layout::Repetition<pointT>(offsets)});
+            }
+            first = last;
+        }
+    }
+};
+
+}
+
+#endif // REPETITIONFINDER_H
@@ -0,0 +1,68 @@
+#ifndef __LAYOUT_TEXT_HPP__
+#define __LAYOUT_TEXT_HPP__
+
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+
+namespace layout {
+
+/// A text label: a position and the number of its string in the layout's
+/// TextPool. Labels are not drawn and are not part of any bounding box.
+template<typename pointT>
+struct Text {
+    typedef typename pointT::coord_type coord_type;
+
+    coord_type x;
+    coord_type y;
+    unsigned int string;
+};
+
+/// The strings of a layout's labels, each kept once and referred to by
+/// number, so millions of labels sharing a few thousand strings hold only
+/// those few thousand. Numbers count up from 0 in the order strings are
+/// first interned. intern may be called from several threads.
+class TextPool {
+protected:
+    /// a deque never moves its strings, so the views below stay valid.
+    std::deque<std::string> strings;
+    std::unordered_map<std::string_view, unsigned int> refs;
+    std::mutex mutex;
+
+public:
+    TextPool() = default;
+    TextPool(const TextPool&) = delete;
+    TextPool& operator=(const TextPool&) = delete;
+
+    /// the number of s, added if it is new.
+    unsigned int intern(std::string_view s) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unordered_map<std::string_view, unsigned int>::const_iterator it = refs.find(s);
+        if (it != refs.end())
+            return it->second;
+        unsigned int ref = (unsigned int)strings.size();
+        strings.emplace_back(s);
+        refs.emplace(strings.back(), ref);
+        return ref;
+    }
+
+    const std::string& get(unsigned int ref) const {
+        return strings[ref];
+    }
+
+    std::size_t size() const {
+        return strings.size();
+    }
+    bool empty() const {
+        return strings.empty();
+    }
+}; // class TextPool
+
+} // namespace layout
+
+#endif // __LAYOUT_TEXT_HPP__
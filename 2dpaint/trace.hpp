@@ -0,0 +1,74 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <iostream>
+
+/// Compile-time trace level for the OASIS read/write and draw paths.
+/// Statements above the level are discarded by `if constexpr`, so a
+/// disabled trace costs nothing. Set it with DEFINES in 2dpaint.pro.
+#ifndef OASIS_TRACE_LEVEL
+#define OASIS_TRACE_LEVEL 0
+#endif
+
+/// Runtime counters (records, shapes, vertices, frames). Off by default.
+#ifndef OASIS_TRACE_COUNTERS
+#define OASIS_TRACE_COUNTERS 0
+#endif
+
+#define TRACE_SUMMARY 1     // once per file, cell, layer or frame
+#define TRACE_RECORD 2      // once per record or shape
+#define TRACE_DETAIL 3      // record fields, points and vertices
+
+#define OASIS_TRACE(level, expr) \
+    do { \
+        if constexpr ((level) <= OASIS_TRACE_LEVEL) { \
+            std::cout << expr; \
+        } \
+    } while(0)
+
+#define OASIS_COUNT(counter, n) \
+    do { \
+        if constexpr (OASIS_TRACE_COUNTERS) { \
+            trace::add(trace::counter, n); \
+        } \
+    } while(0)
+
+namespace trace {
+
+enum Counter {
+    RecordsRead = 0,
+    ShapesRead,
+    ShapesWritten,
+    VerticesGenerated,
+    FramesDrawn,
+    CounterCount
+};
+
+inline std::atomic<unsigned long long> counters[CounterCount];
+
+inline void add(Counter c, unsigned long long n) {
+    counters[c].fetch_add(n, std::memory_order_relaxed);
+}
+
+inline unsigned long long get(Counter c) {
+    return counters[c].load(std::memory_order_relaxed);
+}
+
+inline void reset() {
+    for(int i=0; i<CounterCount; ++i) {
+        counters[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+inline void print(std::ostream& o) {
+    o << "Records read       : " << get(RecordsRead) << std::endl;
+    o << "Shapes read        : " << get(ShapesRead) << std::endl;
+    o << "Shapes written     : " << get(ShapesWritten) << std::endl;
+    o << "Vertices generated : " << get(VerticesGenerated) << std::endl;
+    o << "Frames drawn       : " << get(FramesDrawn) << std::endl;
+}
+
+} // namespace trace
+
+#endif // TRACE_H
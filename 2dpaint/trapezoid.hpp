@@ -3,32 +3,84 @@
 
 
 #include "box.hpp"
+#include <algorithm>
 #include <cassert>
 
-#include <boost/geometry/geometries/register/ring.hpp>
-
 
 namespace layout {
 
+/// A trapezoid with two horizontal (or, if vertical, two vertical) parallel
+/// sides, kept as its bounding box and two deltas like an OASIS TRAPEZOID
+/// record rather than as four points. For a horizontal trapezoid
+///   deltaA = top left x - bottom left x,
+///   deltaB = top right x - bottom right x;
+/// for a vertical one
+///   deltaA = bottom right y - bottom left y,
+///   deltaB = top right y - top left y.
+/// One parallel side may shrink to a point, making a triangle.
 template<typename pointT>
-class Trapezoid : public iShape<pointT>, public bg::model::ring<pointT> {
+class Trapezoid : public iShape<pointT> {
 public:
-    typedef bg::model::ring<pointT> base_type;
     typedef typename pointT::coord_type coord_type;
 
 protected:
-    int tType;
     Box<pointT> bbox{std::numeric_limits<coord_type>::min(),
                      std::numeric_limits<coord_type>::min(),
                      std::numeric_limits<coord_type>::min(),
                      std::numeric_limits<coord_type>::min()};
+    coord_type deltaA;
+    coord_type deltaB;
+    bool vertical;
 
 public:
-    Trapezoid(const std::vector<pointT>& pts, int type)
-        : base_type(pts.begin(), pts.end())
-        , tType(type) {
+    Trapezoid(const Box<pointT>& box, coord_type a, coord_type b, bool v = false)
+        : bbox(box)
+        , deltaA(a)
+        , deltaB(b)
+        , vertical(v) {
+    }
+
+    /// from the 4 corners in any order. two sides must be horizontal, or else
+    /// two sides vertical.
+    Trapezoid(const std::vector<pointT>& pts)
+        : deltaA(0)
+        , deltaB(0)
+        , vertical(false) {
         assert(pts.size() == 4);
-        computeBBox();
+        coord_type x0 = pts[0].x(), y0 = pts[0].y(), x1 = x0, y1 = y0;
+        typename std::vector<pointT>::const_iterator it = pts.begin();
+        for (; it != pts.end(); ++it) {
+            x0 = std::min(x0, it->x());
+            y0 = std::min(y0, it->y());
+            x1 = std::max(x1, it->x());
+            y1 = std::max(y1, it->y());
+        }
+        bbox = Box<pointT>(x0, y0, x1, y1);
+        for (it = pts.begin(); it != pts.end(); ++it) {
+            if (it->y() != y0 && it->y() != y1)
+                vertical = true;
+        }
+        // extent of the bottom (left) side and of the top (right) side.
+        coord_type lowMin = vertical ? y1 : x1, lowMax = vertical ? y0 : x0;
+        coord_type highMin = lowMin, highMax = lowMax;
+        for (it = pts.begin(); it != pts.end(); ++it) {
+            coord_type along = vertical ? it->y() : it->x();
+            if ((vertical ? it->x() == x0 : it->y() == y0)) {
+                lowMin = std::min(lowMin, along);
+                lowMax = std::max(lowMax, along);
+            } else {
+                assert(vertical ? it->x() == x1 : it->y() == y1);
+                highMin = std::min(highMin, along);
+                highMax = std::max(highMax, along);
+            }
+        }
+        if (highMin > highMax) {
+            // no height: both sides are the same.
+            highMin = lowMin;
+            highMax = lowMax;
+        }
+        deltaA = highMin - lowMin;
+        deltaB = highMax - lowMax;
     }
 
     void print(std::string prefix) {
@@ -50,19 +102,46 @@ public:
 
     virtual ~Trapezoid() {}
 
-    /// compute bounding box. non const version
-    const Box<pointT>& computeBBox() {
-        std::set<coord_type> xs;
-        std::set<coord_type> ys;
-        typename std::vector<pointT>::const_iterator it = this->begin();
-        for (; it != this->end(); ++it) {
-            xs.emplace(bg::get<0>(*it));
-            ys.emplace(bg::get<1>(*it));
+    coord_type getDeltaA() const {
+        return deltaA;
+    }
+    coord_type getDeltaB() const {
+        return deltaB;
+    }
+    bool isVertical() const {
+        return vertical;
+    }
+
+    /// the corners counter-clockwise from the bottom left. returns 3 for a
+    /// triangle, whose corner is not repeated.
+    int getCorners(pointT corners[4]) const {
+        coord_type x0 = bbox.getMinX(), y0 = bbox.getMinY();
+        coord_type x1 = bbox.getMaxX(), y1 = bbox.getMaxY();
+        coord_type a0 = std::max<coord_type>(-deltaA, 0), a1 = std::max<coord_type>(deltaA, 0);
+        coord_type b0 = std::max<coord_type>(deltaB, 0), b1 = std::max<coord_type>(-deltaB, 0);
+        if (vertical) {
+            corners[0] = pointT(x0, y0 + a0);
+            corners[1] = pointT(x1, y0 + a1);
+            corners[2] = pointT(x1, y1 - b1);
+            corners[3] = pointT(x0, y1 - b0);
+        } else {
+            corners[0] = pointT(x0 + a0, y0);
+            corners[1] = pointT(x1 - b0, y0);
+            corners[2] = pointT(x1 - b1, y1);
+            corners[3] = pointT(x0 + a1, y1);
+        }
+        int n = 0;
+        for (int i = 0; i < 4; ++i) {
+            if (i == 0 || corners[i] != corners[n - 1])
+                corners[n++] = corners[i];
         }
-        bbox.setMinX(*(xs.begin()));
-        bbox.setMinY(*(ys.begin()));
-        bbox.setMaxX(*(xs.rbegin()));
-        bbox.setMaxY(*(ys.rbegin()));
+        if (n > 1 && corners[n - 1] == corners[0])
+            --n;
+        return n;
+    }
+
+    /// the box and deltas are the shape; nothing to compute.
+    const Box<pointT>& computeBBox() {
         return bbox;
     }
     /// return bounding box. const version.
@@ -71,17 +150,19 @@ public:
     }
 
     int getVertexCount() const {
-        return 4;
+        pointT corners[4];
+        return getCorners(corners);
     }
 
     void getVertices(std::vector<QVector3D>& vertices,
                      std::vector<int>& vertexCnts) const {
-        printf("draw Trapezoid: 4 vertices...\n");
-        typename std::vector<pointT>::const_iterator it = this->begin();
-        for (; it != this->end(); ++it) {
-            vertices.emplace_back(bg::get<0>(*it), bg::get<1>(*it), pointZval);
+        pointT corners[4];
+        int n = getCorners(corners);
+        OASIS_TRACE(TRACE_RECORD, "draw Trapezoid: " << n << " vertices..." << std::endl);
+        for (int i = 0; i < n; ++i) {
+            vertices.emplace_back(bg::get<0>(corners[i]), bg::get<1>(corners[i]), pointZval);
         }
-        vertexCnts.emplace_back(4);
+        vertexCnts.emplace_back(n);
     }
 
     int getShapeType() {
@@ -91,31 +172,9 @@ public:
 }; // class Trapezoid
 
 typedef Trapezoid<dPoint> dTrapezoid;
+typedef Trapezoid<iPoint> iTrapezoid;
+typedef Trapezoid<lPoint> lTrapezoid;
 
 } // namespace layout
 
-//BOOST_GEOMETRY_REGISTER_RING_TEMPLATED(layout::Trapezoid)
-
 #endif // __LAYOUT_TRAPEZOID_HPP__
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
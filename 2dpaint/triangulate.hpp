@@ -0,0 +1,97 @@
+#ifndef __LAYOUT_TRIANGULATE_HPP__
+#define __LAYOUT_TRIANGULATE_HPP__
+
+
+#include <cstdint>
+#include <vector>
+#include <QVector3D>
+
+
+namespace layout {
+
+/// twice the signed area of the outline in the xy plane. positive when counter-clockwise.
+inline double signedArea2(const QVector3D* pts, int n) {
+    double area = 0.0;
+    for (int i = 0, j = n - 1; i < n; j = i++) {
+        area += (double)pts[j].x() * pts[i].y() - (double)pts[i].x() * pts[j].y();
+    }
+    return area;
+}
+
+inline double cross2(const QVector3D& a, const QVector3D& b, const QVector3D& c) {
+    return ((double)b.x() - a.x()) * ((double)c.y() - a.y()) -
+           ((double)b.y() - a.y()) * ((double)c.x() - a.x());
+}
+
+inline bool isConvex(const QVector3D* pts, int n) {
+    int sign = 0;
+    for (int i = 0; i < n; ++i) {
+        double c = cross2(pts[i], pts[(i + 1) % n], pts[(i + 2) % n]);
+        if (c == 0.0)
+            continue;
+        int s = c > 0.0 ? 1 : -1;
+        if (sign == 0)
+            sign = s;
+        else if (s != sign)
+            return false;
+    }
+    return true;
+}
+
+/// append triangle indices for the outline pts[0..n). indices are offset by base.
+/// convex outlines (boxes, circles, trapezoids) become a fan, anything else is ear clipped.
+inline void triangulate(const QVector3D* pts, int n, uint32_t base, std::vector<uint32_t>& indices) {
+    if (n < 3)
+        return;
+    if (isConvex(pts, n)) {
+        for (int i = 1; i + 1 < n; ++i) {
+            indices.push_back(base);
+            indices.push_back(base + i);
+            indices.push_back(base + i + 1);
+        }
+        return;
+    }
+
+    // ear clipping on the remaining vertices, walked in counter-clockwise order.
+    std::vector<int> remaining(n);
+    bool ccw = signedArea2(pts, n) > 0.0;
+    for (int i = 0; i < n; ++i) {
+        remaining[i] = ccw ? i : n - 1 - i;
+    }
+    int misses = 0;
+    int i = 0;
+    while (remaining.size() > 3) {
+        int m = (int)remaining.size();
+        int prev = remaining[(i + m - 1) % m];
+        int curr = remaining[i % m];
+        int next = remaining[(i + 1) % m];
+        bool ear = cross2(pts[prev], pts[curr], pts[next]) > 0.0;
+        for (int k = 0; ear && k < m; ++k) {
+            int p = remaining[k];
+            if (p == prev || p == curr || p == next)
+                continue;
+            ear = !(cross2(pts[prev], pts[curr], pts[p]) >= 0.0 &&
+                    cross2(pts[curr], pts[next], pts[p]) >= 0.0 &&
+                    cross2(pts[next], pts[prev], pts[p]) >= 0.0);
+        }
+        if (ear || misses >= m) {
+            // a full lap without an ear means a degenerate outline: clip anyway.
+            indices.push_back(base + prev);
+            indices.push_back(base + curr);
+            indices.push_back(base + next);
+            remaining.erase(remaining.begin() + (i % m));
+            misses = 0;
+        } else {
+            ++i;
+            ++misses;
+        }
+        i %= (int)remaining.size();
+    }
+    indices.push_back(base + remaining[0]);
+    indices.push_back(base + remaining[1]);
+    indices.push_back(base + remaining[2]);
+}
+
+} // namespace layout
+
+#endif // __LAYOUT_TRIANGULATE_HPP__
@@ -0,0 +1,227 @@
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define OASIS_VARINT_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OASIS_VARINT_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace oasisio {
+
+namespace varint {
+
+using byte = unsigned char;
+
+/// OASIS unsigned integers: 7 bits per byte, low group first, high bit set
+/// on every byte but the last. Values are truncated to 32 bits like
+/// OasisReader::fromBytesUnsigned does.
+
+/// decode one integer at p. returns the number of bytes used, 0 if the
+/// integer runs past end.
+inline std::size_t decodeOne(const byte* p, const byte* end, unsigned int& out) {
+    unsigned int value = 0;
+    unsigned int i = 0;
+    for(; p + i < end; ++i) {
+        byte in = p[i];
+        if(i < 5) {
+            value += (unsigned int)(in & 127) << (7*i);
+        }
+        if((in & 128) == 0) {
+            out = value;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/// signed integers keep the sign in bit 0 and the magnitude above it.
+inline int toSigned(unsigned int u) {
+    int magnitude = (int)(u >> 1);
+    return (u & 1) ? -magnitude : magnitude;
+}
+
+inline unsigned int countTrailingZeros(uint32_t m) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward(&idx, m);
+    return (unsigned int)idx;
+#else
+    return (unsigned int)__builtin_ctz(m);
+#endif
+}
+
+inline unsigned int popCount(uint32_t m) {
+#if defined(_MSC_VER)
+    return (unsigned int)__popcnt(m);
+#else
+    return (unsigned int)__builtin_popcount(m);
+#endif
+}
+
+inline unsigned int highestBit(uint32_t m) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanReverse(&idx, m);
+    return (unsigned int)idx;
+#else
+    return 31u - (unsigned int)__builtin_clz(m);
+#endif
+}
+
+/// assemble an integer of len (1..5) bytes from the little endian word w.
+inline unsigned int assemble(uint64_t w, unsigned int len) {
+    w &= ~0ull >> (64 - 8*len);
+    return (unsigned int)((w & 0x7f) |
+                          ((w >> 1) & 0x3f80) |
+                          ((w >> 2) & 0x1fc000) |
+                          ((w >> 3) & 0xfe00000) |
+                          ((w >> 4) & 0xf0000000));
+}
+
+/// reference decoder, one byte at a time.
+inline std::size_t decodeScalar(const byte*& p, const byte* end, unsigned int* out, std::size_t n) {
+    std::size_t k = 0;
+    for(; k < n; ++k) {
+        std::size_t len = decodeOne(p, end, out[k]);
+        if(len == 0) {
+            break;
+        }
+        p += len;
+    }
+    return k;
+}
+
+/// decode the integers ending in the terminator bits of mask, a block of
+/// width bytes starting at p. returns the bytes used by complete integers.
+inline std::size_t decodeBlock(const byte* p, uint32_t mask, unsigned int*& out, std::size_t& left) {
+    std::size_t start = 0;
+    while(mask != 0 && left > 0) {
+        unsigned int stop = countTrailingZeros(mask);
+        unsigned int len = stop + 1 - (unsigned int)start;
+        if(len <= 5) {
+            uint64_t w;
+            std::memcpy(&w, p + start, sizeof(w));
+            *out++ = assemble(w, len);
+        } else {
+            decodeOne(p + start, p + stop + 1, *out++);
+        }
+        --left;
+        start = stop + 1;
+        mask &= mask - 1;
+    }
+    return start;
+}
+
+/// decode n consecutive integers from [p, end) into out. returns how many
+/// were decoded; fewer than n only when the buffer ends first. p is moved
+/// past the decoded bytes.
+/// The terminating bytes of 16 (SSE2) or 32 (AVX2) bytes are found with one
+/// movemask; each integer is then put together from an unaligned word load
+/// without a per-byte loop. Blocks of 16 one-byte integers are widened directly.
+inline std::size_t decodeUnsigned(const byte*& p, const byte* end, unsigned int* out, std::size_t n) {
+    unsigned int* first = out;
+    std::size_t left = n;
+#if defined(OASIS_VARINT_AVX2)
+    // 8 bytes of slack so the word load in decodeBlock stays inside the buffer.
+    while(left >= 32 && end - p >= 32 + 8) {
+        __m256i in = _mm256_loadu_si256((const __m256i*)p);
+        uint32_t stops = ~(uint32_t)_mm256_movemask_epi8(in);
+        if(stops == 0) {
+            break;
+        }
+        p += decodeBlock(p, stops, out, left);
+    }
+#endif
+#if defined(OASIS_VARINT_SSE2)
+    while(left >= 16 && end - p >= 16 + 8) {
+        __m128i in = _mm_loadu_si128((const __m128i*)p);
+        uint32_t stops = ~(uint32_t)_mm_movemask_epi8(in) & 0xffff;
+        if(stops == 0xffff) {
+            // 16 one-byte integers.
+            __m128i zero = _mm_setzero_si128();
+            __m128i lo = _mm_unpacklo_epi8(in, zero);
+            __m128i hi = _mm_unpackhi_epi8(in, zero);
+            _mm_storeu_si128((__m128i*)(out + 0), _mm_unpacklo_epi16(lo, zero));
+            _mm_storeu_si128((__m128i*)(out + 4), _mm_unpackhi_epi16(lo, zero));
+            _mm_storeu_si128((__m128i*)(out + 8), _mm_unpacklo_epi16(hi, zero));
+            _mm_storeu_si128((__m128i*)(out + 12), _mm_unpackhi_epi16(hi, zero));
+            out += 16;
+            left -= 16;
+            p += 16;
+            continue;
+        }
+        if(stops == 0) {
+            break;
+        }
+        p += decodeBlock(p, stops, out, left);
+    }
+#endif
+    std::size_t done = (std::size_t)(out - first);
+    return done + decodeScalar(p, end, out, left);
+}
+
+/// move p past n integers without decoding them. returns how many were
+/// skipped; fewer than n only when the buffer ends first, with p left at
+/// the start of the unfinished integer.
+/// Counts terminating bytes 16 at a time where SSE2 is available.
+inline std::size_t skipUnsigned(const byte*& p, const byte* end, std::size_t n) {
+    std::size_t left = n;
+    const byte* q = p;
+#if defined(OASIS_VARINT_SSE2)
+    while(left > 0 && end - q >= 16) {
+        __m128i in = _mm_loadu_si128((const __m128i*)q);
+        uint32_t stops = ~(uint32_t)_mm_movemask_epi8(in) & 0xffff;
+        if(stops == 0) {
+            q += 16;
+            continue;
+        }
+        unsigned int cnt = popCount(stops);
+        if(cnt <= left) {
+            q += highestBit(stops) + 1;
+            left -= cnt;
+        } else {
+            for(; left > 1; --left) {
+                stops &= stops - 1;
+            }
+            q += countTrailingZeros(stops) + 1;
+            left = 0;
+        }
+        p = q;
+    }
+#endif
+    while(left > 0 && q < end) {
+        if((*q++ & 128) == 0) {
+            --left;
+            p = q;
+        }
+    }
+    return n - left;
+}
+
+/// same as decodeUnsigned, converted to signed integers.
+inline std::size_t decodeSigned(const byte*& p, const byte* end, int* out, std::size_t n) {
+    unsigned int* raw = reinterpret_cast<unsigned int*>(out);
+    std::size_t k = decodeUnsigned(p, end, raw, n);
+    for(std::size_t i = 0; i < k; ++i) {
+        out[i] = toSigned(raw[i]);
+    }
+    return k;
+}
+
+} // namespace varint
+
+}
+
+#endif // VARINT_H